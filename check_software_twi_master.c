@@ -0,0 +1,120 @@
+/**
+ * EECE 387 Example Code
+ * Host check: the software TWI master's error handling.
+ *
+ * Runs the software ("bit-banged") TWI master against a deliberately troublesome
+ * device on the virtual AVR's pins (see host/check_software_twi_master.h), and checks
+ * that each failure is reported as the right TWIResult-- and that the bus is usable
+ * again afterwards. Reports each check over the UART, and exits with the number of
+ * checks that failed. Run with make host-check.
+ */
+
+#include <util/delay.h>
+
+#include "twi/software_master.h"
+#include "uart/stdio.h"
+#include "host/check_software_twi_master.h"
+
+static uint8_t failures = 0;
+
+
+/*
+ * Reports the outcome of a single check.
+ */
+static void check(uint8_t passed, const char * description) {
+
+  printf("%s: %s\n", passed ? "PASS" : "FAIL", description);
+
+  if(!passed) {
+    ++failures;
+  }
+}
+
+
+/*
+ * Reads a single byte from one of the device's registers.
+ */
+static uint8_t read_check_register(uint8_t check_register) {
+
+  uint8_t value = 0;
+
+  read_twi_register_block(CHECK_DEVICE_ADDRESS, check_register, &value, sizeof(value));
+  return value;
+}
+
+
+/*
+ * Checks that the bus works normally: by writing a byte to the device, and reading it back.
+ */
+static uint8_t bus_is_usable(uint8_t value) {
+
+  TWIResult result = write_twi_register_block(CHECK_DEVICE_ADDRESS, CheckData, &value, sizeof(value));
+  return (result == TWISuccess) && (read_check_register(CheckData) == value);
+}
+
+
+int main() {
+
+  uint8_t buffer[2] = { 0, 0 };
+  uint8_t refused[] = { 0x01, CHECK_REFUSED_BYTE };
+  uint8_t write_selects_before, write_selects_after;
+  TWIResult result;
+
+  TWITransaction read_only = { .address = CHECK_DEVICE_ADDRESS, .read_into = buffer, .read_length = 1 };
+  TWITransaction read_only_missing = { .address = CHECK_MISSING_ADDRESS, .read_into = buffer, .read_length = 1 };
+
+  set_up_stdio_over_serial();
+  set_up_twi_hardware(100000);
+
+  //Plain register writes and reads.
+  check(bus_is_usable(0x42), "a register can be written and read back");
+
+  //A device that refuses a byte.
+  result = write_twi_register_block(CHECK_DEVICE_ADDRESS, CheckData, refused, sizeof(refused));
+  check(result == TWIDataNotAcknowledged, "a refused byte is reported as TWIDataNotAcknowledged");
+
+  //A device that isn't there.
+  result = write_twi_register_block(CHECK_MISSING_ADDRESS, CheckData, buffer, 1);
+  check(result == TWIWriteAddressNotAcknowledged, "a missing device is reported as TWIWriteAddressNotAcknowledged");
+  check(!start_twi_write_to(CHECK_MISSING_ADDRESS), "start_twi_write_to returns false for a missing device");
+  end_twi_packet();
+  check(bus_is_usable(0x43), "the bus is usable after a missing device");
+
+  //A device that stretches the clock, for less time than the timeout.
+  result = read_twi_register_block(CHECK_DEVICE_ADDRESS, CheckSlow, buffer, 2);
+  check((result == TWISuccess) && (buffer[0] == CHECK_SLOW_BYTE) && (buffer[1] == CHECK_SLOW_BYTE),
+      "a read with a stretched clock succeeds");
+
+  //A device that holds the clock for far longer than the timeout. Once the device lets go, the bus should work again.
+  result = read_twi_register_block(CHECK_DEVICE_ADDRESS, CheckStalled, buffer, 1);
+  check(result == TWITimedOut, "a stalled clock is reported as TWITimedOut");
+  _delay_ms(CHECK_STALL_MILLISECONDS);
+  check(bus_is_usable(0x44), "the bus is usable after a stalled clock");
+
+  //A device left holding SDA low: we start reading a zero from the device, and then abandon the read,
+  //as a master reset mid-transfer would. The device is left waiting for clock pulses, which only
+  //the bus recovery will provide.
+  write_twi_register_block(CHECK_DEVICE_ADDRESS, CheckZeroes, 0, 0);
+  check(begin_twi_read_from(CHECK_DEVICE_ADDRESS) == TWISuccess, "the device acknowledges a read");
+  result = begin_twi_write_to(CHECK_DEVICE_ADDRESS);
+  check(result == TWITimedOut, "a start condition with SDA held low is reported as TWITimedOut");
+  end_twi_packet();
+  check(bus_is_usable(0x45), "the bus is usable after SDA has been held low");
+
+  //A transaction with nothing to write goes straight to its read phase, without addressing
+  //the device in write mode. We read the device's count of write-mode addresses, which
+  //includes the write that selected the register; it shouldn't change during the transaction.
+  write_selects_before = read_check_register(CheckWriteSelects);
+  result = perform_twi_transaction(&read_only);
+  write_selects_after = read_check_register(CheckWriteSelects);
+  check((result == TWISuccess) && (buffer[0] == write_selects_before) && (write_selects_after == write_selects_before + 1),
+      "a read-only transaction skips its write phase");
+
+  result = perform_twi_transaction(&read_only_missing);
+  check(result == TWIReadAddressNotAcknowledged, "a read-only transaction to a missing device is reported as TWIReadAddressNotAcknowledged");
+
+  printf("%u check(s) failed.\n", failures);
+  flush_uart();
+
+  return failures;
+}
@@ -0,0 +1,192 @@
+/**
+ * EECE 387 Example Code
+ * Host check: the TSL2561 driver's integer-only lux conversion.
+ *
+ * Compares tsl2561_lux against a floating-point reference-- the empirical formulas from
+ * the TSL2561 datasheet, which the integer algorithm approximates-- over a sweep of channel 0
+ * and channel 1 readings, for every integration time, gain and package. Fails if the relative
+ * error ever exceeds the limits documented for the integer algorithm:
+ *
+ *   - 2.4%, for ratios (channel 1 / channel 0) outside 0.8-1.3: mostly the piecewise-linear
+ *     approximation of the datasheet's ratio^1.4 term, plus rounding to whole lux;
+ *   - 8.6%, for ratios inside 0.8-1.3; where the formula nears zero lux, so small errors in
+ *     the coefficients-- or a ratio rounded into the neighbouring segment-- matter far more.
+ *
+ * Below 50 lux, rounding to whole lux dominates the relative error, so those readings are skipped.
+ * Reports each check over the UART, and exits with the number of checks that failed. Run with
+ * make host-check.
+ */
+
+#include <math.h>
+
+#include "sensors/tsl2561.h"
+#include "uart/stdio.h"
+
+//The error limits, in percent; see above.
+#define MAXIMUM_ERROR_OUTSIDE_BAND 2.4
+#define MAXIMUM_ERROR_INSIDE_BAND  8.6
+
+//The band of ratios in which the larger error is allowed.
+#define BAND_LOW  0.8
+#define BAND_HIGH 1.3
+
+//The smallest lux value whose error is checked.
+#define MINIMUM_CHECKED_LUX 50
+
+//The sweep: channel 0 readings grow geometrically by this factor, and for each, the ratio
+//is swept from zero to RATIO_SWEEP_LIMIT in steps of RATIO_SWEEP_STEP.
+#define CHANNEL0_SWEEP_FACTOR 1.01
+#define RATIO_SWEEP_STEP      0.001
+#define RATIO_SWEEP_LIMIT     1.4
+
+//The largest count each integration time can produce; and the factor which scales its
+//readings up to a 402ms integration.
+static const uint16_t maximum_counts[] = { 5047, 37177, 65535 };
+static const double integration_scales[] = { 322.0 / 11, 322.0 / 81, 1 };
+
+static const char * integration_names[] = { "13.7ms", "101ms", "402ms" };
+
+static uint8_t failures = 0;
+
+
+/*
+ * Reports the outcome of a single check.
+ */
+static void check(uint8_t passed, const char * description) {
+
+  printf("%s: %s\n", passed ? "PASS" : "FAIL", description);
+
+  if(!passed) {
+    ++failures;
+  }
+}
+
+
+/*
+ * Computes lux from a reading using the datasheet's floating-point formulas: the reference
+ * which tsl2561_lux approximates.
+ *
+ * @return The illuminance, in lux.
+ */
+static double reference_lux(TSL2561 * sensor, TSL2561Reading * reading) {
+
+  //Scale both channels up to what a 402ms integration, at 16x gain, would have read.
+  double scale = integration_scales[sensor->integration] * ((sensor->gain == TSL2561Gain1x) ? 16 : 1);
+  double channel0 = reading->broadband * scale;
+  double channel1 = reading->infrared * scale;
+  double ratio;
+
+  if(channel0 == 0) {
+    return 0;
+  }
+
+  ratio = channel1 / channel0;
+
+  if(sensor->package == TSL2561PackageCS) {
+    if(ratio <= 0.52) return 0.0315 * channel0 - 0.0593 * channel0 * pow(ratio, 1.4);
+    if(ratio <= 0.65) return 0.0229 * channel0 - 0.0291 * channel1;
+    if(ratio <= 0.80) return 0.0157 * channel0 - 0.0180 * channel1;
+    if(ratio <= 1.30) return 0.00338 * channel0 - 0.00260 * channel1;
+    return 0;
+  }
+
+  if(ratio <= 0.50) return 0.0304 * channel0 - 0.062 * channel0 * pow(ratio, 1.4);
+  if(ratio <= 0.61) return 0.0224 * channel0 - 0.031 * channel1;
+  if(ratio <= 0.80) return 0.0128 * channel0 - 0.0153 * channel1;
+  if(ratio <= 1.30) return 0.00146 * channel0 - 0.00112 * channel1;
+  return 0;
+}
+
+
+/*
+ * Sweeps readings for a single sensor configuration, and checks the worst relative error
+ * inside and outside of the band.
+ */
+static void check_configuration(TSL2561 * sensor) {
+
+  uint16_t maximum_count = maximum_counts[sensor->integration];
+  double worst_outside = 0, worst_inside = 0, channel0, ratio, reference, error;
+  TSL2561Reading reading, worst_outside_reading = { 0, 0 }, worst_inside_reading = { 0, 0 };
+  uint8_t saturation_detected;
+  char description[128];
+
+  for(channel0 = 1; channel0 < maximum_count; channel0 *= CHANNEL0_SWEEP_FACTOR) {
+    for(ratio = 0; ratio <= RATIO_SWEEP_LIMIT; ratio += RATIO_SWEEP_STEP) {
+
+      reading.broadband = channel0;
+      reading.infrared  = lround(channel0 * ratio);
+
+      //Saturated readings can't be converted; they're checked below.
+      if(reading.infrared >= maximum_count) {
+        break;
+      }
+
+      reference = reference_lux(sensor, &reading);
+
+      if(reference < MINIMUM_CHECKED_LUX) {
+        continue;
+      }
+
+      error = 100 * fabs(tsl2561_lux(sensor, &reading) - reference) / reference;
+
+      //Use the reading's actual ratio, which may differ slightly from the swept one.
+      if((reading.infrared > reading.broadband * BAND_LOW) && (reading.infrared <= reading.broadband * BAND_HIGH)) {
+        if(error > worst_inside) {
+          worst_inside = error;
+          worst_inside_reading = reading;
+        }
+      } else if(error > worst_outside) {
+        worst_outside = error;
+        worst_outside_reading = reading;
+      }
+    }
+  }
+
+  snprintf(description, sizeof(description), "%s package, %s, %ux gain: worst error %.2f%% at (%u, %u) outside the band",
+      (sensor->package == TSL2561PackageCS) ? "CS" : "T", integration_names[sensor->integration], (sensor->gain == TSL2561Gain1x) ? 1 : 16,
+      worst_outside, worst_outside_reading.broadband, worst_outside_reading.infrared);
+  check(worst_outside <= MAXIMUM_ERROR_OUTSIDE_BAND, description);
+
+  snprintf(description, sizeof(description), "%s package, %s, %ux gain: worst error %.2f%% at (%u, %u) inside the band",
+      (sensor->package == TSL2561PackageCS) ? "CS" : "T", integration_names[sensor->integration], (sensor->gain == TSL2561Gain1x) ? 1 : 16,
+      worst_inside, worst_inside_reading.broadband, worst_inside_reading.infrared);
+  check(worst_inside <= MAXIMUM_ERROR_INSIDE_BAND, description);
+
+  //Readings at the integration's maximum count are saturated, on either channel.
+  reading.broadband = maximum_count;
+  reading.infrared  = 0;
+  saturation_detected = (tsl2561_lux(sensor, &reading) == TSL2561_LUX_SATURATED);
+  reading.broadband = maximum_count - 1;
+  reading.infrared  = maximum_count;
+  saturation_detected &= (tsl2561_lux(sensor, &reading) == TSL2561_LUX_SATURATED);
+  check(saturation_detected, "saturated readings are reported as TSL2561_LUX_SATURATED");
+}
+
+
+int main() {
+
+  static const TSL2561Integration integrations[] = { TSL2561Integration13ms, TSL2561Integration101ms, TSL2561Integration402ms };
+  static const TSL2561Gain gains[] = { TSL2561Gain1x, TSL2561Gain16x };
+  static const TSL2561Package packages[] = { TSL2561PackageT, TSL2561PackageCS };
+
+  uint8_t i, j, k;
+
+  set_up_stdio_over_serial();
+
+  for(i = 0; i < sizeof(packages) / sizeof(packages[0]); ++i) {
+    for(j = 0; j < sizeof(integrations) / sizeof(integrations[0]); ++j) {
+      for(k = 0; k < sizeof(gains) / sizeof(gains[0]); ++k) {
+
+        TSL2561 sensor = TSL2561_SENSOR(TSL2561_ADDRESS_FLOAT, integrations[j], gains[k]);
+        sensor.package = packages[i];
+
+        check_configuration(&sensor);
+      }
+    }
+  }
+
+  printf("%u check(s) failed.\n", failures);
+  flush_uart();
+
+  return failures;
+}
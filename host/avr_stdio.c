@@ -0,0 +1,162 @@
+/*
+ * EECE 387 Example Code
+ * Virtual AVR: avr-libc compatible standard I/O.
+ *
+ * See avr_stdio.h.
+ */
+
+#define VIRTUAL_AVR_STDIO_IMPLEMENTATION
+
+#include "avr_stdio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+VirtualAVRFile * virtual_avr_stdin  = 0;
+VirtualAVRFile * virtual_avr_stdout = 0;
+VirtualAVRFile * virtual_avr_stderr = 0;
+
+
+/*
+ * Sends a single character to the given stream.
+ */
+int virtual_avr_fputc(int c, VirtualAVRFile * stream) {
+
+  //Like avr-libc, we quietly discard output to streams that can't accept it.
+  if(!stream || !stream->put) {
+    return EOF;
+  }
+
+  return stream->put(c, stream) ? EOF : (unsigned char)c;
+}
+
+
+/*
+ * Sends a string to the given stream.
+ */
+int virtual_avr_fputs(const char * string, VirtualAVRFile * stream) {
+
+  while(*string) {
+    virtual_avr_fputc(*string++, stream);
+  }
+
+  return 0;
+}
+
+
+/*
+ * Sends a string, followed by a newline, to the standard output.
+ */
+int virtual_avr_puts(const char * string) {
+  virtual_avr_fputs(string, virtual_avr_stdout);
+  return virtual_avr_fputc('\n', virtual_avr_stdout);
+}
+
+
+/*
+ * Sends a single character to the standard output.
+ */
+int virtual_avr_putchar(int c) {
+  return virtual_avr_fputc(c, virtual_avr_stdout);
+}
+
+
+/*
+ * Receives a single character from the given stream.
+ */
+int virtual_avr_fgetc(VirtualAVRFile * stream) {
+
+  if(!stream || !stream->get) {
+    return EOF;
+  }
+
+  return stream->get(stream);
+}
+
+
+/*
+ * Receives a single character from the standard input.
+ */
+int virtual_avr_getchar(void) {
+  return virtual_avr_fgetc(virtual_avr_stdin);
+}
+
+
+/*
+ * Sends formatted output to the given stream.
+ */
+int virtual_avr_vfprintf(VirtualAVRFile * stream, const char * format, va_list arguments) {
+
+  char buffer[256], * output = buffer;
+  va_list arguments_copy;
+  int length, i;
+
+  //Format the output using the host's C library; and then send it, one character at a
+  //time, just as avr-libc would.
+  va_copy(arguments_copy, arguments);
+  length = vsnprintf(buffer, sizeof(buffer), format, arguments_copy);
+  va_end(arguments_copy);
+
+  if(length < 0) {
+    return EOF;
+  }
+
+  //If the output didn't fit in our buffer, make a larger one.
+  if(length >= (int)sizeof(buffer)) {
+    output = malloc(length + 1);
+    if(!output) {
+      return EOF;
+    }
+    vsnprintf(output, length + 1, format, arguments);
+  }
+
+  for(i = 0; i < length; ++i) {
+    virtual_avr_fputc(output[i], stream);
+  }
+
+  if(output != buffer) {
+    free(output);
+  }
+
+  return length;
+}
+
+
+/*
+ * Sends formatted output to the given stream.
+ */
+int virtual_avr_fprintf(VirtualAVRFile * stream, const char * format, ...) {
+
+  va_list arguments;
+  int length;
+
+  va_start(arguments, format);
+  length = virtual_avr_vfprintf(stream, format, arguments);
+  va_end(arguments);
+
+  return length;
+}
+
+
+/*
+ * Sends formatted output to the standard output.
+ */
+int virtual_avr_vprintf(const char * format, va_list arguments) {
+  return virtual_avr_vfprintf(virtual_avr_stdout, format, arguments);
+}
+
+
+/*
+ * Sends formatted output to the standard output.
+ */
+int virtual_avr_printf(const char * format, ...) {
+
+  va_list arguments;
+  int length;
+
+  va_start(arguments, format);
+  length = virtual_avr_vfprintf(virtual_avr_stdout, format, arguments);
+  va_end(arguments);
+
+  return length;
+}
@@ -0,0 +1,100 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: avr-libc compatible standard I/O.
+ *
+ * Implements the parts of avr-libc's stdio used by the libraries and samples: streams
+ * created with FDEV_SETUP_STREAM, stdin/stdout/stderr, and the printf/puts families.
+ * When AVR code is built for the host, <stdio.h> maps the standard names (FILE, stdout,
+ * printf, ...) onto these, so it uses its own streams rather than the host's.
+ */
+
+#ifndef __VIRTUAL_AVR_AVR_STDIO_H__
+#define __VIRTUAL_AVR_AVR_STDIO_H__
+
+#include <stdarg.h>
+#include <inttypes.h>
+
+/**
+ * An avr-libc stream. Should be created with FDEV_SETUP_STREAM.
+ */
+struct VirtualAVRFile_struct {
+
+  /** Sends a single character; returns zero on success. */
+  int (*put)(char, struct VirtualAVRFile_struct *);
+
+  /** Receives a single character; returns the character, or EOF. */
+  int (*get)(struct VirtualAVRFile_struct *);
+
+  /** The stream's _FDEV_SETUP flags. */
+  uint8_t flags;
+
+  /** User data; see fdev_set_udata. */
+  void * udata;
+
+};
+typedef struct VirtualAVRFile_struct VirtualAVRFile;
+
+extern VirtualAVRFile * virtual_avr_stdin;
+extern VirtualAVRFile * virtual_avr_stdout;
+extern VirtualAVRFile * virtual_avr_stderr;
+
+int virtual_avr_fputc(int c, VirtualAVRFile * stream);
+int virtual_avr_fputs(const char * string, VirtualAVRFile * stream);
+int virtual_avr_puts(const char * string);
+int virtual_avr_putchar(int c);
+int virtual_avr_fgetc(VirtualAVRFile * stream);
+int virtual_avr_getchar(void);
+int virtual_avr_vfprintf(VirtualAVRFile * stream, const char * format, va_list arguments);
+int virtual_avr_fprintf(VirtualAVRFile * stream, const char * format, ...) __attribute__((format(printf, 2, 3)));
+int virtual_avr_printf(const char * format, ...) __attribute__((format(printf, 1, 2)));
+int virtual_avr_vprintf(const char * format, va_list arguments);
+
+//Map the standard names onto our own versions; except when we're implementing them.
+#ifndef VIRTUAL_AVR_STDIO_IMPLEMENTATION
+
+  #define _FDEV_SETUP_READ  0x01
+  #define _FDEV_SETUP_WRITE 0x02
+  #define _FDEV_SETUP_RW    (_FDEV_SETUP_READ | _FDEV_SETUP_WRITE)
+
+  #define FDEV_SETUP_STREAM(put_function, get_function, setup_flags) \
+    { .put = (put_function), .get = (get_function), .flags = (setup_flags), .udata = 0 }
+
+  #define fdev_set_udata(stream, user_data) ((stream)->udata = (user_data))
+  #define fdev_get_udata(stream) ((stream)->udata)
+
+  #define FILE VirtualAVRFile
+
+  #undef stdin
+  #undef stdout
+  #undef stderr
+  #define stdin  virtual_avr_stdin
+  #define stdout virtual_avr_stdout
+  #define stderr virtual_avr_stderr
+
+  #undef putc
+  #undef putchar
+  #undef getc
+  #undef getchar
+  #define fputc    virtual_avr_fputc
+  #define putc     virtual_avr_fputc
+  #define putchar  virtual_avr_putchar
+  #define fputs    virtual_avr_fputs
+  #define puts     virtual_avr_puts
+  #define fgetc    virtual_avr_fgetc
+  #define getc     virtual_avr_fgetc
+  #define getchar  virtual_avr_getchar
+  #define printf   virtual_avr_printf
+  #define vprintf  virtual_avr_vprintf
+  #define fprintf  virtual_avr_fprintf
+  #define vfprintf virtual_avr_vfprintf
+
+  //Program memory and RAM share an address space on the host.
+  #define printf_P   virtual_avr_printf
+  #define fprintf_P  virtual_avr_fprintf
+  #define vfprintf_P virtual_avr_vfprintf
+  #define puts_P     virtual_avr_puts
+  #define fputs_P    virtual_avr_fputs
+
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: the device used by check_software_twi_master.
+ *
+ * check_software_twi_master.c talks to a single, deliberately troublesome device on the
+ * bit-banged bus (see host/check_software_twi_master_hardware.c). The first byte of each
+ * write selects one of the device's registers, which stays selected until the next write;
+ * and each register misbehaves in its own way, so the check can lead the software master
+ * down each of its error paths. This header is shared by both sides of the check.
+ */
+
+#ifndef __VIRTUAL_AVR_CHECK_SOFTWARE_TWI_MASTER_H__
+#define __VIRTUAL_AVR_CHECK_SOFTWARE_TWI_MASTER_H__
+
+/**
+ * The address the device answers to; nothing answers CHECK_MISSING_ADDRESS.
+ */
+#define CHECK_DEVICE_ADDRESS  0x20
+#define CHECK_MISSING_ADDRESS 0x21
+
+/**
+ * The device refuses (NACKs) this byte, whenever it's written to a register.
+ */
+#define CHECK_REFUSED_BYTE 0xEE
+
+/**
+ * The device's registers.
+ */
+enum CheckRegister_enum {
+
+  /** An ordinary register: reads return the last byte written. */
+  CheckData = 0x01,
+
+  /** Reads return CHECK_SLOW_BYTE, but the device stretches the clock (briefly) before each one. */
+  CheckSlow = 0x02,
+
+  /** The device stretches the clock for CHECK_STALL_MILLISECONDS before each byte read; far longer than any timeout. */
+  CheckStalled = 0x03,
+
+  /** Reads return zero; so the device holds SDA low while it sends each byte. */
+  CheckZeroes = 0x04,
+
+  /** Reads return the number of times the device has been addressed in write mode (modulo 256). */
+  CheckWriteSelects = 0x05
+
+};
+
+/**
+ * The byte read from the CheckSlow register.
+ */
+#define CHECK_SLOW_BYTE 0x5A
+
+/**
+ * How long the device holds SCL low before each byte read from the CheckStalled register.
+ */
+#define CHECK_STALL_MILLISECONDS 100
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * EECE 387 Example Code
+ * Virtual AVR: the hardware for check_software_twi_master.
+ *
+ * Attaches the check's troublesome device (see check_software_twi_master.h) at
+ * CHECK_DEVICE_ADDRESS, with its SDA and SCL wired to PC4 and PC5: the software
+ * master's default bus.
+ */
+
+#include "virtual_avr.h"
+#include "run_sample.h"
+#include "check_software_twi_master.h"
+
+//The direction bit sent with the device's address, for a write.
+#define TW_WRITE 0
+
+//The register selected by the last write; and whether the next byte written selects a new one.
+static uint8_t selected_register = CheckData;
+static uint8_t selecting_register = 0;
+
+//The contents of the CheckData register, and the number of times we've been addressed to be written to.
+static uint8_t data_register = 0;
+static uint8_t write_selects = 0;
+
+
+/*
+ * Called when the master addresses the device.
+ */
+static uint8_t select_device(VirtualTWIDevice * device, uint8_t direction) {
+
+  (void)device;
+
+  if(direction == TW_WRITE) {
+    ++write_selects;
+    selecting_register = 1;
+  }
+
+  return 1;
+}
+
+
+/*
+ * Called for each byte the master writes: the first selects a register, and the rest are written to it.
+ */
+static uint8_t write_to_device(VirtualTWIDevice * device, uint8_t data) {
+
+  (void)device;
+
+  if(data == CHECK_REFUSED_BYTE) {
+    return 0;
+  }
+
+  if(selecting_register) {
+    selected_register  = data;
+    selecting_register = 0;
+  } else if(selected_register == CheckData) {
+    data_register = data;
+  }
+
+  return 1;
+}
+
+
+/*
+ * Called for each byte the master reads, from the selected register.
+ */
+static uint8_t read_from_device(VirtualTWIDevice * device) {
+
+  (void)device;
+
+  switch(selected_register) {
+
+    case CheckData:
+      return data_register;
+
+    case CheckSlow:
+      stretch_virtual_twi_clock(400);
+      return CHECK_SLOW_BYTE;
+
+    case CheckStalled:
+      stretch_virtual_twi_clock(virtual_avr_seconds(CHECK_STALL_MILLISECONDS / 1000.0));
+      return 0xFF;
+
+    case CheckZeroes:
+      return 0x00;
+
+    case CheckWriteSelects:
+      return write_selects;
+
+    default:
+      return 0xFF;
+  }
+}
+
+
+static VirtualTWIDevice check_device = {
+  .address = CHECK_DEVICE_ADDRESS,
+  .select  = select_device,
+  .write   = write_to_device,
+  .read    = read_from_device
+};
+
+
+void set_up_sample_hardware() {
+  attach_virtual_twi_device(&check_device);
+  connect_virtual_twi_pins(VirtualPortC, 4, 5);
+}
@@ -0,0 +1,21 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: interrupt handling.
+ *
+ * Stands in for avr-libc's <avr/interrupt.h> on the host. Interrupt handlers are
+ * ordinary functions, named after their vectors, which the virtual AVR calls 
+ * whenever their interrupts would fire.
+ */
+
+#ifndef __VIRTUAL_AVR_INTERRUPT_H__
+#define __VIRTUAL_AVR_INTERRUPT_H__
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) void vector(void); void vector(void)
+#define EMPTY_INTERRUPT(vector) void vector(void); void vector(void) { }
+
+#define sei() (SREG |= _BV(SREG_I))
+#define cli() (SREG &= ~_BV(SREG_I))
+
+#endif
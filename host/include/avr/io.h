@@ -0,0 +1,200 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: register definitions for the ATmega328P.
+ *
+ * Stands in for avr-libc's <avr/io.h> when the libraries are built for the host
+ * machine (see host/virtual_avr.h). Each register lives at its usual data-space
+ * address in a simulated register file; accessing one lets the simulated peripherals
+ * react, exactly as the real hardware would.
+ */
+
+#ifndef __VIRTUAL_AVR_IO_H__
+#define __VIRTUAL_AVR_IO_H__
+
+#include <inttypes.h>
+
+/**
+ * Provides access to the simulated register at the given data-space address.
+ * Defined in host/virtual_avr.c.
+ */
+volatile uint8_t * virtual_avr_register(uint16_t address);
+
+/**
+ * Finds the data-space address of the given register; e.g. _SFR_MEM_ADDR(PORTB) is 0x25.
+ * Defined in host/virtual_avr.c. Unlike avr-libc's version, this isn't a constant, as the
+ * simulated register file doesn't have a fixed address.
+ */
+uint16_t virtual_avr_register_address(volatile uint8_t * reg);
+
+#define _SFR_MEM8(address) (*virtual_avr_register(address))
+#define _SFR_MEM_ADDR(sfr) virtual_avr_register_address(&(sfr))
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(register, bit)   ((register) & _BV(bit))
+#define bit_is_clear(register, bit) (!((register) & _BV(bit)))
+#define loop_until_bit_is_set(register, bit)   do { } while(bit_is_clear(register, bit))
+#define loop_until_bit_is_clear(register, bit) do { } while(bit_is_set(register, bit))
+
+/* Ports B, C, and D */
+#define PINB  _SFR_MEM8(0x23)
+#define DDRB  _SFR_MEM8(0x24)
+#define PORTB _SFR_MEM8(0x25)
+#define PINC  _SFR_MEM8(0x26)
+#define DDRC  _SFR_MEM8(0x27)
+#define PORTC _SFR_MEM8(0x28)
+#define PIND  _SFR_MEM8(0x29)
+#define DDRD  _SFR_MEM8(0x2A)
+#define PORTD _SFR_MEM8(0x2B)
+
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+/* Timer/counter 0 */
+#define TIFR0  _SFR_MEM8(0x35)
+#define TCCR0A _SFR_MEM8(0x44)
+#define TCCR0B _SFR_MEM8(0x45)
+#define TCNT0  _SFR_MEM8(0x46)
+#define OCR0A  _SFR_MEM8(0x47)
+#define OCR0B  _SFR_MEM8(0x48)
+#define TIMSK0 _SFR_MEM8(0x6E)
+
+#define TOV0  0
+#define OCF0A 1
+#define OCF0B 2
+
+#define WGM00  0
+#define WGM01  1
+#define COM0B0 4
+#define COM0B1 5
+#define COM0A0 6
+#define COM0A1 7
+
+#define CS00  0
+#define CS01  1
+#define CS02  2
+#define WGM02 3
+#define FOC0B 6
+#define FOC0A 7
+
+#define TOIE0  0
+#define OCIE0A 1
+#define OCIE0B 2
+
+/* Sleep mode control */
+#define SMCR _SFR_MEM8(0x53)
+
+#define SE  0
+#define SM0 1
+#define SM1 2
+#define SM2 3
+
+/* Pin change interrupts */
+#define PCIFR  _SFR_MEM8(0x3B)
+#define PCICR  _SFR_MEM8(0x68)
+#define PCMSK0 _SFR_MEM8(0x6B)
+#define PCMSK1 _SFR_MEM8(0x6C)
+#define PCMSK2 _SFR_MEM8(0x6D)
+
+#define PCIF0 0
+#define PCIF1 1
+#define PCIF2 2
+
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+
+/* Status register */
+#define SREG _SFR_MEM8(0x5F)
+
+#define SREG_C 0
+#define SREG_Z 1
+#define SREG_N 2
+#define SREG_V 3
+#define SREG_S 4
+#define SREG_H 5
+#define SREG_T 6
+#define SREG_I 7
+
+/* Two Wire Interface */
+#define TWBR  _SFR_MEM8(0xB8)
+#define TWSR  _SFR_MEM8(0xB9)
+#define TWAR  _SFR_MEM8(0xBA)
+#define TWDR  _SFR_MEM8(0xBB)
+#define TWCR  _SFR_MEM8(0xBC)
+#define TWAMR _SFR_MEM8(0xBD)
+
+#define TWPS0 0
+#define TWPS1 1
+#define TWS3  3
+#define TWS4  4
+#define TWS5  5
+#define TWS6  6
+#define TWS7  7
+
+#define TWIE  0
+#define TWEN  2
+#define TWWC  3
+#define TWSTO 4
+#define TWSTA 5
+#define TWEA  6
+#define TWINT 7
+
+/* USART0 */
+#define UCSR0A _SFR_MEM8(0xC0)
+#define UCSR0B _SFR_MEM8(0xC1)
+#define UCSR0C _SFR_MEM8(0xC2)
+#define UBRR0L _SFR_MEM8(0xC4)
+#define UBRR0H _SFR_MEM8(0xC5)
+#define UDR0   _SFR_MEM8(0xC6)
+
+#define MPCM0 0
+#define U2X0  1
+#define UPE0  2
+#define DOR0  3
+#define FE0   4
+#define UDRE0 5
+#define TXC0  6
+#define RXC0  7
+
+#define TXB80  0
+#define RXB80  1
+#define UCSZ02 2
+#define TXEN0  3
+#define RXEN0  4
+#define UDRIE0 5
+#define TXCIE0 6
+#define RXCIE0 7
+
+#define UCPOL0  0
+#define UCSZ00  1
+#define UCSZ01  2
+#define USBS0   3
+#define UPM00   4
+#define UPM01   5
+#define UMSEL00 6
+#define UMSEL01 7
+
+#endif
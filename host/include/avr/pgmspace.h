@@ -0,0 +1,27 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: program memory access.
+ *
+ * Stands in for avr-libc's <avr/pgmspace.h> on the host, where program memory 
+ * and RAM share a single address space.
+ */
+
+#ifndef __VIRTUAL_AVR_PGMSPACE_H__
+#define __VIRTUAL_AVR_PGMSPACE_H__
+
+#include <inttypes.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(string) (string)
+
+#define pgm_read_byte(address)  (*(const uint8_t *)(address))
+#define pgm_read_word(address)  (*(const uint16_t *)(address))
+#define pgm_read_dword(address) (*(const uint32_t *)(address))
+
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define memcpy_P memcpy
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: sleep modes.
+ *
+ * Stands in for avr-libc's <avr/sleep.h> on the host. Sleeping lets simulated time pass
+ * until an interrupt fires, without running any AVR code; see virtual_avr_sleep. Every
+ * sleep mode is treated as idle mode: any interrupt wakes the CPU.
+ */
+
+#ifndef __VIRTUAL_AVR_SLEEP_H__
+#define __VIRTUAL_AVR_SLEEP_H__
+
+#include <avr/io.h>
+
+void virtual_avr_sleep(void);
+
+#define SLEEP_MODE_IDLE         (0x00 << 1)
+#define SLEEP_MODE_ADC          (0x01 << 1)
+#define SLEEP_MODE_PWR_DOWN     (0x02 << 1)
+#define SLEEP_MODE_PWR_SAVE     (0x03 << 1)
+#define SLEEP_MODE_STANDBY      (0x06 << 1)
+#define SLEEP_MODE_EXT_STANDBY  (0x07 << 1)
+
+#define set_sleep_mode(mode) (SMCR = (SMCR & ~(_BV(SM0) | _BV(SM1) | _BV(SM2))) | (mode))
+#define sleep_enable()  (SMCR |= _BV(SE))
+#define sleep_disable() (SMCR &= ~_BV(SE))
+#define sleep_cpu()     virtual_avr_sleep()
+#define sleep_mode()    do { sleep_enable(); sleep_cpu(); sleep_disable(); } while(0)
+
+#endif
@@ -0,0 +1,13 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: TWI compatibility header.
+ *
+ * Stands in for avr-libc's <compat/twi.h> on the host.
+ */
+
+#ifndef __VIRTUAL_AVR_COMPAT_TWI_H__
+#define __VIRTUAL_AVR_COMPAT_TWI_H__
+
+#include <util/twi.h>
+
+#endif
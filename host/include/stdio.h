@@ -0,0 +1,17 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: standard I/O.
+ *
+ * Stands in for avr-libc's <stdio.h> on the host. avr-libc's streams are built
+ * around a pair of put/get functions (see FDEV_SETUP_STREAM), which the host's C 
+ * library doesn't support; so AVR code gets its own FILE type, and its own stdio 
+ * functions, which behave like avr-libc's. See host/avr_stdio.h.
+ */
+
+#ifndef __VIRTUAL_AVR_STDIO_H__
+#define __VIRTUAL_AVR_STDIO_H__
+
+#include_next <stdio.h>
+#include "../avr_stdio.h"
+
+#endif
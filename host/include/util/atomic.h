@@ -0,0 +1,23 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: atomic blocks.
+ *
+ * Stands in for avr-libc's <util/atomic.h> on the host; works in the same way,
+ * by clearing the simulated I-bit for the duration of the block.
+ */
+
+#ifndef __VIRTUAL_AVR_ATOMIC_H__
+#define __VIRTUAL_AVR_ATOMIC_H__
+
+#include <avr/interrupt.h>
+
+static inline uint8_t __iCliRetVal(void) { cli(); return 1; }
+static inline void __iSeiParam(const uint8_t * __s) { (void)__s; sei(); }
+static inline void __iRestore(const uint8_t * __s) { SREG = *__s; }
+
+#define ATOMIC_RESTORESTATE uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define ATOMIC_FORCEON      uint8_t sreg_save __attribute__((__cleanup__(__iSeiParam))) = 0
+
+#define ATOMIC_BLOCK(type) for(type, __ToDo = __iCliRetVal(); __ToDo; __ToDo = 0)
+
+#endif
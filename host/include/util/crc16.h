@@ -0,0 +1,56 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: CRC computations.
+ *
+ * Stands in for avr-libc's <util/crc16.h> on the host. These are the C equivalents
+ * given in the avr-libc documentation, so they produce identical results.
+ */
+
+#ifndef __VIRTUAL_AVR_CRC16_H__
+#define __VIRTUAL_AVR_CRC16_H__
+
+#include <inttypes.h>
+
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t data) {
+
+  int i;
+
+  crc ^= data;
+  for(i = 0; i < 8; ++i) {
+    crc = (crc & 1) ? ((crc >> 1) ^ 0xA001) : (crc >> 1);
+  }
+
+  return crc;
+}
+
+static inline uint16_t _crc_xmodem_update(uint16_t crc, uint8_t data) {
+
+  int i;
+
+  crc = crc ^ ((uint16_t)data << 8);
+  for(i = 0; i < 8; ++i) {
+    crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+  }
+
+  return crc;
+}
+
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data) {
+  data ^= crc & 0xFF;
+  data ^= data << 4;
+  return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+
+static inline uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data) {
+
+  int i;
+
+  crc = crc ^ data;
+  for(i = 0; i < 8; ++i) {
+    crc = (crc & 0x01) ? ((crc >> 1) ^ 0x8C) : (crc >> 1);
+  }
+
+  return crc;
+}
+
+#endif
@@ -0,0 +1,23 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: busy-wait delays.
+ *
+ * Stands in for avr-libc's <util/delay.h> on the host. Rather than actually waiting,
+ * each delay advances the virtual AVR's clock; interrupts still fire during the delay.
+ */
+
+#ifndef __VIRTUAL_AVR_DELAY_H__
+#define __VIRTUAL_AVR_DELAY_H__
+
+#include <inttypes.h>
+
+/**
+ * Advances the virtual AVR's clock by the given number of CPU cycles. 
+ * Defined in host/virtual_avr.c.
+ */
+void virtual_avr_delay_cycles(uint64_t cycles);
+
+#define _delay_ms(milliseconds)  virtual_avr_delay_cycles((uint64_t)((double)(milliseconds) * (F_CPU) / 1e3))
+#define _delay_us(microseconds)  virtual_avr_delay_cycles((uint64_t)((double)(microseconds) * (F_CPU) / 1e6))
+
+#endif
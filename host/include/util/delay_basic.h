@@ -0,0 +1,18 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: counted delay loops.
+ *
+ * Stands in for avr-libc's <util/delay_basic.h> on the host; see <util/delay.h>.
+ */
+
+#ifndef __VIRTUAL_AVR_DELAY_BASIC_H__
+#define __VIRTUAL_AVR_DELAY_BASIC_H__
+
+#include <util/delay.h>
+
+//Each iteration of _delay_loop_1 takes three cycles, and each of _delay_loop_2 takes four;
+//a count of zero means 256 (or 65536) iterations.
+#define _delay_loop_1(count) virtual_avr_delay_cycles(3 * ((uint8_t)(count)  ? (uint8_t)(count)  : 256))
+#define _delay_loop_2(count) virtual_avr_delay_cycles(4 * ((uint16_t)(count) ? (uint16_t)(count) : 65536))
+
+#endif
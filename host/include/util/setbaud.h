@@ -0,0 +1,51 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: compile-time baud rate computation.
+ *
+ * Stands in for avr-libc's <util/setbaud.h> on the host; computes UBRR_VALUE,
+ * UBRRH_VALUE, UBRRL_VALUE and USE_2X from F_CPU, BAUD and BAUD_TOL in the same way.
+ */
+
+#ifndef __VIRTUAL_AVR_SETBAUD_H__
+#define __VIRTUAL_AVR_SETBAUD_H__
+
+#ifndef F_CPU
+  #error "setbaud.h requires F_CPU to be defined"
+#endif
+
+#ifndef BAUD
+  #error "setbaud.h requires BAUD to be defined"
+#endif
+
+#ifndef BAUD_TOL
+  #define BAUD_TOL 2
+#endif
+
+#define UBRR_VALUE (((F_CPU) + 8UL * (BAUD)) / (16UL * (BAUD)) - 1UL)
+
+//Use double speed only if normal speed can't get within BAUD_TOL percent of the requested rate.
+#if 100 * (F_CPU) > (16 * ((UBRR_VALUE) + 1)) * (100 * (BAUD) + (BAUD) * (BAUD_TOL))
+  #define USE_2X 1
+#elif 100 * (F_CPU) < (16 * ((UBRR_VALUE) + 1)) * (100 * (BAUD) - (BAUD) * (BAUD_TOL))
+  #define USE_2X 1
+#else
+  #define USE_2X 0
+#endif
+
+#if USE_2X
+  #undef UBRR_VALUE
+  #define UBRR_VALUE (((F_CPU) + 4UL * (BAUD)) / (8UL * (BAUD)) - 1UL)
+
+  #if 100 * (F_CPU) > (8 * ((UBRR_VALUE) + 1)) * (100 * (BAUD) + (BAUD) * (BAUD_TOL))
+    #warning "Baud rate achieved is higher than allowed"
+  #endif
+
+  #if 100 * (F_CPU) < (8 * ((UBRR_VALUE) + 1)) * (100 * (BAUD) - (BAUD) * (BAUD_TOL))
+    #warning "Baud rate achieved is lower than allowed"
+  #endif
+#endif
+
+#define UBRRL_VALUE (UBRR_VALUE & 0xff)
+#define UBRRH_VALUE (UBRR_VALUE >> 8)
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * EECE 387 Example Code
+ * Virtual AVR: runs a sample program on the host.
+ *
+ * The sample is compiled with -Dmain=avr_main, and linked against this file and the
+ * virtual AVR. Since the samples loop forever, the run is limited to a number of seconds
+ * of simulated time, which can be given on the command line:
+ *
+ *   host/sample_uart_stdio 10
+ *
+ * Everything the sample sends over the UART appears on the standard output.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "virtual_avr.h"
+#include "run_sample.h"
+
+//The number of seconds (of simulated time) each sample runs for, by default.
+#define DEFAULT_RUN_TIME 5
+
+//The sample's main function.
+int avr_main(void);
+
+
+/*
+ * Prints a summary of the sample's TWI bus usage, and of its CPU's sleep, to the standard error.
+ */
+void report_twi_bus_usage(uint32_t readings, uint32_t stale_readings) {
+
+  VirtualTWIStatistics statistics = virtual_twi_statistics();
+  double busy_microseconds     = statistics.busy_cycles * 1e6 / F_CPU;
+  double elapsed_microseconds  = virtual_avr_cycles() * 1e6 / F_CPU;
+  double sleeping_microseconds = virtual_avr_sleeping_cycles() * 1e6 / F_CPU;
+
+  fflush(stdout);
+  fprintf(stderr, "TWI bus: %u transactions (%.1f per second), %u bytes; busy for %.1fms of %.1fms (%.2f%% utilization)\n",
+      (unsigned)statistics.transactions, statistics.transactions * 1e6 / elapsed_microseconds, (unsigned)statistics.bytes, 
+      busy_microseconds / 1000, elapsed_microseconds / 1000, 100 * busy_microseconds / elapsed_microseconds);
+
+  if(readings) {
+    fprintf(stderr, "TWI bus: %u readings (%u stale); %.1f transactions and %.1fus of bus time per reading\n", 
+        (unsigned)readings, (unsigned)stale_readings, (double)statistics.transactions / readings, busy_microseconds / readings);
+  }
+
+  fprintf(stderr, "CPU: asleep for %.1fms of %.1fms (%.2f%%)\n",
+      sleeping_microseconds / 1000, elapsed_microseconds / 1000, 100 * sleeping_microseconds / elapsed_microseconds);
+}
+
+
+int main(int argc, char ** argv) {
+
+  double run_time = (argc > 1) ? atof(argv[1]) : DEFAULT_RUN_TIME;
+
+  if(set_up_sample_hardware) {
+    set_up_sample_hardware();
+  }
+
+  set_virtual_avr_time_limit(virtual_avr_seconds(run_time));
+  return avr_main();
+}
@@ -0,0 +1,32 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: runs a sample program on the host.
+ *
+ * Each sample is linked against run_sample.c, which provides main(); and, optionally, a
+ * file which provides set_up_sample_hardware, and attaches the simulated devices the
+ * sample talks to (e.g. host/sample_twi_tcs34725_hardware.c).
+ */
+
+#ifndef __VIRTUAL_AVR_RUN_SAMPLE_H__
+#define __VIRTUAL_AVR_RUN_SAMPLE_H__
+
+#include <inttypes.h>
+
+/**
+ * Sets up the simulated hardware the sample talks to; called just before the sample starts.
+ * Samples which only need the AVR itself don't need to provide this.
+ */
+void set_up_sample_hardware(void) __attribute__((weak));
+
+/**
+ * Prints a summary of the sample's TWI bus usage, and of how long the CPU spent asleep, to
+ * the standard error, where it won't be mixed up with the sample's UART output. Intended to
+ * be called when the run ends (e.g. via atexit).
+ *
+ * @param readings The number of sensor readings the sample fetched; used to report the
+ *    bus time spent per reading.
+ * @param stale_readings The number of those readings which had already been fetched before.
+ */
+void report_twi_bus_usage(uint32_t readings, uint32_t stale_readings);
+
+#endif
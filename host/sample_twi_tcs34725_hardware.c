@@ -0,0 +1,32 @@
+/*
+ * EECE 387 Example Code
+ * Virtual AVR: the hardware for sample_twi_tcs34725.
+ *
+ * Attaches a simulated TCS34725, in ordinary (slightly warm) indoor light, with its
+ * INT output connected to PD2. Its SDA and SCL are wired to PC4 and PC5, too, so the
+ * sample can also be built with the software TWI master. Reports the sample's bus
+ * usage once it's finished.
+ */
+
+#include <stdlib.h>
+
+#include "run_sample.h"
+#include "tcs34725_model.h"
+
+static VirtualTCS34725 sensor = {
+  .clear_light = 900,
+  .red_light   = 350,
+  .green_light = 300,
+  .blue_light  = 250
+};
+
+static void report_usage() {
+  report_twi_bus_usage(sensor.readings, sensor.stale_readings);
+}
+
+void set_up_sample_hardware() {
+  attach_virtual_tcs34725(&sensor);
+  connect_virtual_tcs34725_interrupt(&sensor, VirtualPortD, 2);
+  connect_virtual_twi_pins(VirtualPortC, 4, 5);
+  atexit(report_usage);
+}
@@ -0,0 +1,30 @@
+/*
+ * EECE 387 Example Code
+ * Virtual AVR: the hardware for sample_twi_tsl2561.
+ *
+ * Attaches a simulated TSL2561 at address 0x39 (ADDR SEL floating), in ordinary
+ * indoor light, with its INT output connected to PD3. Its SDA and SCL are wired to PC4
+ * and PC5, too, so the sample can also be built with the software TWI master. Reports
+ * the sample's bus usage once it's finished.
+ */
+
+#include <stdlib.h>
+
+#include "run_sample.h"
+#include "tsl2561_model.h"
+
+static VirtualTSL2561 sensor = {
+  .broadband_light = 1200,
+  .infrared_light  = 300
+};
+
+static void report_usage() {
+  report_twi_bus_usage(sensor.readings, sensor.stale_readings);
+}
+
+void set_up_sample_hardware() {
+  attach_virtual_tsl2561(&sensor, 0x39);
+  connect_virtual_tsl2561_interrupt(&sensor, VirtualPortD, 3);
+  connect_virtual_twi_pins(VirtualPortC, 4, 5);
+  atexit(report_usage);
+}
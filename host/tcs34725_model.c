@@ -0,0 +1,419 @@
+/*
+ * EECE 387 Example Code
+ * Virtual AVR: a simulated TCS34725 color sensor.
+ *
+ * See tcs34725_model.h.
+ */
+
+#include "tcs34725_model.h"
+
+//The bits of the command register.
+#define COMMAND_BIT           0x80
+#define TYPE_MASK             0x60
+#define AUTO_INCREMENT        0x20
+#define SPECIAL_FUNCTION      0x60
+#define REGISTER_MASK         0x1F
+#define CLEAR_INTERRUPT       0x06
+
+//The bits of the enable, configuration, control and status registers.
+#define POWER_ON              0x01
+#define ADC_ENABLE            0x02
+#define WAIT_ENABLE           0x08
+#define INTERRUPT_ENABLE      0x10
+#define WAIT_LONG             0x02
+#define GAIN_MASK             0x03
+#define PERSISTENCE_MASK      0x0F
+#define DATA_VALID            0x01
+#define INTERRUPT_PENDING     0x10
+
+//The direction bit sent with the device's address, for a read.
+#define TW_READ 1
+
+//The length of the ADC's initialization, and of each of its integration and wait steps: 2.4ms.
+#define STEP_CYCLES ((uint64_t)F_CPU * 24 / 10000)
+
+//The gain selected by each value of the control register's AGAIN field.
+static const uint8_t gains[] = { 1, 4, 16, 60 };
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+/*
+ * @return True iff the sensor's ADC is running.
+ */
+static uint8_t is_running(VirtualTCS34725 * sensor) {
+  return (sensor->registers[TCS34725Enable] & (POWER_ON | ADC_ENABLE)) == (POWER_ON | ADC_ENABLE);
+}
+
+
+/*
+ * @return The number of 2.4ms steps in each integration, as set by ATIME.
+ */
+static uint16_t integration_steps(VirtualTCS34725 * sensor) {
+  return 256 - sensor->registers[TCS34725IntegrationTime];
+}
+
+
+/*
+ * @return The number of 2.4ms steps spent waiting between integrations, as set by WEN, WTIME and WLONG.
+ */
+static uint16_t wait_steps(VirtualTCS34725 * sensor) {
+
+  uint16_t steps = 256 - sensor->registers[TCS34725WaitTime];
+
+  if(!(sensor->registers[TCS34725Enable] & WAIT_ENABLE)) {
+    return 0;
+  }
+
+  return (sensor->registers[TCS34725Configuration] & WAIT_LONG) ? steps * 12 : steps;
+}
+
+
+/*
+ * Starts a new ADC cycle, now: an initialization, followed by an integration.
+ */
+static void restart_integration(VirtualTCS34725 * sensor) {
+  sensor->integration_ends_at = virtual_avr_cycles() + (1 + integration_steps(sensor)) * STEP_CYCLES;
+}
+
+
+/*
+ * @return The count produced by the given amount of light, with the sensor's current settings.
+ */
+static uint16_t count_for_light(VirtualTCS34725 * sensor, uint32_t light) {
+
+  uint64_t count         = (uint64_t)light * integration_steps(sensor) * gains[sensor->registers[TCS34725Control] & GAIN_MASK];
+  uint64_t maximum_count = 1024UL * integration_steps(sensor);
+
+  //Like the real device, saturate, rather than overflowing.
+  if(maximum_count > 65535) {
+    maximum_count = 65535;
+  }
+
+  return (count > maximum_count) ? maximum_count : count;
+}
+
+
+/*
+ * Stores a reading of the given amount of light in the data registers for the given channel.
+ */
+static void store_reading(VirtualTCS34725 * sensor, uint8_t channel, uint32_t light) {
+
+  uint16_t count = count_for_light(sensor, light);
+
+  sensor->registers[TCS34725ClearLow + (channel * 2)]     = count & 0xFF;
+  sensor->registers[TCS34725ClearLow + (channel * 2) + 1] = count >> 8;
+}
+
+
+/*
+ * @return The number of consecutive out-of-range readings needed to raise an interrupt, as
+ *    set by the persistence register; or 0, if every reading raises an interrupt.
+ */
+static uint8_t readings_needed_for_interrupt(VirtualTCS34725 * sensor) {
+
+  uint8_t persistence = sensor->registers[TCS34725Persistence] & PERSISTENCE_MASK;
+
+  //The first few settings count readings directly; the rest count in fives.
+  return (persistence <= 3) ? persistence : (persistence - 3) * 5;
+}
+
+
+/*
+ * Updates the INT output, if it's connected: it pulls its pin low while the RGBC interrupt is raised.
+ */
+static void update_interrupt_output(VirtualTCS34725 * sensor) {
+
+  if(!sensor->interrupt_connected) {
+    return;
+  }
+
+  if(sensor->registers[TCS34725Status] & INTERRUPT_PENDING) {
+    drive_virtual_pin(sensor->interrupt_port, sensor->interrupt_bit, 0);
+  } else {
+    release_virtual_pin(sensor->interrupt_port, sensor->interrupt_bit);
+  }
+}
+
+
+/*
+ * Raises the RGBC interrupt, if the given number of new readings (of the current light)
+ * should do so: either on every reading, or once enough consecutive readings of the clear
+ * channel have been outside the interrupt thresholds.
+ */
+static void update_interrupt(VirtualTCS34725 * sensor, uint64_t new_readings) {
+
+  uint16_t clear          = sensor->registers[TCS34725ClearLow] | (sensor->registers[TCS34725ClearLow + 1] << 8);
+  uint16_t low_threshold  = sensor->registers[TCS34725ThresholdLowL]  | (sensor->registers[TCS34725ThresholdLowH]  << 8);
+  uint16_t high_threshold = sensor->registers[TCS34725ThresholdHighL] | (sensor->registers[TCS34725ThresholdHighH] << 8);
+  uint8_t readings_needed = readings_needed_for_interrupt(sensor);
+
+  if((clear < low_threshold) || (clear > high_threshold)) {
+    sensor->out_of_range_readings += new_readings;
+  } else {
+    sensor->out_of_range_readings = 0;
+  }
+
+  if(!(sensor->registers[TCS34725Enable] & INTERRUPT_ENABLE)) {
+    return;
+  }
+
+  if(!readings_needed || (sensor->out_of_range_readings >= readings_needed)) {
+    sensor->registers[TCS34725Status] |= INTERRUPT_PENDING;
+    update_interrupt_output(sensor);
+  }
+}
+
+
+/*
+ * Brings the sensor's readings up to date: if an integration has finished since we last
+ * checked, stores the new readings in the data registers.
+ */
+static void update_readings(VirtualTCS34725 * sensor) {
+
+  uint64_t now = virtual_avr_cycles();
+  uint64_t cycle_length, new_readings;
+
+  if(!is_running(sensor) || (now < sensor->integration_ends_at)) {
+    return;
+  }
+
+  //The ADC runs continuously; so skip ahead to the integration that's currently underway.
+  cycle_length = (1 + integration_steps(sensor) + wait_steps(sensor)) * STEP_CYCLES;
+  new_readings = (now - sensor->integration_ends_at) / cycle_length + 1;
+  sensor->integration_ends_at += new_readings * cycle_length;
+
+  store_reading(sensor, 0, sensor->clear_light);
+  store_reading(sensor, 1, sensor->red_light);
+  store_reading(sensor, 2, sensor->green_light);
+  store_reading(sensor, 3, sensor->blue_light);
+
+  sensor->registers[TCS34725Status] |= DATA_VALID;
+  sensor->reading_fetched = 0;
+  update_interrupt(sensor, new_readings);
+}
+
+
+/*
+ * Moves on to the next register, if the last command asked us to.
+ */
+static void advance_register(VirtualTCS34725 * sensor) {
+  if((sensor->command & TYPE_MASK) == AUTO_INCREMENT) {
+    sensor->command = (sensor->command & ~REGISTER_MASK) | ((sensor->command + 1) & REGISTER_MASK);
+  }
+}
+
+
+/*
+ * Called when the master addresses the sensor.
+ */
+static uint8_t select_sensor(VirtualTWIDevice * device, uint8_t direction) {
+
+  VirtualTCS34725 * sensor = device->context;
+
+  //Each write starts with a command byte. Reads continue from the last register addressed.
+  sensor->awaiting_command = (direction != TW_READ);
+  return 1;
+}
+
+
+/*
+ * Called for each byte the master writes to the sensor.
+ */
+static uint8_t write_to_sensor(VirtualTWIDevice * device, uint8_t data) {
+
+  VirtualTCS34725 * sensor = device->context;
+  uint8_t address, was_running;
+
+  update_readings(sensor);
+
+  //Handle command bytes. Every command must have its CMD bit set; we refuse any that don't,
+  //so mistakes show up as NACKs.
+  if(sensor->awaiting_command) {
+
+    if(!(data & COMMAND_BIT)) {
+      return 0;
+    }
+
+    sensor->awaiting_command = 0;
+
+    //Special functions (e.g. clearing the RGBC interrupt) don't address a register; so
+    //the register being accessed stays the same.
+    if((data & TYPE_MASK) != SPECIAL_FUNCTION) {
+      sensor->command = data;
+    } else if((data & REGISTER_MASK) == CLEAR_INTERRUPT) {
+      sensor->registers[TCS34725Status] &= ~INTERRUPT_PENDING;
+      update_interrupt_output(sensor);
+    }
+
+    return 1;
+  }
+
+  //Handle writes to the register file.
+  address = sensor->command & REGISTER_MASK;
+
+  switch(address) {
+
+    //Starting the ADC starts its first cycle.
+    case TCS34725Enable:
+      was_running = is_running(sensor);
+      sensor->registers[address] = data & 0x1B;
+
+      if(is_running(sensor) && !was_running) {
+        sensor->registers[TCS34725Status] &= ~DATA_VALID;
+        restart_integration(sensor);
+      }
+      break;
+
+    //New integration settings take effect in the next cycle.
+    case TCS34725IntegrationTime:
+    case TCS34725WaitTime:
+    case TCS34725ThresholdLowL:
+    case TCS34725ThresholdLowH:
+    case TCS34725ThresholdHighL:
+    case TCS34725ThresholdHighH:
+    case TCS34725Persistence:
+      sensor->registers[address] = data;
+      break;
+
+    case TCS34725Configuration:
+      sensor->registers[address] = data & WAIT_LONG;
+      break;
+
+    case TCS34725Control:
+      sensor->registers[address] = data & GAIN_MASK;
+      break;
+
+    //The remaining registers are read-only, or reserved; writes to them are ignored.
+    default:
+      break;
+  }
+
+  advance_register(sensor);
+  return 1;
+}
+
+
+/*
+ * Called for each byte the master reads from the sensor.
+ */
+static uint8_t read_from_sensor(VirtualTWIDevice * device) {
+
+  VirtualTCS34725 * sensor = device->context;
+  uint8_t address = sensor->command & REGISTER_MASK;
+  uint8_t data;
+
+  update_readings(sensor);
+
+  //Reading a channel's low byte latches its high byte, so the two always match.
+  //The data registers start at an even address, so each low byte is at an even address.
+  if((address >= TCS34725ClearLow) && (address <= TCS34725BlueHigh)) {
+
+    if(!(address & 1)) {
+      data = sensor->registers[address];
+      sensor->latched_high_byte = sensor->registers[address + 1];
+    } else {
+      data = sensor->latched_high_byte;
+    }
+
+    //Once the last channel has been read, count the reading; and note if it's one we've already fetched.
+    if(address == TCS34725BlueHigh) {
+      sensor->readings++;
+      sensor->stale_readings += sensor->reading_fetched;
+      sensor->reading_fetched = 1;
+    }
+
+  } else {
+    data = sensor->registers[address];
+  }
+
+  advance_register(sensor);
+  return data;
+}
+
+
+/*
+ * @return The time of the sensor's next event: the end of its current integration, which may
+ *    change its INT output. Only reported if the INT output is connected; otherwise, the sensor
+ *    can catch up whenever the master talks to it.
+ */
+static uint64_t next_sensor_event(VirtualTWIDevice * device) {
+
+  VirtualTCS34725 * sensor = device->context;
+
+  if(!sensor->interrupt_connected || !is_running(sensor)) {
+    return UINT64_MAX;
+  }
+
+  return sensor->integration_ends_at;
+}
+
+
+/*
+ * Called at the end of each integration, if the INT output is connected.
+ */
+static void update_sensor(VirtualTWIDevice * device) {
+  update_readings(device->context);
+}
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Resets the given sensor to its power-on state, and adds it to the TWI bus, at its fixed address.
+ */
+void attach_virtual_tcs34725(VirtualTCS34725 * sensor) {
+
+  uint8_t i;
+
+  for(i = 0; i < sizeof(sensor->registers); ++i) {
+    sensor->registers[i] = 0;
+  }
+
+  //The ADC starts out off, with the shortest (2.4ms) integration and wait times, and 1x gain.
+  sensor->registers[TCS34725IntegrationTime] = 0xFF;
+  sensor->registers[TCS34725WaitTime]        = 0xFF;
+  sensor->registers[TCS34725ID]              = VIRTUAL_TCS34725_ID;
+
+  sensor->command               = COMMAND_BIT;
+  sensor->awaiting_command      = 1;
+  sensor->latched_high_byte     = 0;
+  sensor->readings              = 0;
+  sensor->stale_readings        = 0;
+  sensor->reading_fetched       = 0;
+  sensor->out_of_range_readings = 0;
+  sensor->integration_ends_at   = 0;
+  sensor->interrupt_connected   = 0;
+
+  sensor->device.address    = VIRTUAL_TCS34725_ADDRESS;
+  sensor->device.select     = select_sensor;
+  sensor->device.write      = write_to_sensor;
+  sensor->device.read       = read_from_sensor;
+  sensor->device.stop       = 0;
+  sensor->device.next_event = next_sensor_event;
+  sensor->device.update     = update_sensor;
+  sensor->device.context    = sensor;
+
+  attach_virtual_twi_device(&sensor->device);
+}
+
+
+/*
+ * Connects the given sensor's INT output to one of the AVR's pins.
+ */
+void connect_virtual_tcs34725_interrupt(VirtualTCS34725 * sensor, VirtualPort port, uint8_t bit) {
+
+  sensor->interrupt_connected = 1;
+  sensor->interrupt_port      = port;
+  sensor->interrupt_bit       = bit;
+
+  update_interrupt_output(sensor);
+}
@@ -0,0 +1,132 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: a simulated TCS34725 color sensor.
+ *
+ * Models the TCS34725 as seen from the TWI bus: its register file, its command register
+ * (whose CMD bit must be set on every command; and whose type field selects between
+ * repeated-byte and auto-increment access, e.g. 0xA0 or 0xB4), its ID register, and its
+ * RGBC ADC. Once enabled (PON and AEN), the ADC repeatedly performs a 2.4ms initialization,
+ * an integration (set by ATIME), and an optional wait (set by WTIME, if WEN is set); a new
+ * reading is stored at the end of each integration, and sets the STATUS register's AVALID
+ * bit. If AIEN is set, each reading can also raise the RGBC interrupt (AINT), following the
+ * persistence and threshold registers; the interrupt is cleared by the 0xE6 special function.
+ * Like the real device, reading a channel's low byte latches its high byte.
+ *
+ * The sensor's INT output can be connected to one of the AVR's pins. Like the real (open-drain)
+ * output, it pulls the pin low while the RGBC interrupt is raised, and releases it otherwise.
+ *
+ * @code
+ *   VirtualTCS34725 sensor = { .clear_light = 900, .red_light = 350, .green_light = 300, .blue_light = 250 };
+ *   attach_virtual_tcs34725(&sensor);
+ *   connect_virtual_tcs34725_interrupt(&sensor, VirtualPortD, 2);   // optional: INT to PD2
+ * @endcode
+ */
+
+#ifndef __VIRTUAL_AVR_TCS34725_MODEL_H__
+#define __VIRTUAL_AVR_TCS34725_MODEL_H__
+
+#include "virtual_avr.h"
+
+/**
+ * The TCS34725's registers; see the datasheet.
+ */
+enum VirtualTCS34725Register_enum {
+  TCS34725Enable             = 0x00,
+  TCS34725IntegrationTime    = 0x01,
+  TCS34725WaitTime           = 0x03,
+  TCS34725ThresholdLowL      = 0x04,
+  TCS34725ThresholdLowH      = 0x05,
+  TCS34725ThresholdHighL     = 0x06,
+  TCS34725ThresholdHighH     = 0x07,
+  TCS34725Persistence        = 0x0C,
+  TCS34725Configuration      = 0x0D,
+  TCS34725Control            = 0x0F,
+  TCS34725ID                 = 0x12,
+  TCS34725Status             = 0x13,
+  TCS34725ClearLow           = 0x14,
+  TCS34725BlueHigh           = 0x1B
+};
+
+/**
+ * The TCS34725's fixed TWI address.
+ */
+#define VIRTUAL_TCS34725_ADDRESS 0x29
+
+/**
+ * The value of the TCS34725's ID register.
+ */
+#define VIRTUAL_TCS34725_ID 0x44
+
+/**
+ * A simulated TCS34725.
+ */
+struct VirtualTCS34725_struct {
+
+  /** The sensor's connection to the TWI bus. Set up by attach_virtual_tcs34725. */
+  VirtualTWIDevice device;
+
+  /**
+   * The light reaching the sensor, as seen by each of its channels, in counts: the reading
+   * each would produce from a single 2.4ms integration cycle (ATIME = 0xFF) at 1x gain.
+   * Longer integrations and higher gains scale these up; readings saturate, just as they
+   * do on the real device.
+   */
+  uint32_t clear_light;
+  uint32_t red_light;
+  uint32_t green_light;
+  uint32_t blue_light;
+
+  /** The number of complete readings the master has fetched; i.e. the number of times it has read BDATAH. */
+  uint32_t readings;
+
+  /** The number of those readings which were stale: fetched again, before the next integration finished. */
+  uint32_t stale_readings;
+
+  /** The sensor's register file. */
+  uint8_t registers[32];
+
+  /** The most recent command byte; its low five bits are the register being accessed. */
+  uint8_t command;
+
+  /** True iff the next byte written is a command byte. */
+  uint8_t awaiting_command;
+
+  /** The high byte latched by the last read of a channel's low byte. */
+  uint8_t latched_high_byte;
+
+  /** True iff the current reading has already been fetched. */
+  uint8_t reading_fetched;
+
+  /** The number of consecutive readings whose clear channel has been outside the interrupt thresholds. */
+  uint32_t out_of_range_readings;
+
+  /** The time (in CPU cycles) at which the ADC's current integration ends. */
+  uint64_t integration_ends_at;
+
+  /** True iff the sensor's INT output is connected to one of the AVR's pins. */
+  uint8_t interrupt_connected;
+
+  /** The AVR pin the INT output is connected to, if any. Set up by connect_virtual_tcs34725_interrupt. */
+  VirtualPort interrupt_port;
+  uint8_t interrupt_bit;
+
+};
+typedef struct VirtualTCS34725_struct VirtualTCS34725;
+
+/**
+ * Resets the given sensor to its power-on state, and adds it to the TWI bus, at its fixed address.
+ *
+ * @param sensor The sensor to be attached. Its light levels should already be set.
+ */
+void attach_virtual_tcs34725(VirtualTCS34725 * sensor);
+
+/**
+ * Connects the given sensor's INT output to one of the AVR's pins.
+ *
+ * @param sensor The sensor whose output is to be connected. Should already be attached.
+ * @param port The port of the AVR pin; e.g. VirtualPortD.
+ * @param bit The bit number of the AVR pin within its port; e.g. 2 for PD2.
+ */
+void connect_virtual_tcs34725_interrupt(VirtualTCS34725 * sensor, VirtualPort port, uint8_t bit);
+
+#endif
@@ -0,0 +1,412 @@
+/*
+ * EECE 387 Example Code
+ * Virtual AVR: a simulated TSL2561 light-to-digital converter.
+ *
+ * See tsl2561_model.h.
+ */
+
+#include "tsl2561_model.h"
+
+//The bits of the command register.
+#define COMMAND_BIT      0x80
+#define CLEAR_BIT        0x40
+#define WORD_BIT         0x20
+#define BLOCK_BIT        0x10
+#define REGISTER_MASK    0x0F
+
+//The bits of the control, timing and interrupt registers.
+#define POWER_ON         0x03
+#define HIGH_GAIN        0x10
+#define MANUAL_BIT       0x08
+#define INTEGRATION_MASK 0x03
+#define INTERRUPT_MASK   0x30
+#define LEVEL_INTERRUPT  0x10
+#define TEST_INTERRUPT   0x30
+#define PERSISTENCE_MASK 0x0F
+
+//The direction bit sent with the device's address, for a read.
+#define TW_READ 1
+
+/*
+ * The TSL2561's integration times. Each entry gives the length of the integration,
+ * in tenths of a millisecond; the fraction of a full (402ms) integration's counts it
+ * collects, in 322nds (the datasheet's channel scaling); and the largest count it can produce.
+ */
+static const struct {
+  uint16_t tenths_of_milliseconds;
+  uint16_t scale;
+  uint16_t maximum_count;
+} integration_times[] = {
+  { 137,  11,  5047  },
+  { 1010, 81,  37177 },
+  { 4020, 322, 65535 }
+};
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+/*
+ * @return True iff the sensor's ADC is powered on.
+ */
+static uint8_t is_powered(VirtualTSL2561 * sensor) {
+  return (sensor->registers[TSL2561Control] & POWER_ON) == POWER_ON;
+}
+
+
+/*
+ * Starts a new integration, now.
+ */
+static void restart_integration(VirtualTSL2561 * sensor) {
+  sensor->integration_started_at = virtual_avr_cycles();
+}
+
+
+/*
+ * @return The count produced by the given amount of light, with the sensor's current settings.
+ */
+static uint16_t count_for_light(VirtualTSL2561 * sensor, uint32_t light) {
+
+  uint8_t timing        = sensor->registers[TSL2561Timing];
+  uint8_t integration   = timing & INTEGRATION_MASK;
+  uint64_t count        = (uint64_t)light * integration_times[integration].scale / 322;
+
+  if(timing & HIGH_GAIN) {
+    count *= 16;
+  }
+
+  //Like the real device, saturate, rather than overflowing.
+  if(count > integration_times[integration].maximum_count) {
+    count = integration_times[integration].maximum_count;
+  }
+
+  return count;
+}
+
+
+/*
+ * @return The length of each integration, in CPU cycles.
+ */
+static uint64_t integration_length(VirtualTSL2561 * sensor) {
+  return (uint64_t)F_CPU * integration_times[sensor->registers[TSL2561Timing] & INTEGRATION_MASK].tenths_of_milliseconds / 10000;
+}
+
+
+/*
+ * @return True iff the ADC is integrating on its own: powered on, and not under manual control.
+ */
+static uint8_t is_integrating(VirtualTSL2561 * sensor) {
+  return is_powered(sensor) && ((sensor->registers[TSL2561Timing] & INTEGRATION_MASK) != INTEGRATION_MASK);
+}
+
+
+/*
+ * Updates the INT output, if it's connected: it pulls its pin low while a level (or test) interrupt is raised.
+ */
+static void update_interrupt_output(VirtualTSL2561 * sensor) {
+
+  uint8_t interrupt_control = sensor->registers[TSL2561Interrupt] & INTERRUPT_MASK;
+  uint8_t asserted = sensor->interrupt_pending && ((interrupt_control == LEVEL_INTERRUPT) || (interrupt_control == TEST_INTERRUPT));
+
+  if(!sensor->interrupt_connected) {
+    return;
+  }
+
+  if(asserted) {
+    drive_virtual_pin(sensor->interrupt_port, sensor->interrupt_bit, 0);
+  } else {
+    release_virtual_pin(sensor->interrupt_port, sensor->interrupt_bit);
+  }
+}
+
+
+/*
+ * Raises the interrupt, if the given number of new readings (of the current light) should
+ * do so: either on every integration (a persistence of 0), or once the given number of
+ * consecutive channel 0 readings have been outside the interrupt thresholds.
+ */
+static void update_interrupt(VirtualTSL2561 * sensor, uint64_t new_readings) {
+
+  uint16_t channel0       = sensor->registers[TSL2561Data0Low] | (sensor->registers[TSL2561Data0High] << 8);
+  uint16_t low_threshold  = sensor->registers[TSL2561ThresholdLowL]  | (sensor->registers[TSL2561ThresholdLowH]  << 8);
+  uint16_t high_threshold = sensor->registers[TSL2561ThresholdHighL] | (sensor->registers[TSL2561ThresholdHighH] << 8);
+  uint8_t persistence     = sensor->registers[TSL2561Interrupt] & PERSISTENCE_MASK;
+
+  if((channel0 < low_threshold) || (channel0 > high_threshold)) {
+    sensor->out_of_range_readings += new_readings;
+  } else {
+    sensor->out_of_range_readings = 0;
+  }
+
+  if(!(sensor->registers[TSL2561Interrupt] & INTERRUPT_MASK)) {
+    return;
+  }
+
+  if(!persistence || (sensor->out_of_range_readings >= persistence)) {
+    sensor->interrupt_pending = 1;
+    update_interrupt_output(sensor);
+  }
+}
+
+
+/*
+ * Brings the sensor's readings up to date: if an integration has finished since we last
+ * checked, stores the new readings in the data registers.
+ */
+static void update_readings(VirtualTSL2561 * sensor) {
+
+  uint64_t integration_cycles, elapsed;
+  uint16_t channel0, channel1;
+
+  //Integrations only happen automatically when the ADC is on, and not under manual control.
+  if(!is_integrating(sensor)) {
+    return;
+  }
+
+  integration_cycles = integration_length(sensor);
+  elapsed            = virtual_avr_cycles() - sensor->integration_started_at;
+
+  if(elapsed < integration_cycles) {
+    return;
+  }
+
+  //The ADC runs continuously; so skip ahead to the integration that's currently underway.
+  sensor->integration_started_at += (elapsed / integration_cycles) * integration_cycles;
+
+  channel0 = count_for_light(sensor, sensor->broadband_light);
+  channel1 = count_for_light(sensor, sensor->infrared_light);
+
+  sensor->registers[TSL2561Data0Low]  = channel0 & 0xFF;
+  sensor->registers[TSL2561Data0High] = channel0 >> 8;
+  sensor->registers[TSL2561Data1Low]  = channel1 & 0xFF;
+  sensor->registers[TSL2561Data1High] = channel1 >> 8;
+  sensor->reading_fetched             = 0;
+
+  update_interrupt(sensor, elapsed / integration_cycles);
+}
+
+
+/*
+ * Moves on to the next register, if the last command asked us to.
+ */
+static void advance_register(VirtualTSL2561 * sensor) {
+  if(sensor->command & (WORD_BIT | BLOCK_BIT)) {
+    sensor->command = (sensor->command & ~REGISTER_MASK) | ((sensor->command + 1) & REGISTER_MASK);
+  }
+}
+
+
+/*
+ * Called when the master addresses the sensor.
+ */
+static uint8_t select_sensor(VirtualTWIDevice * device, uint8_t direction) {
+
+  VirtualTSL2561 * sensor = device->context;
+
+  //Each write starts with a command byte. Reads continue from the last register addressed.
+  sensor->awaiting_command = (direction != TW_READ);
+  return 1;
+}
+
+
+/*
+ * Called for each byte the master writes to the sensor.
+ */
+static uint8_t write_to_sensor(VirtualTWIDevice * device, uint8_t data) {
+
+  VirtualTSL2561 * sensor = device->context;
+  uint8_t address;
+
+  update_readings(sensor);
+
+  //Handle command bytes. Every command must have its CMD bit set; we refuse any that don't,
+  //so mistakes show up as NACKs.
+  if(sensor->awaiting_command) {
+
+    if(!(data & COMMAND_BIT)) {
+      return 0;
+    }
+
+    //The CLEAR bit clears any pending interrupt.
+    if(data & CLEAR_BIT) {
+      sensor->interrupt_pending = 0;
+      update_interrupt_output(sensor);
+    }
+
+    sensor->command          = data & ~CLEAR_BIT;
+    sensor->awaiting_command = 0;
+    return 1;
+  }
+
+  //Handle writes to the register file.
+  address = sensor->command & REGISTER_MASK;
+
+  switch(address) {
+
+    //Turning the ADC on starts its first integration.
+    case TSL2561Control:
+      data &= POWER_ON;
+      if((data == POWER_ON) && !is_powered(sensor)) {
+        restart_integration(sensor);
+      }
+      sensor->registers[address] = data;
+      break;
+
+    //New timing settings start a new integration.
+    case TSL2561Timing:
+      sensor->registers[address] = data & (HIGH_GAIN | MANUAL_BIT | INTEGRATION_MASK);
+      restart_integration(sensor);
+      break;
+
+    case TSL2561ThresholdLowL:
+    case TSL2561ThresholdLowH:
+    case TSL2561ThresholdHighL:
+    case TSL2561ThresholdHighH:
+      sensor->registers[address] = data;
+      break;
+
+    //Selecting test mode raises the interrupt straight away.
+    case TSL2561Interrupt:
+      sensor->registers[address] = data & (INTERRUPT_MASK | PERSISTENCE_MASK);
+      if((data & INTERRUPT_MASK) == TEST_INTERRUPT) {
+        sensor->interrupt_pending = 1;
+      }
+      update_interrupt_output(sensor);
+      break;
+
+    //The remaining registers are read-only, or reserved; writes to them are ignored.
+    default:
+      break;
+  }
+
+  advance_register(sensor);
+  return 1;
+}
+
+
+/*
+ * Called for each byte the master reads from the sensor.
+ */
+static uint8_t read_from_sensor(VirtualTWIDevice * device) {
+
+  VirtualTSL2561 * sensor = device->context;
+  uint8_t address = sensor->command & REGISTER_MASK;
+  uint8_t data;
+
+  update_readings(sensor);
+
+  switch(address) {
+
+    //Reading a channel's low byte latches its high byte, so the two always match.
+    case TSL2561Data0Low:
+    case TSL2561Data1Low:
+      data = sensor->registers[address];
+      sensor->latched_high_byte = sensor->registers[address + 1];
+      break;
+
+    //Once channel 0 has been read in full, count the reading; and note if it's one we've already fetched.
+    case TSL2561Data0High:
+      data = sensor->latched_high_byte;
+      sensor->readings++;
+      sensor->stale_readings += sensor->reading_fetched;
+      sensor->reading_fetched = 1;
+      break;
+
+    case TSL2561Data1High:
+      data = sensor->latched_high_byte;
+      break;
+
+    default:
+      data = sensor->registers[address];
+      break;
+  }
+
+  advance_register(sensor);
+  return data;
+}
+
+
+/*
+ * @return The time of the sensor's next event: the end of its current integration, which may
+ *    change its INT output. Only reported if the INT output is connected; otherwise, the sensor
+ *    can catch up whenever the master talks to it.
+ */
+static uint64_t next_sensor_event(VirtualTWIDevice * device) {
+
+  VirtualTSL2561 * sensor = device->context;
+
+  if(!sensor->interrupt_connected || !is_integrating(sensor)) {
+    return UINT64_MAX;
+  }
+
+  return sensor->integration_started_at + integration_length(sensor);
+}
+
+
+/*
+ * Called at the end of each integration, if the INT output is connected.
+ */
+static void update_sensor(VirtualTWIDevice * device) {
+  update_readings(device->context);
+}
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Resets the given sensor to its power-on state, and adds it to the TWI bus.
+ */
+void attach_virtual_tsl2561(VirtualTSL2561 * sensor, uint8_t address) {
+
+  uint8_t i;
+
+  for(i = 0; i < sizeof(sensor->registers); ++i) {
+    sensor->registers[i] = 0;
+  }
+
+  //The ADC starts out off, with a 402ms integration time and 1x gain.
+  sensor->registers[TSL2561Timing] = 0x02;
+  sensor->registers[TSL2561ID]     = VIRTUAL_TSL2561_ID;
+
+  sensor->command                = COMMAND_BIT;
+  sensor->awaiting_command       = 1;
+  sensor->latched_high_byte      = 0;
+  sensor->readings               = 0;
+  sensor->stale_readings         = 0;
+  sensor->reading_fetched        = 0;
+  sensor->integration_started_at = 0;
+  sensor->interrupt_pending      = 0;
+  sensor->out_of_range_readings  = 0;
+  sensor->interrupt_connected    = 0;
+
+  sensor->device.address    = address;
+  sensor->device.select     = select_sensor;
+  sensor->device.write      = write_to_sensor;
+  sensor->device.read       = read_from_sensor;
+  sensor->device.stop       = 0;
+  sensor->device.next_event = next_sensor_event;
+  sensor->device.update     = update_sensor;
+  sensor->device.context    = sensor;
+
+  attach_virtual_twi_device(&sensor->device);
+}
+
+
+/*
+ * Connects the given sensor's INT output to one of the AVR's pins.
+ */
+void connect_virtual_tsl2561_interrupt(VirtualTSL2561 * sensor, VirtualPort port, uint8_t bit) {
+
+  sensor->interrupt_connected = 1;
+  sensor->interrupt_port      = port;
+  sensor->interrupt_bit       = bit;
+
+  update_interrupt_output(sensor);
+}
@@ -0,0 +1,131 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: a simulated TSL2561 light-to-digital converter.
+ *
+ * Models the TSL2561 as seen from the TWI bus: its register file, its command register
+ * (whose CMD bit must be set on every command; and whose WORD and BLOCK bits make reads
+ * and writes advance through the registers), its ID register, and its ADC, which
+ * produces a new reading at the end of each integration period, as set by the TIMING
+ * register. Like the real device, reading a channel's low byte latches its high byte,
+ * so a two-byte read never mixes two readings.
+ *
+ * The INTERRUPT register's level interrupt is modelled too: following its persistence
+ * setting, the interrupt is raised either at the end of every integration, or once enough
+ * consecutive channel 0 readings have been outside the threshold registers; and it's
+ * cleared by any command with the CLEAR bit set. The sensor's INT output can be connected
+ * to one of the AVR's pins, which it pulls low while the interrupt is raised.
+ *
+ * The light reaching the sensor can be changed at any time, and is picked up at the
+ * end of the next integration:
+ *
+ * @code
+ *   VirtualTSL2561 sensor = { .broadband_light = 1200, .infrared_light = 300 };
+ *   attach_virtual_tsl2561(&sensor, 0x39);
+ *   connect_virtual_tsl2561_interrupt(&sensor, VirtualPortD, 3);   // optional: INT to PD3
+ * @endcode
+ */
+
+#ifndef __VIRTUAL_AVR_TSL2561_MODEL_H__
+#define __VIRTUAL_AVR_TSL2561_MODEL_H__
+
+#include "virtual_avr.h"
+
+/**
+ * The TSL2561's registers; see the datasheet.
+ */
+enum VirtualTSL2561Register_enum {
+  TSL2561Control        = 0x0,
+  TSL2561Timing         = 0x1,
+  TSL2561ThresholdLowL  = 0x2,
+  TSL2561ThresholdLowH  = 0x3,
+  TSL2561ThresholdHighL = 0x4,
+  TSL2561ThresholdHighH = 0x5,
+  TSL2561Interrupt      = 0x6,
+  TSL2561ID             = 0xA,
+  TSL2561Data0Low       = 0xC,
+  TSL2561Data0High      = 0xD,
+  TSL2561Data1Low       = 0xE,
+  TSL2561Data1High      = 0xF
+};
+
+/**
+ * The value of the TSL2561's ID register: part number 0b0101 (TSL2561), revision 0.
+ */
+#define VIRTUAL_TSL2561_ID 0x50
+
+/**
+ * A simulated TSL2561.
+ */
+struct VirtualTSL2561_struct {
+
+  /** The sensor's connection to the TWI bus. Set up by attach_virtual_tsl2561. */
+  VirtualTWIDevice device;
+
+  /**
+   * The light reaching the sensor, as seen by channel 0 (visible and infrared light), in counts:
+   * the reading it would produce with the default settings (402ms integration, 1x gain).
+   * Readings saturate, just as they do on the real device.
+   */
+  uint32_t broadband_light;
+
+  /** The light reaching the sensor, as seen by channel 1 (infrared light only), in counts. */
+  uint32_t infrared_light;
+
+  /** The number of readings the master has fetched; i.e. the number of times it has read DATA0HIGH. */
+  uint32_t readings;
+
+  /** The number of those readings which were stale: fetched again, before the next integration finished. */
+  uint32_t stale_readings;
+
+  /** The sensor's register file. */
+  uint8_t registers[16];
+
+  /** The most recent command byte; its low nibble is the register being accessed. */
+  uint8_t command;
+
+  /** True iff the next byte written is a command byte. */
+  uint8_t awaiting_command;
+
+  /** The high byte latched by the last read of a channel's low byte. */
+  uint8_t latched_high_byte;
+
+  /** True iff the current reading has already been fetched. */
+  uint8_t reading_fetched;
+
+  /** The time (in CPU cycles) at which the current integration started. */
+  uint64_t integration_started_at;
+
+  /** True iff the sensor's interrupt has been raised. */
+  uint8_t interrupt_pending;
+
+  /** The number of consecutive readings whose channel 0 count has been outside the interrupt thresholds. */
+  uint32_t out_of_range_readings;
+
+  /** True iff the sensor's INT output is connected to one of the AVR's pins. */
+  uint8_t interrupt_connected;
+
+  /** The AVR pin the INT output is connected to, if any. Set up by connect_virtual_tsl2561_interrupt. */
+  VirtualPort interrupt_port;
+  uint8_t interrupt_bit;
+
+};
+typedef struct VirtualTSL2561_struct VirtualTSL2561;
+
+/**
+ * Resets the given sensor to its power-on state, and adds it to the TWI bus.
+ *
+ * @param sensor The sensor to be attached. Its light levels should already be set.
+ * @param address The sensor's TWI address: 0x29, 0x39 or 0x49, depending on its ADDR SEL pin.
+ */
+void attach_virtual_tsl2561(VirtualTSL2561 * sensor, uint8_t address);
+
+/**
+ * Connects the given sensor's INT output to one of the AVR's pins.
+ *
+ * @param sensor The sensor whose output is to be connected. Should already be attached.
+ * @param port The port of the AVR pin; e.g. VirtualPortD.
+ * @param bit The bit number of the AVR pin within its port; e.g. 3 for PD3.
+ */
+void connect_virtual_tsl2561_interrupt(VirtualTSL2561 * sensor, VirtualPort port, uint8_t bit);
+
+#endif
@@ -0,0 +1,1755 @@
+/*
+ * EECE 387 Example Code
+ * Virtual AVR: a simulated ATmega328P, for running the libraries on the host.
+ *
+ * See virtual_avr.h for usage.
+ *
+ * The trickiest part of simulating the AVR's peripherals is noticing when the AVR code
+ * writes to a register: many writes matter even when they don't change the register's
+ * value (e.g. writing TWINT to TWCR starts the next TWI operation). To catch every write,
+ * the register file lives in its own page of memory, which is kept read-only; any write
+ * causes a fault, which we catch, note, and then allow. The peripheral models then react
+ * to each write (and to reads with side effects, like reading UDR0) at the next register
+ * access, or whenever time passes.
+ */
+
+#include "virtual_avr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/*
+ * The data-space addresses of the registers we simulate, and the bits within them.
+ * These match the ATmega328P; see host/include/avr/io.h.
+ */
+#define ADDRESS_PINB   0x23
+#define ADDRESS_DDRB   0x24
+#define ADDRESS_PORTB  0x25
+#define ADDRESS_PINC   0x26
+#define ADDRESS_DDRC   0x27
+#define ADDRESS_PORTC  0x28
+#define ADDRESS_PIND   0x29
+#define ADDRESS_DDRD   0x2A
+#define ADDRESS_PORTD  0x2B
+#define ADDRESS_TIFR0  0x35
+#define ADDRESS_PCIFR  0x3B
+#define ADDRESS_TCCR0A 0x44
+#define ADDRESS_TCCR0B 0x45
+#define ADDRESS_TCNT0  0x46
+#define ADDRESS_OCR0A  0x47
+#define ADDRESS_OCR0B  0x48
+#define ADDRESS_SMCR   0x53
+#define ADDRESS_SREG   0x5F
+#define ADDRESS_PCICR  0x68
+#define ADDRESS_PCMSK0 0x6B
+#define ADDRESS_TIMSK0 0x6E
+#define ADDRESS_TWBR   0xB8
+#define ADDRESS_TWSR   0xB9
+#define ADDRESS_TWDR   0xBB
+#define ADDRESS_TWCR   0xBC
+#define ADDRESS_UCSR0A 0xC0
+#define ADDRESS_UCSR0B 0xC1
+#define ADDRESS_UCSR0C 0xC2
+#define ADDRESS_UDR0   0xC6
+
+#define SREG_I 7
+
+#define SE 0
+
+#define TOV0  0
+#define OCF0A 1
+#define OCF0B 2
+#define WGM01 1
+#define WGM02 3
+#define CS_MASK 0x07
+
+#define TWIE  0
+#define TWEN  2
+#define TWSTO 4
+#define TWSTA 5
+#define TWEA  6
+#define TWINT 7
+
+#define MPCM0 0
+#define U2X0  1
+#define UDRE0 5
+#define TXC0  6
+#define RXC0  7
+
+#define TXEN0  3
+#define RXEN0  4
+#define UDRIE0 5
+#define RXCIE0 7
+
+#define TW_START        0x08
+#define TW_REP_START    0x10
+#define TW_MT_SLA_ACK   0x18
+#define TW_MT_SLA_NACK  0x20
+#define TW_MT_DATA_ACK  0x28
+#define TW_MT_DATA_NACK 0x30
+#define TW_MR_SLA_ACK   0x40
+#define TW_MR_SLA_NACK  0x48
+#define TW_MR_DATA_ACK  0x50
+#define TW_MR_DATA_NACK 0x58
+#define TW_NO_INFO      0xF8
+
+#define _BV(bit) (1 << (bit))
+
+/*
+ * The largest number of writes we can note between two register accesses. Normally,
+ * there's only one; but code which keeps pointers to registers can make several.
+ */
+#define MAXIMUM_PENDING_WRITES 16
+
+/*
+ * The states of the simulated TWI hardware.
+ */
+enum VirtualTWIState_enum {
+  TWIIdle,
+  TWIAddressNext,
+  TWITransmitting,
+  TWIReceiving
+};
+typedef enum VirtualTWIState_enum VirtualTWIState;
+
+/*
+ * The states of the simulated devices on a bit-banged TWI bus (see connect_virtual_twi_pins).
+ */
+enum VirtualPinTWIState_enum {
+  PinTWIIdle,
+  PinTWIReceiving,
+  PinTWIAcknowledging,
+  PinTWITransmitting,
+  PinTWIAwaitingAcknowledge,
+  PinTWIIgnoring
+};
+typedef enum VirtualPinTWIState_enum VirtualPinTWIState;
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+//Functions which manage the register file, and notice the AVR code's accesses to it.
+static void set_up_register_file();
+static void handle_register_fault(int signal_number, siginfo_t * information, void * context);
+static void make_register_file_writable();
+static void make_register_file_read_only();
+static void set_register(uint16_t address, uint8_t value);
+static void settle_register_accesses();
+static void handle_register_write(uint16_t address);
+static void handle_register_read(uint16_t address);
+
+//Functions which advance time, and deliver interrupts.
+static void advance_time(uint64_t cycles);
+static void stop_if_out_of_time();
+static uint64_t next_peripheral_event();
+static void update_peripherals();
+static void deliver_interrupts();
+static uint8_t deliver_interrupts_and_count();
+static void (*pending_interrupt())(void);
+static uint8_t interrupt_can_wake_cpu();
+
+//Functions which model the I/O pins, and their pin change interrupts.
+static uint16_t pin_register_address(VirtualPort port);
+static uint8_t pin_levels(VirtualPort port);
+static void update_pin_register(VirtualPort port);
+static void clear_pin_change_flag(void (*handler)(void));
+
+//Functions which model timer/counter 0.
+static void handle_timer0_write(uint16_t address);
+static uint32_t timer0_clock_period();
+static uint8_t timer0_top();
+static uint8_t current_timer0_count();
+static void synchronize_timer0();
+static uint64_t next_timer0_event();
+static void update_timer0();
+static void clear_timer0_flag(void (*handler)(void));
+
+//The TWI model.
+static void handle_twi_control_write();
+static void perform_twi_operation(uint8_t control);
+static void schedule_twi_completion(uint8_t clocks, uint8_t status);
+static void complete_twi_operation();
+static uint32_t twi_clock_period();
+static void set_twi_status(uint8_t status);
+static void update_twi_control_register(uint8_t control);
+static VirtualTWIDevice * find_twi_device(uint8_t address);
+static void claim_twi_bus();
+static void release_twi_bus();
+
+//The model of a TWI bus on ordinary pins, for software TWI masters.
+static void watch_twi_pins(uint8_t previous_levels, uint8_t levels);
+static void start_pin_twi_packet();
+static void stop_pin_twi_packet();
+static void finish_pin_twi_byte();
+static void send_next_pin_twi_byte();
+static void drive_pin_twi_sda(uint8_t level);
+static void hold_pin_twi_clock_if_stretched();
+
+//The USART model.
+static void handle_uart_status_write();
+static void transmit_via_uart(uint8_t data);
+static void receive_next_uart_byte();
+static void update_uart_status_register(uint8_t writable_bits);
+static void write_to_standard_output(uint8_t data);
+
+
+//The simulated register file, which occupies its own page(s) of memory.
+static uint8_t * register_file = 0;
+static size_t register_file_size;
+static volatile sig_atomic_t register_file_writable = 1;
+
+//The fault handlers that were in place before ours; used for faults that aren't ours.
+static struct sigaction previous_segmentation_fault_action, previous_bus_error_action;
+
+//The registers written since we last checked, as noted by our fault handler...
+static volatile uint16_t pending_writes[MAXIMUM_PENDING_WRITES];
+static volatile sig_atomic_t pending_write_count = 0;
+
+//... and the register most recently accessed, which has been read, if it hasn't been written.
+static int16_t last_accessed_register = -1;
+
+//Simulated time, in CPU cycles; and the time at which we'll stop, or 0 to run forever.
+static uint64_t elapsed_cycles = 0;
+static uint64_t sleeping_cycles = 0;
+static uint64_t time_limit = 0;
+
+//The levels simulated devices are driving onto each port's pins, and which pins they're driving;
+//and the pin change interrupt flags.
+static uint8_t driven_pin_levels[3] = { 0, 0, 0 };
+static uint8_t driven_pins[3] = { 0, 0, 0 };
+static uint8_t pin_change_flags = 0;
+
+//The levels of each port's pins, as of the last time its PIN register was brought up to date.
+static uint8_t previous_pin_levels[3] = { 0xFF, 0x7F, 0xFF };
+
+//The state of timer/counter 0: its count, as of the (clock-aligned) time it was last brought
+//up to date; its interrupt flags; and the settings it's counting with.
+static uint8_t timer0_count = 0;
+static uint64_t timer0_counted_at = 0;
+static uint8_t timer0_flags = 0;
+static uint8_t timer0_control_a = 0, timer0_control_b = 0, timer0_compare_a = 0, timer0_compare_b = 0;
+
+//The state of the TWI hardware, and the devices on its bus.
+static VirtualTWIState twi_state = TWIIdle;
+static uint8_t twi_interrupt_flag = 0;
+static uint8_t twi_status = TW_NO_INFO;
+static VirtualTWIDevice * twi_devices = 0;
+static VirtualTWIDevice * selected_twi_device = 0;
+static VirtualTWIStatistics twi_statistics;
+
+//The TWI operation in progress, if any: when it ends, and the results it'll have then.
+static uint8_t twi_operation_pending = 0;
+static uint8_t twi_stop_pending = 0;
+static uint8_t twi_start_after_stop = 0;
+static uint64_t twi_operation_ends_at = 0;
+static uint8_t twi_completion_status = TW_NO_INFO;
+static uint8_t twi_received_byte = 0xFF;
+
+//The extra time devices have held the clock low for, during the current operation.
+static uint64_t twi_clock_stretch = 0;
+static uint8_t twi_bus_claimed = 0;
+static uint64_t twi_bus_claimed_at = 0;
+
+//The TWI bus on ordinary pins, if the devices have been connected to one: its pins; what the
+//devices on it are doing; the byte being shifted in or out; and when a device will let go of
+//SCL, if it's stretching the clock.
+static uint8_t twi_pins_connected = 0;
+static VirtualPort twi_pins_port = VirtualPortC;
+static uint8_t twi_sda_bit = 0, twi_scl_bit = 0;
+static VirtualPinTWIState pin_twi_state = PinTWIIdle;
+static VirtualTWIDevice * pin_twi_device = 0;
+static uint8_t pin_twi_byte = 0, pin_twi_bits = 0;
+static uint8_t pin_twi_address_next = 0, pin_twi_reading = 0, pin_twi_acknowledged = 0;
+static uint64_t pin_twi_clock_held_until = 0;
+
+//The state of the USART: the bytes waiting to be received, and where transmitted bytes go.
+static uint8_t * uart_receive_queue = 0;
+static uint32_t uart_receive_queue_length = 0, uart_receive_queue_position = 0;
+static uint8_t uart_received_byte = 0;
+static uint8_t uart_receive_complete = 0;
+static uint8_t uart_transmit_complete = 0;
+static void (*uart_output)(uint8_t) = write_to_standard_output;
+
+
+/*
+ * The AVR code's interrupt handlers. If the AVR code enables an interrupt without
+ * providing a handler, we stop, rather than quietly ignoring it.
+ */
+static void report_missing_interrupt_handler(const char * name) {
+  fprintf(stderr, "virtual AVR: %s fired, but no handler (ISR) exists for it\n", name);
+  abort();
+}
+
+void __attribute__((weak)) PCINT0_vect(void)     { report_missing_interrupt_handler("PCINT0_vect"); }
+void __attribute__((weak)) PCINT1_vect(void)     { report_missing_interrupt_handler("PCINT1_vect"); }
+void __attribute__((weak)) PCINT2_vect(void)     { report_missing_interrupt_handler("PCINT2_vect"); }
+void __attribute__((weak)) TIMER0_COMPA_vect(void) { report_missing_interrupt_handler("TIMER0_COMPA_vect"); }
+void __attribute__((weak)) TIMER0_COMPB_vect(void) { report_missing_interrupt_handler("TIMER0_COMPB_vect"); }
+void __attribute__((weak)) TIMER0_OVF_vect(void)   { report_missing_interrupt_handler("TIMER0_OVF_vect"); }
+void __attribute__((weak)) USART_RX_vect(void)   { report_missing_interrupt_handler("USART_RX_vect"); }
+void __attribute__((weak)) USART_UDRE_vect(void) { report_missing_interrupt_handler("USART_UDRE_vect"); }
+void __attribute__((weak)) TWI_vect(void)        { report_missing_interrupt_handler("TWI_vect"); }
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Provides access to the simulated register at the given data-space address.
+ */
+volatile uint8_t * virtual_avr_register(uint16_t address) {
+
+  set_up_register_file();
+
+  //Let the peripherals react to whatever the AVR code did since its last access,
+  //and let a little time pass; this may fire interrupts.
+  settle_register_accesses();
+  advance_time(VIRTUAL_AVR_CYCLES_PER_ACCESS);
+
+  //The timer's count changes on its own; so make sure a read sees its current value.
+  if(address == ADDRESS_TCNT0) {
+    set_register(ADDRESS_TCNT0, current_timer0_count());
+  }
+
+  //Note this access, and make sure we'll catch any write.
+  last_accessed_register = address;
+  make_register_file_read_only();
+
+  return &register_file[address];
+}
+
+
+/*
+ * @return The data-space address of the given simulated register.
+ */
+uint16_t virtual_avr_register_address(volatile uint8_t * reg) {
+  return (uint16_t)(reg - register_file);
+}
+
+
+/*
+ * Advances the virtual AVR's clock by the given number of CPU cycles.
+ */
+void virtual_avr_delay_cycles(uint64_t cycles) {
+  set_up_register_file();
+  settle_register_accesses();
+  advance_time(cycles);
+}
+
+
+/*
+ * Puts the CPU to sleep, if the sleep enable bit is set, until an interrupt fires.
+ */
+void virtual_avr_sleep(void) {
+
+  uint64_t event;
+
+  set_up_register_file();
+  settle_register_accesses();
+
+  if(!(register_file[ADDRESS_SMCR] & _BV(SE))) {
+    return;
+  }
+
+  //Sleep until an interrupt has been handled. We skip straight from one peripheral event to the
+  //next; between events, nothing can change, so there's nothing to wake us.
+  while(!deliver_interrupts_and_count()) {
+
+    event = next_peripheral_event();
+
+    //If nothing is scheduled, and no interrupt is waiting, we'll sleep until the power's cut.
+    if((event == UINT64_MAX) || !interrupt_can_wake_cpu()) {
+      if(!time_limit) {
+        fprintf(stderr, "virtual AVR: went to sleep, with nothing to wake it\n");
+        abort();
+      }
+      event = time_limit;
+    }
+
+    if(event > elapsed_cycles) {
+      sleeping_cycles += event - elapsed_cycles;
+      elapsed_cycles   = event;
+    }
+
+    stop_if_out_of_time();
+    update_peripherals();
+  }
+}
+
+
+/*
+ * @return The number of CPU cycles which have elapsed on the virtual AVR.
+ */
+uint64_t virtual_avr_cycles() {
+  return elapsed_cycles;
+}
+
+
+/*
+ * @return The number of CPU cycles the virtual AVR has spent asleep.
+ */
+uint64_t virtual_avr_sleeping_cycles() {
+  return sleeping_cycles;
+}
+
+
+/*
+ * Sets a limit on how long the virtual AVR may run.
+ */
+void set_virtual_avr_time_limit(uint64_t cycles) {
+  time_limit = cycles;
+}
+
+
+/*
+ * Adds a simulated device to the TWI bus.
+ */
+void attach_virtual_twi_device(VirtualTWIDevice * device) {
+  device->next = twi_devices;
+  twi_devices  = device;
+}
+
+
+/*
+ * Removes a simulated device from the TWI bus.
+ */
+void detach_virtual_twi_device(VirtualTWIDevice * device) {
+
+  VirtualTWIDevice ** link;
+
+  for(link = &twi_devices; *link; link = &(*link)->next) {
+    if(*link == device) {
+      *link = device->next;
+      break;
+    }
+  }
+
+  if(selected_twi_device == device) {
+    selected_twi_device = 0;
+  }
+}
+
+
+/*
+ * @return The TWI bus activity since the virtual AVR started.
+ */
+VirtualTWIStatistics virtual_twi_statistics() {
+
+  VirtualTWIStatistics statistics = twi_statistics;
+
+  //Include the current transaction, if there is one.
+  if(twi_bus_claimed) {
+    statistics.busy_cycles += elapsed_cycles - twi_bus_claimed_at;
+  }
+
+  return statistics;
+}
+
+
+/*
+ * Holds the TWI clock low, delaying the end of the current operation.
+ */
+void stretch_virtual_twi_clock(uint64_t cycles) {
+  twi_clock_stretch += cycles;
+}
+
+
+/*
+ * Drives one of the AVR's pins from outside.
+ */
+void drive_virtual_pin(VirtualPort port, uint8_t bit, uint8_t level) {
+
+  set_up_register_file();
+
+  driven_pins[port] |= _BV(bit);
+  driven_pin_levels[port] = level ? (driven_pin_levels[port] | _BV(bit)) : (driven_pin_levels[port] & ~_BV(bit));
+  update_pin_register(port);
+}
+
+
+/*
+ * Stops driving one of the AVR's pins from outside.
+ */
+void release_virtual_pin(VirtualPort port, uint8_t bit) {
+
+  set_up_register_file();
+
+  driven_pins[port] &= ~_BV(bit);
+  update_pin_register(port);
+}
+
+
+/*
+ * Connects the simulated TWI devices to a pair of the AVR's pins, as well as to the TWI hardware.
+ */
+void connect_virtual_twi_pins(VirtualPort port, uint8_t sda_bit, uint8_t scl_bit) {
+
+  set_up_register_file();
+
+  twi_pins_connected = 1;
+  twi_pins_port      = port;
+  twi_sda_bit        = sda_bit;
+  twi_scl_bit        = scl_bit;
+  pin_twi_state      = PinTWIIdle;
+}
+
+
+/*
+ * Sets the function which receives each byte the USART transmits.
+ */
+void set_virtual_uart_output(void (*output)(uint8_t data)) {
+  uart_output = output;
+}
+
+
+/*
+ * Has the USART receive the given bytes, one at a time, as the AVR code reads them.
+ */
+void send_to_virtual_uart(const uint8_t * data, uint16_t length) {
+
+  uint32_t waiting = uart_receive_queue_length - uart_receive_queue_position;
+  uint8_t * queue = malloc(waiting + length);
+
+  if(!queue) {
+    abort();
+  }
+
+  //Add the new bytes to the end of the queue, discarding any we've already received.
+  memcpy(queue, uart_receive_queue + uart_receive_queue_position, waiting);
+  memcpy(queue + waiting, data, length);
+  free(uart_receive_queue);
+
+  uart_receive_queue          = queue;
+  uart_receive_queue_length   = waiting + length;
+  uart_receive_queue_position = 0;
+
+  //If the USART's waiting for a byte, hand it the first one now.
+  set_up_register_file();
+  if(!uart_receive_complete) {
+    receive_next_uart_byte();
+  }
+}
+
+
+/*
+ * -------------------------------------
+ * Register File
+ * -------------------------------------
+ */
+
+/*
+ * Creates the register file, in its own page of memory; and sets up the fault handlers
+ * we use to notice writes. Does nothing if the register file already exists.
+ */
+static void set_up_register_file() {
+
+  struct sigaction fault_action;
+  long page_size = sysconf(_SC_PAGESIZE);
+
+  if(register_file) {
+    return;
+  }
+
+  //The register file needs at least 256 bytes, and must occupy whole pages.
+  register_file_size = ((256 + page_size - 1) / page_size) * page_size;
+  register_file = mmap(0, register_file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if(register_file == MAP_FAILED) {
+    perror("virtual AVR: couldn't create the register file");
+    abort();
+  }
+
+  //Catch faults, which are how we notice writes. (Some systems report writes to
+  //read-only memory as bus errors, rather than segmentation faults.)
+  memset(&fault_action, 0, sizeof(fault_action));
+  fault_action.sa_sigaction = handle_register_fault;
+  fault_action.sa_flags     = SA_SIGINFO;
+  sigemptyset(&fault_action.sa_mask);
+
+  sigaction(SIGSEGV, &fault_action, &previous_segmentation_fault_action);
+  sigaction(SIGBUS,  &fault_action, &previous_bus_error_action);
+
+  //Set up each register's value at reset.
+  register_file[ADDRESS_PINB]   = 0xFF;
+  register_file[ADDRESS_PINC]   = 0x7F;
+  register_file[ADDRESS_PIND]   = 0xFF;
+  register_file[ADDRESS_TWSR]   = TW_NO_INFO;
+  register_file[ADDRESS_TWDR]   = 0xFF;
+  register_file[ADDRESS_UCSR0A] = _BV(UDRE0);
+  register_file[ADDRESS_UCSR0C] = 0x06;
+}
+
+
+/*
+ * Called when the AVR code writes to the (read-only) register file. Notes which register
+ * was written, and then makes the register file writable, so the write can go ahead.
+ */
+static void handle_register_fault(int signal_number, siginfo_t * information, void * context) {
+
+  uint8_t * address = information->si_addr;
+  (void)context;
+
+  //If this fault isn't in the register file, it's a genuine crash. Put back the previous
+  //handler, and return; the faulting instruction will run again, and fault for real.
+  if(!register_file || (address < register_file) || (address >= register_file + register_file_size)) {
+    sigaction(SIGSEGV, &previous_segmentation_fault_action, 0);
+    sigaction(SIGBUS, &previous_bus_error_action, 0);
+    return;
+  }
+
+  if(pending_write_count < MAXIMUM_PENDING_WRITES) {
+    pending_writes[pending_write_count++] = address - register_file;
+  }
+
+  mprotect(register_file, register_file_size, PROT_READ | PROT_WRITE);
+  register_file_writable = 1;
+  (void)signal_number;
+}
+
+
+/*
+ * Allows the register file to be written without faulting. Used when the models update registers.
+ */
+static void make_register_file_writable() {
+  if(!register_file_writable) {
+    mprotect(register_file, register_file_size, PROT_READ | PROT_WRITE);
+    register_file_writable = 1;
+  }
+}
+
+
+/*
+ * Makes the register file read-only, so we'll notice the AVR code's next write.
+ */
+static void make_register_file_read_only() {
+  if(register_file_writable) {
+    register_file_writable = 0;
+    mprotect(register_file, register_file_size, PROT_READ);
+  }
+}
+
+
+/*
+ * Sets the value of a register, on behalf of a peripheral model.
+ */
+static void set_register(uint16_t address, uint8_t value) {
+  make_register_file_writable();
+  register_file[address] = value;
+}
+
+
+/*
+ * Lets the peripheral models react to each register written since we last checked; and
+ * to the last register accessed, if it was read.
+ */
+static void settle_register_accesses() {
+
+  uint8_t last_access_was_write = 0;
+  sig_atomic_t i;
+
+  for(i = 0; i < pending_write_count; ++i) {
+    last_access_was_write |= (pending_writes[i] == last_accessed_register);
+    handle_register_write(pending_writes[i]);
+  }
+  pending_write_count = 0;
+
+  if((last_accessed_register >= 0) && !last_access_was_write) {
+    handle_register_read(last_accessed_register);
+  }
+  last_accessed_register = -1;
+}
+
+
+/*
+ * Lets the peripheral models react to a write to the given register.
+ */
+static void handle_register_write(uint16_t address) {
+
+  switch(address) {
+
+    //Writing a one to a PIN bit toggles the matching PORT bit; the PIN register itself
+    //is read-only.
+    case ADDRESS_PINB:
+    case ADDRESS_PINC:
+    case ADDRESS_PIND:
+      set_register(address + 2, register_file[address + 2] ^ register_file[address]);
+      update_pin_register((address - ADDRESS_PINB) / 3);
+      break;
+
+    //Changing a pin's direction, or the level it's driven to, can change its level.
+    case ADDRESS_DDRB:
+    case ADDRESS_PORTB:
+    case ADDRESS_DDRC:
+    case ADDRESS_PORTC:
+    case ADDRESS_DDRD:
+    case ADDRESS_PORTD:
+      update_pin_register((address - ADDRESS_PINB) / 3);
+      break;
+
+    //Writing a one to a pin change interrupt flag clears it.
+    case ADDRESS_PCIFR:
+      pin_change_flags &= ~register_file[ADDRESS_PCIFR];
+      set_register(ADDRESS_PCIFR, pin_change_flags);
+      break;
+
+    case ADDRESS_TIFR0:
+    case ADDRESS_TCCR0A:
+    case ADDRESS_TCCR0B:
+    case ADDRESS_TCNT0:
+    case ADDRESS_OCR0A:
+    case ADDRESS_OCR0B:
+      handle_timer0_write(address);
+      break;
+
+    case ADDRESS_TWCR:
+      handle_twi_control_write();
+      break;
+
+    //Only the prescaler bits of TWSR are writable.
+    case ADDRESS_TWSR:
+      set_twi_status(twi_status);
+      break;
+
+    case ADDRESS_UCSR0A:
+      handle_uart_status_write();
+      break;
+
+    //Enabling the receiver lets it pick up any bytes that are waiting.
+    case ADDRESS_UCSR0B:
+      if(!uart_receive_complete) {
+        receive_next_uart_byte();
+      }
+      break;
+
+    //Writing UDR0 transmits a byte; reads still see the last byte received.
+    case ADDRESS_UDR0:
+      transmit_via_uart(register_file[ADDRESS_UDR0]);
+      set_register(ADDRESS_UDR0, uart_received_byte);
+      break;
+  }
+}
+
+
+/*
+ * Lets the peripheral models react to a read from the given register.
+ */
+static void handle_register_read(uint16_t address) {
+
+  //Reading UDR0 consumes the received byte; move on to the next one.
+  if((address == ADDRESS_UDR0) && uart_receive_complete) {
+    uart_receive_complete = 0;
+    receive_next_uart_byte();
+  }
+}
+
+
+/*
+ * -------------------------------------
+ * Time and Interrupts
+ * -------------------------------------
+ */
+
+/*
+ * Lets the given number of CPU cycles pass, and delivers any pending interrupts.
+ */
+static void advance_time(uint64_t cycles) {
+
+  uint64_t target = elapsed_cycles + cycles;
+  uint64_t event;
+
+  //Let time pass one peripheral event at a time, so each interrupt fires when it should--
+  //even in the middle of a long delay.
+  while((event = next_peripheral_event()) <= target) {
+
+    if(event > elapsed_cycles) {
+      elapsed_cycles = event;
+    }
+
+    stop_if_out_of_time();
+    update_peripherals();
+    deliver_interrupts();
+  }
+
+  //An interrupt handler may have used up more than our share of time; if so, don't go backwards.
+  if(target > elapsed_cycles) {
+    elapsed_cycles = target;
+  }
+
+  stop_if_out_of_time();
+  deliver_interrupts();
+}
+
+
+/*
+ * If we've run out of time, stops here, as though the device had been switched off.
+ */
+static void stop_if_out_of_time() {
+  if(time_limit && (elapsed_cycles >= time_limit)) {
+    fflush(stdout);
+    exit(0);
+  }
+}
+
+
+/*
+ * @return The time (in CPU cycles) of the next thing a peripheral (or a simulated device)
+ *    will do on its own; or UINT64_MAX, if there's nothing scheduled.
+ */
+static uint64_t next_peripheral_event() {
+
+  uint64_t next = twi_operation_pending ? twi_operation_ends_at : UINT64_MAX;
+  uint64_t event = next_timer0_event();
+  VirtualTWIDevice * device;
+
+  if(event < next) {
+    next = event;
+  }
+
+  if(pin_twi_clock_held_until && (pin_twi_clock_held_until < next)) {
+    next = pin_twi_clock_held_until;
+  }
+
+  for(device = twi_devices; device; device = device->next) {
+    if(device->next_event && ((event = device->next_event(device)) < next)) {
+      next = event;
+    }
+  }
+
+  return next;
+}
+
+
+/*
+ * Lets each peripheral (and simulated device) do whatever it has scheduled for the current time.
+ */
+static void update_peripherals() {
+
+  VirtualTWIDevice * device;
+
+  if(twi_operation_pending && (twi_operation_ends_at <= elapsed_cycles)) {
+    complete_twi_operation();
+  }
+
+  update_timer0();
+
+  //A device which has been stretching the clock on the bit-banged bus lets it go.
+  if(pin_twi_clock_held_until && (pin_twi_clock_held_until <= elapsed_cycles)) {
+    pin_twi_clock_held_until = 0;
+    release_virtual_pin(twi_pins_port, twi_scl_bit);
+  }
+
+  for(device = twi_devices; device; device = device->next) {
+    if(device->next_event && device->update && (device->next_event(device) <= elapsed_cycles)) {
+      device->update(device);
+    }
+  }
+}
+
+
+/*
+ * Runs the handler for each pending interrupt, as long as interrupts are enabled.
+ */
+static void deliver_interrupts() {
+  deliver_interrupts_and_count();
+}
+
+
+/*
+ * Runs the handler for each pending interrupt, as long as interrupts are enabled.
+ * @return The number of handlers run.
+ */
+static uint8_t deliver_interrupts_and_count() {
+
+  void (*handler)(void);
+  uint8_t count = 0;
+
+  while((register_file[ADDRESS_SREG] & _BV(SREG_I)) && (handler = pending_interrupt())) {
+
+    //Like the real hardware, clear the I-bit while the handler runs; and set it again
+    //when the handler returns. Pin change and timer flags are cleared as their handlers start.
+    set_register(ADDRESS_SREG, register_file[ADDRESS_SREG] & ~_BV(SREG_I));
+    clear_pin_change_flag(handler);
+    clear_timer0_flag(handler);
+    handler();
+    settle_register_accesses();
+    set_register(ADDRESS_SREG, register_file[ADDRESS_SREG] | _BV(SREG_I));
+
+    //Keep count, but don't let a constantly-firing interrupt overflow it.
+    if(count < UINT8_MAX) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+
+/*
+ * @return True iff an interrupt could wake the CPU: i.e. interrupts are enabled globally, and
+ *    at least one interrupt source is enabled. Used to spot code that sleeps forever.
+ */
+static uint8_t interrupt_can_wake_cpu() {
+
+  uint8_t enabled_sources = register_file[ADDRESS_PCICR] | (register_file[ADDRESS_TWCR] & _BV(TWIE)) |
+      (register_file[ADDRESS_UCSR0B] & (_BV(RXCIE0) | _BV(UDRIE0))) | (timer0_clock_period() ? register_file[ADDRESS_TIMSK0] : 0);
+
+  return (register_file[ADDRESS_SREG] & _BV(SREG_I)) && enabled_sources;
+}
+
+
+/*
+ * @return The handler for the highest-priority pending interrupt, or 0 if none is pending.
+ */
+static void (*pending_interrupt())(void) {
+
+  uint8_t uart_control = register_file[ADDRESS_UCSR0B];
+  uint8_t uart_status  = register_file[ADDRESS_UCSR0A];
+  uint8_t twi_control  = register_file[ADDRESS_TWCR];
+  uint8_t pin_changes  = pin_change_flags & register_file[ADDRESS_PCICR];
+  uint8_t timer0_interrupts = timer0_flags & register_file[ADDRESS_TIMSK0];
+
+  //Interrupts are listed in order of priority, which matches their order in the vector table.
+  if(pin_changes & _BV(VirtualPortB)) {
+    return PCINT0_vect;
+  }
+  if(pin_changes & _BV(VirtualPortC)) {
+    return PCINT1_vect;
+  }
+  if(pin_changes & _BV(VirtualPortD)) {
+    return PCINT2_vect;
+  }
+
+  if(timer0_interrupts & _BV(OCF0A)) {
+    return TIMER0_COMPA_vect;
+  }
+  if(timer0_interrupts & _BV(OCF0B)) {
+    return TIMER0_COMPB_vect;
+  }
+  if(timer0_interrupts & _BV(TOV0)) {
+    return TIMER0_OVF_vect;
+  }
+
+  if((uart_control & _BV(RXCIE0)) && (uart_status & _BV(RXC0))) {
+    return USART_RX_vect;
+  }
+
+  if((uart_control & _BV(UDRIE0)) && (uart_status & _BV(UDRE0))) {
+    return USART_UDRE_vect;
+  }
+
+  if((twi_control & _BV(TWIE)) && (twi_control & _BV(TWEN)) && twi_interrupt_flag) {
+    return TWI_vect;
+  }
+
+  return 0;
+}
+
+
+/*
+ * -------------------------------------
+ * Pin Model
+ * -------------------------------------
+ */
+
+/*
+ * @return The data-space address of the given port's PIN register. Each port's
+ *    PIN, DDR and PORT registers follow each other, in that order.
+ */
+static uint16_t pin_register_address(VirtualPort port) {
+  return ADDRESS_PINB + (3 * port);
+}
+
+
+/*
+ * @return The levels of the given port's pins. Every pin is pulled up, and reads as high
+ *    unless something pulls it low: either the AVR, when the pin is an output whose PORT bit
+ *    is clear; or a device driving it low. So a line which several parties drive low, and
+ *    otherwise release, behaves like an open-drain bus. (Port C has only seven pins.)
+ */
+static uint8_t pin_levels(VirtualPort port) {
+
+  uint16_t address    = pin_register_address(port);
+  uint8_t pins        = (port == VirtualPortC) ? 0x7F : 0xFF;
+  uint8_t avr_levels  = ~register_file[address + 1] | register_file[address + 2];
+  uint8_t device_levels = ~driven_pins[port] | driven_pin_levels[port];
+
+  return pins & avr_levels & device_levels;
+}
+
+
+/*
+ * Brings the given port's PIN register up to date with its pins' levels; and, if any pin
+ * selected in the port's pin change mask has changed, sets its pin change interrupt flag.
+ */
+static void update_pin_register(VirtualPort port) {
+
+  uint8_t previous_levels = previous_pin_levels[port];
+  uint8_t levels          = pin_levels(port);
+
+  previous_pin_levels[port] = levels;
+  set_register(pin_register_address(port), levels);
+
+  //Each port has its own mask register; PCMSK0 for port B, and so on.
+  if((previous_levels ^ levels) & register_file[ADDRESS_PCMSK0 + port]) {
+    pin_change_flags |= _BV(port);
+    set_register(ADDRESS_PCIFR, pin_change_flags);
+  }
+
+  //If the port carries a bit-banged TWI bus, let its devices see what's changed.
+  if(twi_pins_connected && (port == twi_pins_port) && (previous_levels != levels)) {
+    watch_twi_pins(previous_levels, levels);
+  }
+}
+
+
+/*
+ * Clears the flag for the given interrupt handler, if it handles a pin change interrupt.
+ */
+static void clear_pin_change_flag(void (*handler)(void)) {
+
+  if(handler == PCINT0_vect) {
+    pin_change_flags &= ~_BV(VirtualPortB);
+  } else if(handler == PCINT1_vect) {
+    pin_change_flags &= ~_BV(VirtualPortC);
+  } else if(handler == PCINT2_vect) {
+    pin_change_flags &= ~_BV(VirtualPortD);
+  }
+
+  set_register(ADDRESS_PCIFR, pin_change_flags);
+}
+
+
+/*
+ * -------------------------------------
+ * Timer Model
+ * -------------------------------------
+ */
+
+/*
+ * Reacts to a write to one of timer/counter 0's registers. Only the normal and CTC modes are
+ * modeled; the compare match outputs (OC0A/OC0B) aren't.
+ */
+static void handle_timer0_write(uint16_t address) {
+
+  //Count up to now with the old settings, so the new ones only apply from here on.
+  synchronize_timer0();
+
+  switch(address) {
+
+    //Writing a one to an interrupt flag clears it.
+    case ADDRESS_TIFR0:
+      timer0_flags &= ~register_file[ADDRESS_TIFR0];
+      set_register(ADDRESS_TIFR0, timer0_flags);
+      break;
+
+    //Writing the count restarts the prescaler, too.
+    case ADDRESS_TCNT0:
+      timer0_count      = register_file[ADDRESS_TCNT0];
+      timer0_counted_at = elapsed_cycles;
+      break;
+
+    //Starting the clock starts it from now.
+    case ADDRESS_TCCR0B:
+      if(!timer0_clock_period()) {
+        timer0_counted_at = elapsed_cycles;
+      }
+      timer0_control_b = register_file[ADDRESS_TCCR0B];
+      break;
+
+    case ADDRESS_TCCR0A:
+      timer0_control_a = register_file[ADDRESS_TCCR0A];
+      break;
+
+    case ADDRESS_OCR0A:
+      timer0_compare_a = register_file[ADDRESS_OCR0A];
+      break;
+
+    case ADDRESS_OCR0B:
+      timer0_compare_b = register_file[ADDRESS_OCR0B];
+      break;
+  }
+}
+
+
+/*
+ * @return The number of CPU cycles per count, as set by the prescaler; or 0 if the timer is
+ *    stopped. (The external clock settings count as stopped.)
+ */
+static uint32_t timer0_clock_period() {
+  static const uint32_t prescalers[] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+  return prescalers[timer0_control_b & CS_MASK];
+}
+
+
+/*
+ * @return The count after which the timer wraps back to zero: OCR0A in CTC mode, or 0xFF otherwise.
+ */
+static uint8_t timer0_top() {
+  uint8_t ctc_mode = (timer0_control_a & _BV(WGM01)) && !(timer0_control_b & _BV(WGM02));
+  return ctc_mode ? timer0_compare_a : 0xFF;
+}
+
+
+/*
+ * @return The timer's count, now. (It never passes its top without update_timer0
+ *    noticing; so the count since it was last brought up to date never wraps.)
+ */
+static uint8_t current_timer0_count() {
+
+  uint32_t period = timer0_clock_period();
+
+  if(!period) {
+    return timer0_count;
+  }
+
+  return timer0_count + (elapsed_cycles - timer0_counted_at) / period;
+}
+
+
+/*
+ * Brings the timer's count up to date, keeping it aligned with the timer's clock.
+ */
+static void synchronize_timer0() {
+
+  uint32_t period = timer0_clock_period();
+  uint64_t counts;
+
+  if(!period) {
+    return;
+  }
+
+  counts             = (elapsed_cycles - timer0_counted_at) / period;
+  timer0_count      += counts;
+  timer0_counted_at += counts * period;
+}
+
+
+/*
+ * @return The time (in CPU cycles) the timer next sets one of its flags; or UINT64_MAX, if it's stopped.
+ *    Each flag is set as the count moves on from the matching value: OCR0A or OCR0B for the
+ *    compare matches, or the top (or 0xFF, if the count is already past the top) for wrapping around.
+ */
+static uint64_t next_timer0_event() {
+
+  uint32_t period = timer0_clock_period();
+  uint8_t top     = (timer0_count > timer0_top()) ? 0xFF : timer0_top();
+  uint8_t values[] = { top, timer0_compare_a, timer0_compare_b };
+  uint64_t next = UINT64_MAX, event;
+  uint8_t i;
+
+  if(!period) {
+    return UINT64_MAX;
+  }
+
+  for(i = 0; i < sizeof(values); ++i) {
+    if((values[i] >= timer0_count) && (values[i] <= top)) {
+      event = timer0_counted_at + (uint64_t)(values[i] - timer0_count + 1) * period;
+      next  = (event < next) ? event : next;
+    }
+  }
+
+  return next;
+}
+
+
+/*
+ * Moves the timer on through each of its events up to now, setting its flags as it goes.
+ */
+static void update_timer0() {
+
+  uint64_t event;
+  uint8_t top, last_count;
+
+  while((event = next_timer0_event()) <= elapsed_cycles) {
+
+    top        = (timer0_count > timer0_top()) ? 0xFF : timer0_top();
+    last_count = timer0_count + (event - timer0_counted_at) / timer0_clock_period() - 1;
+
+    //Set the flag for each compare match we've moved past...
+    if((timer0_compare_a >= timer0_count) && (timer0_compare_a <= last_count)) {
+      timer0_flags |= _BV(OCF0A);
+    }
+    if((timer0_compare_b >= timer0_count) && (timer0_compare_b <= last_count)) {
+      timer0_flags |= _BV(OCF0B);
+    }
+
+    //... and wrap around, once we pass the top. Overflow is counting past 0xFF.
+    if(last_count == top) {
+      timer0_flags |= (top == 0xFF) ? _BV(TOV0) : 0;
+      timer0_count  = 0;
+    } else {
+      timer0_count  = last_count + 1;
+    }
+
+    timer0_counted_at = event;
+    set_register(ADDRESS_TIFR0, timer0_flags);
+  }
+}
+
+
+/*
+ * Clears the flag for the given interrupt handler, if it handles one of the timer's interrupts.
+ */
+static void clear_timer0_flag(void (*handler)(void)) {
+
+  if(handler == TIMER0_COMPA_vect) {
+    timer0_flags &= ~_BV(OCF0A);
+  } else if(handler == TIMER0_COMPB_vect) {
+    timer0_flags &= ~_BV(OCF0B);
+  } else if(handler == TIMER0_OVF_vect) {
+    timer0_flags &= ~_BV(TOV0);
+  }
+
+  set_register(ADDRESS_TIFR0, timer0_flags);
+}
+
+
+/*
+ * -------------------------------------
+ * TWI Model
+ * -------------------------------------
+ */
+
+/*
+ * Reacts to a write to TWCR.
+ */
+static void handle_twi_control_write() {
+
+  uint8_t control = register_file[ADDRESS_TWCR];
+
+  //Disabling the TWI hardware aborts whatever it was doing, and releases the bus.
+  if(!(control & _BV(TWEN))) {
+    release_twi_bus();
+    twi_state             = TWIIdle;
+    twi_operation_pending = 0;
+    twi_stop_pending      = 0;
+    twi_start_after_stop  = 0;
+    twi_interrupt_flag    = 0;
+    selected_twi_device = 0;
+    set_twi_status(TW_NO_INFO);
+    update_twi_control_register(control);
+    return;
+  }
+
+  //Writing a one to TWINT clears the interrupt flag, and starts the next operation.
+  if(control & _BV(TWINT)) {
+    twi_interrupt_flag = 0;
+    perform_twi_operation(control);
+  }
+
+  update_twi_control_register(control);
+}
+
+
+/*
+ * Starts the operation requested by a write to TWCR. The devices on the bus react right
+ * away; but the results aren't visible (and TWINT isn't set) until the operation has
+ * taken as long as it would on the real bus.
+ */
+static void perform_twi_operation(uint8_t control) {
+
+  uint8_t data = register_file[ADDRESS_TWDR];
+  uint8_t acknowledged, direction;
+  VirtualTWIDevice * device;
+
+  //A stop condition ends communication with the selected device. The hardware doesn't
+  //set TWINT afterwards; it just clears TWSTO once the bus is free. If TWSTA is set too,
+  //a start condition follows as soon as the stop is done.
+  if(control & _BV(TWSTO)) {
+
+    if(selected_twi_device && selected_twi_device->stop) {
+      selected_twi_device->stop(selected_twi_device);
+    }
+
+    selected_twi_device  = 0;
+    twi_stop_pending     = 1;
+    twi_start_after_stop = (control & _BV(TWSTA)) != 0;
+    schedule_twi_completion(1, TW_NO_INFO);
+    return;
+  }
+
+  //A start condition-- or a repeated start, if we're already using the bus-- is always
+  //followed by a device address.
+  if(control & _BV(TWSTA)) {
+
+    if(twi_state == TWIIdle) {
+      claim_twi_bus();
+    }
+
+    schedule_twi_completion(1, (twi_state == TWIIdle) ? TW_START : TW_REP_START);
+    twi_state           = TWIAddressNext;
+    selected_twi_device = 0;
+    return;
+  }
+
+  switch(twi_state) {
+
+    //Send the address (and direction bit) in TWDR, and see if anyone answers.
+    case TWIAddressNext:
+      direction    = data & 0x01;
+      device       = find_twi_device(data >> 1);
+      acknowledged = device && (!device->select || device->select(device, direction));
+
+      selected_twi_device = acknowledged ? device : 0;
+      twi_state           = direction ? TWIReceiving : TWITransmitting;
+
+      if(direction) {
+        schedule_twi_completion(9, acknowledged ? TW_MR_SLA_ACK : TW_MR_SLA_NACK);
+      } else {
+        schedule_twi_completion(9, acknowledged ? TW_MT_SLA_ACK : TW_MT_SLA_NACK);
+      }
+      break;
+
+    //Send the byte in TWDR to the selected device. If no device is listening, nobody
+    //acknowledges it.
+    case TWITransmitting:
+      device       = selected_twi_device;
+      acknowledged = device && (!device->write || device->write(device, data));
+      schedule_twi_completion(9, acknowledged ? TW_MT_DATA_ACK : TW_MT_DATA_NACK);
+      break;
+
+    //Read a byte from the selected device, and acknowledge it if TWEA is set. If no
+    //device is talking, the bus idles high.
+    case TWIReceiving:
+      device            = selected_twi_device;
+      twi_received_byte = (device && device->read) ? device->read(device) : 0xFF;
+      schedule_twi_completion(9, (control & _BV(TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK);
+      break;
+
+    //Without a start condition, there's nothing to do.
+    default:
+      return;
+  }
+
+  twi_statistics.bytes++;
+}
+
+
+/*
+ * Schedules the end of the operation that's just started.
+ *
+ * @param clocks The length of the operation, in SCL periods: nine for each byte (eight
+ *    data bits, and an acknowledge bit), or one for a start or stop condition.
+ * @param status The value of TWSR once the operation is complete.
+ */
+static void schedule_twi_completion(uint8_t clocks, uint8_t status) {
+
+  twi_operation_pending = 1;
+  twi_operation_ends_at = elapsed_cycles + (uint64_t)clocks * twi_clock_period() + twi_clock_stretch;
+  twi_completion_status = status;
+  twi_clock_stretch     = 0;
+
+  //Like the real hardware, TWSR has no useful status while an operation is underway.
+  set_twi_status(TW_NO_INFO);
+}
+
+
+/*
+ * Ends the operation in progress, making its results visible to the AVR code.
+ */
+static void complete_twi_operation() {
+
+  twi_operation_pending = 0;
+
+  //Once a stop condition has been sent, the bus is free; the hardware clears TWSTO,
+  //but doesn't set TWINT.
+  if(twi_stop_pending) {
+    twi_stop_pending = 0;
+    release_twi_bus();
+    twi_state = TWIIdle;
+    set_register(ADDRESS_TWCR, register_file[ADDRESS_TWCR] & ~_BV(TWSTO));
+
+    if(twi_start_after_stop) {
+      twi_start_after_stop = 0;
+      perform_twi_operation(_BV(TWSTA));
+    }
+    return;
+  }
+
+  if(twi_state == TWIReceiving) {
+    set_register(ADDRESS_TWDR, twi_received_byte);
+  }
+
+  set_twi_status(twi_completion_status);
+  twi_interrupt_flag = 1;
+  set_register(ADDRESS_TWCR, register_file[ADDRESS_TWCR] | _BV(TWINT));
+}
+
+
+/*
+ * @return The length of one SCL period, in CPU cycles, as set by TWBR and the prescaler in TWSR.
+ */
+static uint32_t twi_clock_period() {
+  return 16 + ((uint32_t)register_file[ADDRESS_TWBR] << (1 + 2 * (register_file[ADDRESS_TWSR] & 0x03)));
+}
+
+
+/*
+ * Sets the status bits of TWSR, leaving its prescaler bits alone.
+ */
+static void set_twi_status(uint8_t status) {
+  twi_status = status;
+  set_register(ADDRESS_TWSR, (register_file[ADDRESS_TWSR] & 0x03) | status);
+}
+
+
+/*
+ * Updates TWCR after a write: TWINT reflects the interrupt flag, rather than the value
+ * written; and TWSTO stays set only while a stop condition is being sent.
+ */
+static void update_twi_control_register(uint8_t control) {
+
+  control &= ~(_BV(TWINT) | _BV(TWSTO));
+
+  if(twi_stop_pending) {
+    control |= _BV(TWSTO);
+  }
+
+  if(twi_interrupt_flag) {
+    control |= _BV(TWINT);
+  }
+
+  set_register(ADDRESS_TWCR, control);
+}
+
+
+/*
+ * @return The device on the bus with the given address, or 0 if there isn't one.
+ */
+static VirtualTWIDevice * find_twi_device(uint8_t address) {
+
+  VirtualTWIDevice * device;
+
+  for(device = twi_devices; device; device = device->next) {
+    if(device->address == address) {
+      return device;
+    }
+  }
+
+  return 0;
+}
+
+
+/*
+ * Notes the start of a transaction, for the bus statistics.
+ */
+static void claim_twi_bus() {
+  twi_statistics.transactions++;
+  twi_bus_claimed    = 1;
+  twi_bus_claimed_at = elapsed_cycles;
+}
+
+
+/*
+ * Notes the end of a transaction (if one was in progress), for the bus statistics.
+ */
+static void release_twi_bus() {
+  if(twi_bus_claimed) {
+    twi_statistics.busy_cycles += elapsed_cycles - twi_bus_claimed_at;
+    twi_bus_claimed = 0;
+  }
+}
+
+
+/*
+ * -------------------------------------
+ * Bit-Banged TWI Model
+ * -------------------------------------
+ */
+
+/*
+ * Follows the master's use of the TWI pins, after their levels change: SDA changing while SCL
+ * is high is a start or stop condition; otherwise, bits are read as SCL rises, and each device
+ * sets up its next bit once SCL has fallen.
+ */
+static void watch_twi_pins(uint8_t previous_levels, uint8_t levels) {
+
+  uint8_t scl_was_high = (previous_levels >> twi_scl_bit) & 1;
+  uint8_t scl_is_high  = (levels >> twi_scl_bit) & 1;
+  uint8_t sda_was_high = (previous_levels >> twi_sda_bit) & 1;
+  uint8_t sda_is_high  = (levels >> twi_sda_bit) & 1;
+
+  //A start condition is SDA falling while SCL is high; and a stop condition is SDA rising.
+  if(scl_was_high && scl_is_high && (sda_was_high != sda_is_high)) {
+    if(sda_is_high) {
+      stop_pin_twi_packet();
+    } else {
+      start_pin_twi_packet();
+    }
+    return;
+  }
+
+  //As SCL rises, read the bit on SDA: one of the master's data bits, or its acknowledge bit.
+  if(!scl_was_high && scl_is_high) {
+
+    if(pin_twi_state == PinTWIReceiving) {
+      pin_twi_byte = (pin_twi_byte << 1) | sda_is_high;
+      ++pin_twi_bits;
+    } else if(pin_twi_state == PinTWIAwaitingAcknowledge) {
+      pin_twi_acknowledged = !sda_is_high;
+    }
+    return;
+  }
+
+  //Once SCL falls, move on to the next bit.
+  if(scl_was_high && !scl_is_high) {
+
+    switch(pin_twi_state) {
+
+      //Once all eight bits of a byte have arrived, hand it over, and acknowledge it.
+      case PinTWIReceiving:
+        if(pin_twi_bits == 8) {
+          finish_pin_twi_byte();
+        }
+        break;
+
+      //Once the acknowledge bit is done, let go of SDA; and then either send the byte the master
+      //has asked for, or wait for the next byte to arrive. If the byte wasn't acknowledged, the
+      //master can only send a start or stop condition next.
+      case PinTWIAcknowledging:
+        drive_pin_twi_sda(1);
+
+        if(!pin_twi_acknowledged) {
+          pin_twi_state = PinTWIIgnoring;
+        } else if(pin_twi_reading) {
+          send_next_pin_twi_byte();
+        } else {
+          pin_twi_state = PinTWIReceiving;
+          pin_twi_byte  = 0;
+          pin_twi_bits  = 0;
+        }
+        break;
+
+      //Send the next bit, most significant first; after the last, let go of SDA, so the master can acknowledge.
+      case PinTWITransmitting:
+        if(++pin_twi_bits == 8) {
+          drive_pin_twi_sda(1);
+          pin_twi_state = PinTWIAwaitingAcknowledge;
+        } else {
+          drive_pin_twi_sda((pin_twi_byte << pin_twi_bits) & 0x80);
+        }
+        break;
+
+      //If the master acknowledged the byte, it wants another; otherwise, it's done reading.
+      case PinTWIAwaitingAcknowledge:
+        if(pin_twi_acknowledged) {
+          send_next_pin_twi_byte();
+        } else {
+          pin_twi_state = PinTWIIgnoring;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+
+
+/*
+ * Handles a start (or repeated start) condition on the bit-banged bus; which is always
+ * followed by a device address.
+ */
+static void start_pin_twi_packet() {
+
+  if(pin_twi_state == PinTWIIdle) {
+    claim_twi_bus();
+  }
+
+  pin_twi_state        = PinTWIReceiving;
+  pin_twi_device       = 0;
+  pin_twi_address_next = 1;
+  pin_twi_byte         = 0;
+  pin_twi_bits         = 0;
+}
+
+
+/*
+ * Handles a stop condition on the bit-banged bus, which ends communication with the selected device.
+ */
+static void stop_pin_twi_packet() {
+
+  if(pin_twi_device && pin_twi_device->stop) {
+    pin_twi_device->stop(pin_twi_device);
+  }
+
+  if(pin_twi_state != PinTWIIdle) {
+    release_twi_bus();
+  }
+
+  pin_twi_state  = PinTWIIdle;
+  pin_twi_device = 0;
+}
+
+
+/*
+ * Hands a byte received on the bit-banged bus to its device-- or, if it's an address, finds
+ * the device it selects-- and starts acknowledging it, if the device accepts it.
+ */
+static void finish_pin_twi_byte() {
+
+  VirtualTWIDevice * device;
+
+  //The first byte after a start condition is an address, and its low bit is the direction.
+  if(pin_twi_address_next) {
+    device               = find_twi_device(pin_twi_byte >> 1);
+    pin_twi_reading      = pin_twi_byte & 0x01;
+    pin_twi_acknowledged = device && (!device->select || device->select(device, pin_twi_reading));
+    pin_twi_device       = pin_twi_acknowledged ? device : 0;
+    pin_twi_address_next = 0;
+  } else {
+    device               = pin_twi_device;
+    pin_twi_acknowledged = device && (!device->write || device->write(device, pin_twi_byte));
+  }
+
+  twi_statistics.bytes++;
+
+  //A device acknowledges a byte by holding SDA low during the ninth clock.
+  pin_twi_state = PinTWIAcknowledging;
+
+  if(pin_twi_acknowledged) {
+    drive_pin_twi_sda(0);
+  }
+
+  hold_pin_twi_clock_if_stretched();
+}
+
+
+/*
+ * Fetches the next byte the master is reading from the selected device, and starts sending
+ * it; or sends 0xFF (an idle bus), if no device is talking.
+ */
+static void send_next_pin_twi_byte() {
+
+  VirtualTWIDevice * device = pin_twi_device;
+
+  pin_twi_byte  = (device && device->read) ? device->read(device) : 0xFF;
+  pin_twi_bits  = 0;
+  pin_twi_state = PinTWITransmitting;
+  twi_statistics.bytes++;
+
+  drive_pin_twi_sda(pin_twi_byte & 0x80);
+  hold_pin_twi_clock_if_stretched();
+}
+
+
+/*
+ * Sets the devices' side of SDA: pulled low for a zero; or released, for a one. Like the
+ * real devices' outputs, SDA is open-drain; so it's never driven high.
+ */
+static void drive_pin_twi_sda(uint8_t level) {
+  if(level) {
+    release_virtual_pin(twi_pins_port, twi_sda_bit);
+  } else {
+    drive_virtual_pin(twi_pins_port, twi_sda_bit, 0);
+  }
+}
+
+
+/*
+ * If a device has asked to stretch the clock (see stretch_virtual_twi_clock), holds SCL low
+ * for that long. Called while SCL is low, just after the device's callback.
+ */
+static void hold_pin_twi_clock_if_stretched() {
+
+  if(!twi_clock_stretch) {
+    return;
+  }
+
+  pin_twi_clock_held_until = elapsed_cycles + twi_clock_stretch;
+  twi_clock_stretch        = 0;
+  drive_virtual_pin(twi_pins_port, twi_scl_bit, 0);
+}
+
+
+/*
+ * -------------------------------------
+ * USART Model
+ * -------------------------------------
+ */
+
+/*
+ * Reacts to a write to UCSR0A.
+ */
+static void handle_uart_status_write() {
+
+  uint8_t written = register_file[ADDRESS_UCSR0A];
+
+  //Writing a one to TXC0 clears it.
+  if(written & _BV(TXC0)) {
+    uart_transmit_complete = 0;
+  }
+
+  update_uart_status_register(written);
+}
+
+
+/*
+ * Transmits a single byte, if the transmitter is enabled.
+ */
+static void transmit_via_uart(uint8_t data) {
+
+  if(!(register_file[ADDRESS_UCSR0B] & _BV(TXEN0))) {
+    return;
+  }
+
+  if(uart_output) {
+    uart_output(data);
+  }
+
+  uart_transmit_complete = 1;
+  update_uart_status_register(register_file[ADDRESS_UCSR0A]);
+}
+
+
+/*
+ * Moves the next waiting byte (if any) into UDR0, if the receiver is enabled.
+ */
+static void receive_next_uart_byte() {
+
+  if((register_file[ADDRESS_UCSR0B] & _BV(RXEN0)) && (uart_receive_queue_position < uart_receive_queue_length)) {
+    uart_received_byte    = uart_receive_queue[uart_receive_queue_position++];
+    uart_receive_complete = 1;
+    set_register(ADDRESS_UDR0, uart_received_byte);
+  }
+
+  update_uart_status_register(register_file[ADDRESS_UCSR0A]);
+}
+
+
+/*
+ * Rebuilds UCSR0A from the USART's state, and the given values of its writable bits.
+ */
+static void update_uart_status_register(uint8_t writable_bits) {
+
+  uint8_t status = (writable_bits & (_BV(U2X0) | _BV(MPCM0))) | _BV(UDRE0);
+
+  if(uart_receive_complete) {
+    status |= _BV(RXC0);
+  }
+
+  if(uart_transmit_complete) {
+    status |= _BV(TXC0);
+  }
+
+  set_register(ADDRESS_UCSR0A, status);
+}
+
+
+/*
+ * The default USART output: writes each byte to the host's standard output.
+ */
+static void write_to_standard_output(uint8_t data) {
+  putchar(data);
+}
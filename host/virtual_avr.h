@@ -0,0 +1,254 @@
+/**
+ * EECE 387 Example Code
+ * Virtual AVR: a simulated ATmega328P, for running the libraries on the host.
+ *
+ * When the libraries are built for the host (make host), the headers in host/include
+ * stand in for avr-libc's; and every register access (TWCR, UDR0, ...) is redirected into
+ * a simulated register file, which is watched by models of the AVR's peripherals:
+ *
+ *   - The TWI hardware, which acts as a bus master, talking to any number of simulated
+ *     TWI devices (see VirtualTWIDevice); addresses which no device answers are NACK'd.
+ *   - The USART, whose transmitted bytes are handed to an output function (by default,
+ *     the host's standard output), and which can be fed received bytes.
+ *   - The I/O pins, which are pulled up, and which both the AVR code and simulated devices
+ *     can pull low (see drive_virtual_pin); and the pin change interrupts, which fire when
+ *     they change. The TWI devices can also be connected to a pair of pins, for software
+ *     ("bit-banged") TWI masters; see connect_virtual_twi_pins.
+ *   - Timer/counter 0, in its normal and CTC modes, with its compare match and overflow flags.
+ *   - The global interrupt flag, and the pin change, timer 0, TWI and USART interrupts, which
+ *     are delivered to the AVR code's ISRs just as they would be on the real device.
+ *   - Sleep (see <avr/sleep.h>), which lets time pass until an interrupt wakes the CPU.
+ *
+ * This lets the TWI and UART code-- and the samples built on them-- run natively, in
+ * milliseconds, on any machine with a C compiler:
+ *
+ * @code
+ *   int avr_main(void);   // the sample's main(), compiled with -Dmain=avr_main
+ *
+ *   int main() {
+ *     attach_virtual_twi_device(&my_sensor_model);
+ *     set_virtual_avr_time_limit(virtual_avr_seconds(2));
+ *     return avr_main();
+ *   }
+ * @endcode
+ *
+ * Time is simulated, too. The virtual AVR keeps a count of CPU cycles, which is advanced
+ * by delays (_delay_ms, _delay_us), and by a small amount on each register access; once
+ * the time limit (if any) is reached, the program exits.
+ *
+ * TWI operations take as long as they would on the real bus: nine SCL periods for each
+ * address or data byte, and one for each start or stop condition, where the SCL period
+ * (16 + 2 * TWBR * 4^TWPS cycles) comes from the TWBR and TWSR settings. TWINT is set, and
+ * the TWI interrupt fires, only once the operation is over. Devices can stretch the
+ * clock to make an operation take longer; see stretch_virtual_twi_clock.
+ */
+
+#ifndef __VIRTUAL_AVR_H__
+#define __VIRTUAL_AVR_H__
+
+#include <inttypes.h>
+
+/**
+ * The number of CPU cycles charged for each register access; a rough stand-in for
+ * the time spent running the code between accesses. Matches the length of a typical
+ * polling loop (e.g. the TWI library's TWI_WAIT_LOOP_CYCLES), so timeouts measured in
+ * loop iterations last about as long as they would on the real device.
+ */
+#ifndef VIRTUAL_AVR_CYCLES_PER_ACCESS
+  #define VIRTUAL_AVR_CYCLES_PER_ACCESS 8
+#endif
+
+/**
+ * Describes a simulated device on the TWI bus. Each function is called as the master
+ * talks to the device; any of them may be left as 0, if the device doesn't care.
+ */
+struct VirtualTWIDevice_struct {
+
+  /** The device's seven-bit TWI address. */
+  uint8_t address;
+
+  /**
+   * Called when the master addresses the device, after a start (or repeated start) condition.
+   * @param direction TW_READ if the master is about to read from the device; or TW_WRITE.
+   * @return True to acknowledge the address; false to NACK it. If 0, the address is always acknowledged.
+   */
+  uint8_t (*select)(struct VirtualTWIDevice_struct * device, uint8_t direction);
+
+  /**
+   * Called for each byte the master writes to the device.
+   * @return True to acknowledge the byte; false to NACK it. If 0, every byte is acknowledged.
+   */
+  uint8_t (*write)(struct VirtualTWIDevice_struct * device, uint8_t data);
+
+  /**
+   * Called for each byte the master reads from the device.
+   * @return The byte to be sent to the master. If 0, the device sends 0xFF (an idle bus).
+   */
+  uint8_t (*read)(struct VirtualTWIDevice_struct * device);
+
+  /** Called when the master sends a stop condition, ending its communication with the device. */
+  void (*stop)(struct VirtualTWIDevice_struct * device);
+
+  /**
+   * Called to find when the device will next do something the AVR could notice without using
+   * the bus; e.g. changing the level of an interrupt output. Leave this 0 (NULL) for devices
+   * which only act when the master talks to them.
+   * @return The time of the device's next event, in CPU cycles; or UINT64_MAX, if none is scheduled.
+   */
+  uint64_t (*next_event)(struct VirtualTWIDevice_struct * device);
+
+  /** Called once the time of the device's next event (see next_event) has arrived. */
+  void (*update)(struct VirtualTWIDevice_struct * device);
+
+  /** Any extra state the device's model needs. */
+  void * context;
+
+  /** The next device on the bus. Used internally. */
+  struct VirtualTWIDevice_struct * next;
+
+};
+typedef struct VirtualTWIDevice_struct VirtualTWIDevice;
+
+
+/**
+ * The AVR's I/O ports.
+ */
+enum VirtualPort_enum {
+  VirtualPortB = 0,
+  VirtualPortC,
+  VirtualPortD
+};
+typedef enum VirtualPort_enum VirtualPort;
+
+
+/**
+ * Counts the TWI bus activity since the virtual AVR started.
+ */
+struct VirtualTWIStatistics_struct {
+
+  /** The number of transactions: each start condition sent while the bus was free. */
+  uint32_t transactions;
+
+  /** The number of bytes sent or received, including address bytes. */
+  uint32_t bytes;
+
+  /** The number of CPU cycles during which the bus was in use: from each start condition to its stop condition. */
+  uint64_t busy_cycles;
+
+};
+typedef struct VirtualTWIStatistics_struct VirtualTWIStatistics;
+
+
+/**
+ * Adds a simulated device to the TWI bus.
+ */
+void attach_virtual_twi_device(VirtualTWIDevice * device);
+
+/**
+ * Removes a simulated device from the TWI bus.
+ */
+void detach_virtual_twi_device(VirtualTWIDevice * device);
+
+/**
+ * @return The TWI bus activity since the virtual AVR started.
+ */
+VirtualTWIStatistics virtual_twi_statistics();
+
+/**
+ * Holds the TWI clock low, delaying the end of the current operation by the given number
+ * of CPU cycles. Intended to be called by a device's model, from one of its callbacks;
+ * e.g. by a slow device which needs time to fetch the byte being read. If the clock is
+ * held for too long, the master will time out, just as it would on the real bus.
+ */
+void stretch_virtual_twi_clock(uint64_t cycles);
+
+/**
+ * Drives one of the AVR's pins from outside, e.g. from a device's output; the new level
+ * shows up in the pin's PIN register bit, and sets off its pin change interrupt, if enabled.
+ * Pins which aren't being driven read as high, as though pulled up-- unless the AVR code
+ * has made them outputs, and is driving them low.
+ *
+ * @param port The pin's port; e.g. VirtualPortD.
+ * @param bit The pin's bit number within its port; e.g. 2 for PD2.
+ * @param level True to drive the pin high; false to drive it low.
+ */
+void drive_virtual_pin(VirtualPort port, uint8_t bit, uint8_t level);
+
+/**
+ * Stops driving one of the AVR's pins from outside; it goes back to reading high. Used
+ * e.g. to model an open-drain output, which only ever drives its pin low.
+ */
+void release_virtual_pin(VirtualPort port, uint8_t bit);
+
+/**
+ * Connects the simulated TWI devices to a pair of the AVR's pins, as an open-drain bus with
+ * pull-up resistors; so a software TWI master (e.g. twi/software_master.c) can reach them.
+ * The devices remain on the TWI hardware's bus, too. The devices follow the master's start
+ * and stop conditions and its clock, pull SDA low to acknowledge bytes and to send zeroes,
+ * and hold SCL low if they stretch the clock; the bus statistics count their traffic.
+ *
+ * @param port The pins' port; e.g. VirtualPortC.
+ * @param sda_bit, scl_bit The bit numbers of the SDA and SCL pins; e.g. 4 and 5, for PC4 and PC5.
+ */
+void connect_virtual_twi_pins(VirtualPort port, uint8_t sda_bit, uint8_t scl_bit);
+
+/**
+ * Sets the function which receives each byte the USART transmits. By default, each
+ * byte is written to the host's standard output. Pass 0 to discard all output.
+ */
+void set_virtual_uart_output(void (*output)(uint8_t data));
+
+/**
+ * Has the USART receive the given bytes, one at a time, as the AVR code reads them.
+ */
+void send_to_virtual_uart(const uint8_t * data, uint16_t length);
+
+/**
+ * @return The number of CPU cycles which have elapsed on the virtual AVR.
+ */
+uint64_t virtual_avr_cycles();
+
+/**
+ * Converts a time, in seconds, into CPU cycles.
+ */
+#define virtual_avr_seconds(seconds) ((uint64_t)((seconds) * (double)(F_CPU)))
+
+/**
+ * Sets a limit on how long the virtual AVR may run; once it's been running for the given
+ * number of CPU cycles, the program exits. Useful for running code which loops forever.
+ *
+ * @param cycles The number of cycles the virtual AVR may run for; or 0 for no limit.
+ */
+void set_virtual_avr_time_limit(uint64_t cycles);
+
+/**
+ * Advances the virtual AVR's clock by the given number of CPU cycles, delivering any
+ * interrupts which occur in the meantime. Used to implement _delay_ms and friends.
+ */
+void virtual_avr_delay_cycles(uint64_t cycles);
+
+/**
+ * Puts the CPU to sleep, if the sleep enable bit (SE, in SMCR) is set: lets time pass until
+ * an interrupt fires, and then returns once its handler has run. If nothing could ever wake
+ * the CPU, the program exits once the time limit is reached. Used to implement sleep_cpu.
+ */
+void virtual_avr_sleep(void);
+
+/**
+ * @return The number of CPU cycles the virtual AVR has spent asleep.
+ */
+uint64_t virtual_avr_sleeping_cycles();
+
+/**
+ * Provides access to the simulated register at the given data-space address.
+ * Used by the register definitions in host/include/avr/io.h.
+ */
+volatile uint8_t * virtual_avr_register(uint16_t address);
+
+/**
+ * @return The data-space address of the given simulated register, as returned by
+ *    virtual_avr_register. Used to implement _SFR_MEM_ADDR.
+ */
+uint16_t virtual_avr_register_address(volatile uint8_t * reg);
+
+#endif
@@ -21,29 +21,154 @@
  */
 
 #include "twi/master.h"
+#include "sensors/tcs34725.h"
+#include "timer/scheduler.h"
 #include "uart/stdio.h"
+#include "uart/format.h"
 
 #include <util/delay.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+//Run the TWI bus in fast mode (400kHz). The TWI clock settings are computed 
+//by the preprocessor, so no code is needed to compute them at runtime.
+#define TWI_BITRATE 400000
+#include "twi/setbitrate.h"
+
+//Bus pirate commands, pre-compiled at build time from sample_twi_tcs34725.bp.
+#include "sample_twi_tcs34725_bp.h"
+
+//The number of characters which must fit into the UART's transmit buffer before we send
+//each piece of a report: enough for the longest piece, with its newline sent as "\r\n".
+#define REPORT_PIECE_LENGTH 48
+
+//The number of pieces each report is sent in.
+#define REPORT_PIECES 4
+
+static void check_sensor(Task * task);
+static void send_report(Task * task);
+static void reading_fetched(TWITransaction * transaction);
+
+//The sensor; set up by main().
+static TCS34725 sensor;
+
+//The reading being fetched in the background, and whether a fetch has been started (and its
+//reading not yet picked up by send_report).
+static TCS34725Fetch fetch;
+static uint8_t fetch_started = false;
+
+//The reading being reported, with the settings it was taken with; and the next piece of the
+//report to be sent, or 0 if there's no report under way.
+static TCS34725Reading report;
+static uint8_t report_cycles, report_gain, report_piece = 0;
+
+//Our tasks: checking the sensor's INT pin, once per millisecond; and sending each report,
+//which runs whenever a reading has been fetched, and then as the UART makes room.
+static Task check_task  = TASK(check_sensor, 1, 0);
+static Task report_task = TASK(send_report, 0, 0);
+
 
 /**
- * Simple data structure which defines a two-byte piece of data.
- *
- * This "union" allows us to access the two-byte data into two ways:
- * as a pair of low and high bytes (var.low and var.high), or as a
- * single 16-bit unsigned integer (var.full). 
- *
- * This is convenient for intepreting our light sensor data!
- */ 
-union light_sensor_reading_union {
+ * Task: checks the sensor's INT pin, which costs nothing on the bus; and once a reading is
+ * ready, starts fetching it in the background.
+ */
+static void check_sensor(Task * task) {
+
+  (void)task;
+
+  //We only have room for one fetched reading at a time; so until send_report picks up the
+  //last one, leave the next one in the sensor.
+  if(!fetch_started && tcs34725_reading_ready(&sensor)) {
+    fetch_started = start_tcs34725_fetch(&fetch, reading_fetched);
+  }
+}
 
-  uint16_t full;
 
-  struct {
-    uint8_t low;
-    uint8_t high;
-  };
-};
-typedef union light_sensor_reading_union light_sensor_reading;
+/**
+ * Called from the TWI interrupt once a fetch has finished: has send_report pick up the reading.
+ */
+static void reading_fetched(TWITransaction * transaction) {
+  (void)transaction;
+  schedule_task(&report_task, 0);
+}
+
+
+/**
+ * Task: sends each reading over the UART, a piece at a time, as the transmit buffer makes room;
+ * so it never waits for the UART, and the next reading is fetched while this one drains out.
+ */
+static void send_report(Task * task) {
+
+  //Between reports, pick up the next reading, once it's been fetched.
+  if(!report_piece) {
+    if(!fetch_started || !tcs34725_fetch_finished(&fetch)) {
+      return;
+    }
+
+    //We're taking this reading; so the next one can be fetched into its place right away.
+    fetch_started = false;
+
+    if(tcs34725_fetch_result(&fetch) != TWISuccess) {
+      return;
+    }
+
+    //Readings taken with different settings can't be compared directly; so we'll send the
+    //settings, too. Note them before adjusting the sensor's gain and integration time to
+    //suit the light, so our next reading is neither saturated nor too dim to be precise.
+    report        = fetch.reading;
+    report_cycles = sensor.integration_cycles;
+    report_gain   = sensor.gain;
+    report_piece  = 1;
+
+    autorange_tcs34725(&sensor, &report);
+  }
+
+  while(report_piece) {
+
+    //If the UART isn't ready for the next piece, come back once it's had time to send some more.
+    if(uart_transmit_space() < REPORT_PIECE_LENGTH) {
+      schedule_task(task, 1);
+      return;
+    }
+
+    //Send the readings. This is the busiest part of our program, so rather than using printf,
+    //we use the much faster string and number functions from uart/stdio.h and uart/format.h.
+    switch(report_piece) {
+
+      case 1:
+        send_string_via_uart_P(PSTR("Sensor readings (Clear, Red, Green, Blue): "));
+        break;
+
+      case 2:
+        send_unsigned_via_uart(report.clear, 5);
+        send_string_via_uart_P(PSTR(", "));
+        send_unsigned_via_uart(report.red, 5);
+        send_string_via_uart_P(PSTR(", "));
+        break;
+
+      case 3:
+        send_unsigned_via_uart(report.green, 5);
+        send_string_via_uart_P(PSTR(", "));
+        send_unsigned_via_uart(report.blue, 5);
+        break;
+
+      case 4:
+        send_string_via_uart_P(PSTR(" ("));
+        send_unsigned_via_uart(report_cycles, 0);
+        send_string_via_uart_P(PSTR(" cycles, gain setting "));
+        send_unsigned_via_uart(report_gain, 0);
+        send_string_via_uart_P(PSTR(")\n"));
+        break;
+    }
+
+    report_piece = (report_piece < REPORT_PIECES) ? (report_piece + 1) : 0;
+  }
+
+  //If the next reading arrived while we were sending this one, report it straight away.
+  if(fetch_started && tcs34725_fetch_finished(&fetch)) {
+    schedule_task(task, 0);
+  }
+}
 
 
 /**
@@ -51,31 +176,37 @@ typedef union light_sensor_reading_union light_sensor_reading;
  */ 
 int main() {
 
-  uint8_t start_code, device_id;
-  light_sensor_reading clear, red, green, blue;
+  uint8_t device_id;
+
+  //The sensor, and its initial settings: 42 cycles of 2.4ms (100.8ms) per reading, at 1x gain.
+  //The settings are adjusted to suit the light as we go. The sensor's INT output is connected
+  //to PD2, so we can tell when each reading is ready without using the bus.
+  sensor = (TCS34725)TCS34725_SENSOR_WITH_INTERRUPT(42, TCS34725Gain1x, PIND, PD2);
 
   //Set up stdio over the device's UART.
   set_up_stdio_over_serial();
 
-  //Set up the microcontrollers's I2C hardware, running at 100kHz.
-  set_up_twi_hardware(100000);
-  _delay_ms(1);
+  //Enable interrupts. This allows our printf output to be transmitted in the background,
+  //so we don't have to wait for each line to go out before taking our next reading.
+  sei();
 
-  //Enable the sensor's internal ADC.
-  //Note that we're using almost exactly the same command as used when communicating
-  //via Bus Pirate-- there's only one small difference: the last "r" has been replaced with an "s",
-  //indicating that we expect no further data.
-  perform_bus_pirate_twi_command("[ 0x52 0x80 0x03 [ 0x53 s ]", &start_code);
+  //Set up the microcontrollers's I2C hardware, running in fast mode (400kHz).
+  configure_twi_clock(TWPS_VALUE, TWBR_VALUE);
+  _delay_ms(1);
 
-  //If the two LSBs of the start code were 0b11, we've started the device successfully!
-  if(start_code == 0x03) {
+  //Set up the sensor, and start it taking readings. The driver (sensors/tcs34725.h)
+  //handles all of the sensor's registers for us.
+  if(start_tcs34725(&sensor) == TWISuccess) {
     printf("Sensor enabled succesfully!\n");
   }
 
-  //Read the device's ID. For this example, we'll use the special "w" syntax, a special form of "write"
-  //which accepts the value to be transmitted as an argument. This allows convenient programmatic control
-  //of values to be transmitted!
-  perform_bus_pirate_twi_command("[ 0x52 w [ 0x53 s ]", 0x92, &device_id);
+  //Read the device's ID. For this example, we'll use a bus pirate command with the special "w" syntax, 
+  //a special form of "write" which accepts the value to be transmitted as an argument. This allows 
+  //convenient programmatic control of values to be transmitted!
+  //
+  //Rather than passing the command as a string, we're executing a version that was compiled 
+  //at build time (see sample_twi_tcs34725.bp); this saves us from parsing the command on the AVR.
+  execute_bus_pirate_program_P(read_register, 0x92, &device_id);
   printf("Read device ID: 0x%x\n", device_id);
 
   //Alternatively, one can implement the I2C communications manually, rather
@@ -90,18 +221,14 @@ int main() {
   end_twi_packet();
   printf("Re-read device ID: 0x%x\n", device_id);
 
-  //And take repeated light sensor readings.
-  while(1) {
-    perform_bus_pirate_twi_command(
-        "[ 0x52 0xB4 [ 0x53 rr rr rr rs  ]", 
-        &clear.low, &clear.high,
-        &red.low,   &red.high,
-        &green.low, &green.high,
-        &blue.low,  &blue.high);
-
-    printf("Sensor readings (Clear, Red, Green, Blue): %5u, %5u, %5u, %5u\n", clear.full, red.full, green.full, blue.full);
-    _delay_ms(100);
-  }
+  //And take repeated light sensor readings. Rather than reading the sensor on a fixed schedule,
+  //or waiting for each reading and then for the UART, we hand the work to a pair of tasks (see
+  //timer/scheduler.h). Each reading is fetched as soon as the sensor's INT output says it's
+  //ready, and sent while the next one is taken; so we never read the same data twice, and
+  //never wait on the bus or the UART. The CPU sleeps whenever neither task has work to do.
+  start_scheduler();
+  schedule_task(&check_task, 0);
+  run_scheduler();
   
   return 0;
 
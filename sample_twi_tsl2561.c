@@ -21,30 +21,18 @@
  */
 
 #include "twi/master.h"
+#include "sensors/tsl2561.h"
 #include "uart/stdio.h"
+#include "uart/format.h"
 
 #include <util/delay.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 
-/**
- * Simple data structure which defines a two-byte piece of data.
- *
- * This "union" allows us to access the two-byte data into two ways:
- * as a pair of low and high bytes (var.low and var.high), or as a
- * single 16-bit unsigned integer (var.full). 
- *
- * This is convenient for intepreting our light sensor data!
- */ 
-union light_sensor_reading_union {
-
-  uint16_t full;
-
-  struct {
-    uint8_t low;
-    uint8_t high;
-  };
-};
-typedef union light_sensor_reading_union light_sensor_reading;
-
+//Run the TWI bus in fast mode (400kHz). The TWI clock settings are computed 
+//by the preprocessor, so no code is needed to compute them at runtime.
+#define TWI_BITRATE 400000
+#include "twi/setbitrate.h"
 
 /**
  * Small section of sample code, for the Atmega328p.
@@ -52,13 +40,23 @@ typedef union light_sensor_reading_union light_sensor_reading;
 int main() {
 
   uint8_t start_code, device_id;
-  light_sensor_reading reading;
+  uint32_t lux;
+  TSL2561Reading reading;
+
+  //The sensor, and its initial settings: ADDR SEL floating (address 0x39), 101ms integrations, at 1x gain.
+  //The settings are adjusted to suit the light as we go. The sensor's INT output is connected
+  //to PD3, so we can sleep until each reading is ready.
+  TSL2561 sensor = TSL2561_SENSOR_WITH_INTERRUPT(TSL2561_ADDRESS_FLOAT, TSL2561Integration101ms, TSL2561Gain1x, PIND, PD3);
 
   //Set up stdio over the device's UART.
   set_up_stdio_over_serial();
 
-  //Set up the microcontrollers's I2C hardware, running at 100kHz.
-  set_up_twi_hardware(100000);
+  //Enable interrupts. This allows our output to be transmitted in the background,
+  //so we don't have to wait for each line to go out before taking our next reading.
+  sei();
+
+  //Set up the microcontrollers's I2C hardware, running in fast mode (400kHz).
+  configure_twi_clock(TWPS_VALUE, TWBR_VALUE);
   _delay_ms(1);
 
   //Enable the sensor's internal ADC.
@@ -90,11 +88,41 @@ int main() {
   end_twi_packet();
   printf("Re-read device ID: 0x%x\n", device_id);
 
-  //And take repeated light sensor readings.
+  //Finally, the driver in sensors/tsl2561.h wraps all of this up for us. Starting the sensor
+  //applies our integration time and gain, too; and sets up the sensor's interrupt.
+  start_tsl2561(&sensor);
+
+  //And take repeated light sensor readings. Each reading fetches both channels at once, and
+  //we sleep until the sensor's INT output says an integration has finished; so we never read
+  //the same data twice.
   while(1) {
-    perform_bus_pirate_twi_command("[ 0x72 0xAC [ 0x73 r s ]", &reading.low, &reading.high);
-    printf("Sensor reading: %u\n", reading.full);
-    _delay_ms(100);
+    if(wait_for_tsl2561_reading(&sensor, &reading) != TWISuccess) {
+      continue;
+    }
+
+    //Convert the reading to lux. The driver uses integer math only, which is much faster
+    //than floating point on the AVR.
+    lux = tsl2561_lux(&sensor, &reading);
+
+    //Send the readings. Rather than using printf, we use the much faster string and number 
+    //functions from uart/stdio.h and uart/format.h.
+    send_string_via_uart_P(PSTR("Sensor readings (Broadband, Infrared): "));
+    send_unsigned_via_uart(reading.broadband, 5);
+    send_string_via_uart_P(PSTR(", "));
+    send_unsigned_via_uart(reading.infrared, 5);
+
+    if(lux == TSL2561_LUX_SATURATED) {
+      send_string_via_uart_P(PSTR(" (saturated)\n"));
+    } else {
+      send_string_via_uart_P(PSTR("; "));
+      send_unsigned_via_uart(lux, 0);
+      send_string_via_uart_P(PSTR(" lux\n"));
+    }
+
+    //Finally, adjust the sensor's gain and integration time to suit the light, so our next
+    //reading is neither saturated nor too dim to be precise. (We do this after converting the
+    //reading to lux, since the conversion depends on the settings the reading was taken with.)
+    autorange_tsl2561(&sensor, &reading);
   }
   
   return 0;
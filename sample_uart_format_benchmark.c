@@ -0,0 +1,114 @@
+/**
+ * EECE 387 Example Code
+ * Benchmark: lightweight number formatting (uart/format.h), versus printf.
+ *
+ * Sends the same values with printf and with the functions in uart/format.h, and
+ * reports how many CPU cycles each took, as counted by timer/counter 1 running at
+ * the CPU clock. This needs real hardware: build sample_uart_format_benchmark.hex,
+ * program it as usual, and watch the serial output. (The virtual AVR used by make host
+ * doesn't model instruction timing, so it can't take this measurement.)
+ *
+ * Each measurement includes placing the characters into the UART's transmit buffer,
+ * which costs the same for both methods, and any UART interrupts which fire meanwhile.
+ * The cost of starting and stopping the measurement itself is subtracted.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+
+#include "uart/stdio.h"
+#include "uart/format.h"
+
+//The values to be sent. These are volatile, so the compiler can't do any of the work
+//at compile time.
+static volatile uint16_t reading = 12345;
+static volatile uint16_t device_id = 0xBEEF;
+static volatile int32_t lux = 41235;
+
+//The cost of an empty measurement, which is subtracted from every other measurement.
+static uint16_t measurement_overhead = 0;
+
+
+/*
+ * Each benchmark sends a single value, using one of the two methods.
+ */
+typedef void (*Benchmark)(void);
+
+static void nothing() {}
+
+static void printf_unsigned() { printf("%5u", reading); }
+static void format_unsigned() { send_unsigned_via_uart(reading, 5); }
+
+static void printf_hex()      { printf("%04x", device_id); }
+static void format_hex()      { send_hex_via_uart(device_id, 4); }
+
+static void printf_fixed()    { printf("%5ld.%02u", (long)(lux / 100), (unsigned)(lux % 100)); }
+static void format_fixed()    { send_fixed_point_via_uart(lux, 2, 8); }
+
+
+/*
+ * Measures how many CPU cycles a single benchmark takes.
+ *
+ * @return The number of cycles; or UINT16_MAX, if the benchmark took too long to measure.
+ */
+static uint16_t cycles_taken_by(Benchmark benchmark) {
+
+  uint16_t cycles;
+
+  //Make sure there's room in the transmit buffer, so we never wait for the UART.
+  flush_uart();
+
+  //Start counting from zero, and clear the overflow flag, so we can tell if we've run out of count.
+  TCNT1 = 0;
+  TIFR1 = (1 << TOV1);
+
+  benchmark();
+
+  cycles = TCNT1;
+
+  if(TIFR1 & (1 << TOV1)) {
+    return UINT16_MAX;
+  }
+
+  return cycles - measurement_overhead;
+}
+
+
+/*
+ * Runs a benchmark with each method, and reports the results.
+ */
+static void compare(const char * description, Benchmark with_printf, Benchmark with_format) {
+
+  uint16_t printf_cycles, format_cycles;
+
+  printf("%s\n  printf:   \"", description);
+  printf_cycles = cycles_taken_by(with_printf);
+  printf("\"\n  format.h: \"");
+  format_cycles = cycles_taken_by(with_format);
+  printf("\"\n  cycles: %u with printf, %u with format.h\n", printf_cycles, format_cycles);
+}
+
+
+int main() {
+
+  set_up_stdio_over_serial();
+  sei();
+
+  //Run timer/counter 1 in normal mode, directly from the CPU clock (no prescaler);
+  //so each count is a single CPU cycle.
+  TCCR1A = 0;
+  TCCR1B = (1 << CS10);
+
+  //Measure the cost of measuring nothing at all.
+  measurement_overhead = cycles_taken_by(nothing);
+
+  while(1) {
+    compare("Unsigned, width 5 (%5u):", printf_unsigned, format_unsigned);
+    compare("Hexadecimal, 4 digits (%04x):", printf_hex, format_hex);
+    compare("Fixed point, 2 decimals:", printf_fixed, format_fixed);
+    printf("\n");
+
+    _delay_ms(1000);
+  }
+}
@@ -0,0 +1,84 @@
+/*
+ * EECE 387 Example Code
+ * Automatic ranging for light sensors.
+ *
+ * See autorange.h for usage.
+ */
+
+#include "autorange.h"
+
+#include <avr/pgmspace.h>
+
+//The fraction of a range's maximum count we aim for when choosing a new range, and the
+//fraction which makes us leave the current range, in 256ths: 50% and 90%.
+#define TARGET_FRACTION 128
+#define LEAVE_FRACTION  230
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+/*
+ * @return The given fraction (in 256ths) of the given count.
+ */
+static uint16_t fraction_of(uint16_t count, uint8_t fraction)
+{
+  return ((uint32_t)count * fraction) >> 8;
+}
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Chooses the range for a light sensor's next reading.
+ */
+uint8_t choose_sensor_range(const SensorRange * ranges, uint8_t range_count, SensorRange current, uint16_t largest_count)
+{
+  uint16_t sensitivity, maximum_count;
+  uint32_t predicted_count;
+  uint8_t i = range_count;
+
+  //If the reading saturated, we don't know how much light there is; so move to the least
+  //sensitive range, which will tell us.
+  if(largest_count >= current.maximum_count) {
+    return 0;
+  }
+
+  //Otherwise, find the most sensitive range which would produce a reading no more than
+  //our target fraction of its maximum...
+  while(i-- > 0) {
+    sensitivity   = pgm_read_word(&ranges[i].sensitivity);
+    maximum_count = pgm_read_word(&ranges[i].maximum_count);
+
+    predicted_count = (uint32_t)largest_count * sensitivity / current.sensitivity;
+
+    if(predicted_count <= fraction_of(maximum_count, TARGET_FRACTION)) {
+      break;
+    }
+  }
+
+  //... or, if even the least sensitive range would read more than that, the least sensitive range.
+  if(i >= range_count) {
+    i = 0;
+  }
+
+  //Move to a more sensitive range whenever we find one; but only leave for a less sensitive
+  //range once our readings get close to saturating.
+  sensitivity = pgm_read_word(&ranges[i].sensitivity);
+
+  if(sensitivity > current.sensitivity) {
+    return i;
+  }
+  if((sensitivity < current.sensitivity) && (largest_count >= fraction_of(current.maximum_count, LEAVE_FRACTION))) {
+    return i;
+  }
+
+  return KEEP_SENSOR_RANGE;
+}
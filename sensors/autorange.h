@@ -0,0 +1,64 @@
+/**
+ * EECE 387 Example Code
+ * Automatic ranging for light sensors.
+ *
+ * Picks a light sensor's gain and integration time from its last reading. Each driver
+ * describes the settings it can use as a table of ranges, ordered from least to most
+ * sensitive. After each reading:
+ *
+ *   - If the reading saturated, we can't tell how bright it is; so we jump straight to the
+ *     least sensitive range. Its integration is also the shortest, so the next reading
+ *     arrives quickly, and tells us which range we really need.
+ *   - Otherwise, we know how bright it is; so we predict the reading every range would
+ *     produce, and jump straight to the most sensitive range whose reading would be at most
+ *     half of its maximum count. We move to a more sensitive range as soon as one qualifies;
+ *     but stay in the current range until its readings reach 90% of its maximum count.
+ *     The gap between the two limits keeps light near a boundary from switching ranges
+ *     back and forth.
+ *
+ * In both cases, the right range is reached within one or two readings, rather than by
+ * stepping through the ranges one integration at a time.
+ *
+ * This is used by the drivers; see e.g. autorange_tsl2561 in tsl2561.h.
+ */
+
+#ifndef __SENSORS_AUTORANGE_H__
+#define __SENSORS_AUTORANGE_H__
+
+#include <inttypes.h>
+
+/**
+ * The value choose_sensor_range returns when the sensor should stay in its current range.
+ */
+#define KEEP_SENSOR_RANGE 0xFF
+
+/**
+ * A light sensor's range: a combination of gain and integration time.
+ */
+struct SensorRange_struct {
+
+  /**
+   * The range's sensitivity, in any unit, as long as it's the same for every range;
+   * e.g. for a TCS34725, the gain times the number of integration cycles.
+   */
+  uint16_t sensitivity;
+
+  /** The largest count the range can produce; counts this large are saturated. */
+  uint16_t maximum_count;
+
+};
+typedef struct SensorRange_struct SensorRange;
+
+
+/**
+ * Chooses the range for a light sensor's next reading.
+ *
+ * @param ranges The ranges available, ordered from least to most sensitive, in program memory (PROGMEM).
+ * @param range_count The number of ranges available.
+ * @param current The range of the last reading. This doesn't have to be one of the ranges available.
+ * @param largest_count The largest of the last reading's channels.
+ * @return The index of the range to use next; or KEEP_SENSOR_RANGE, if the current range should be kept.
+ */
+uint8_t choose_sensor_range(const SensorRange * ranges, uint8_t range_count, SensorRange current, uint16_t largest_count);
+
+#endif
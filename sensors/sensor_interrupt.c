@@ -0,0 +1,75 @@
+/*
+ * EECE 387 Example Code
+ * Sensor interrupt pins.
+ *
+ * See sensor_interrupt.h for usage.
+ */
+
+#include "sensor_interrupt.h"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+/*
+ * The pin change interrupts only need to wake the CPU; the code which went to sleep
+ * checks the pin itself. So their handlers don't need to do anything.
+ */
+EMPTY_INTERRUPT(PCINT0_vect);
+EMPTY_INTERRUPT(PCINT1_vect);
+EMPTY_INTERRUPT(PCINT2_vect);
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Sets up the given pin to receive a sensor's INT output.
+ */
+void watch_sensor_interrupt_pin(volatile uint8_t * pin_register, uint8_t mask) {
+
+  //Each port's DDR and PORT registers directly follow its PIN register. Make the pin an input,
+  //with its pull-up enabled; the sensor's open-drain output only ever pulls it low.
+  pin_register[1] &= ~mask;
+  pin_register[2] |= mask;
+
+  //Enable the pin's pin change interrupt. Each port has its own mask register and enable bit.
+  if(pin_register == &PINB) {
+    PCMSK0 |= mask;
+    PCICR  |= _BV(PCIE0);
+  } else if(pin_register == &PINC) {
+    PCMSK1 |= mask;
+    PCICR  |= _BV(PCIE1);
+  } else if(pin_register == &PIND) {
+    PCMSK2 |= mask;
+    PCICR  |= _BV(PCIE2);
+  }
+}
+
+
+/*
+ * Sleeps until the given sensor INT pin is low.
+ */
+void sleep_until_sensor_interrupt(volatile uint8_t * pin_register, uint8_t mask) {
+
+  //Idle mode keeps the TWI and UART hardware running, so e.g. background UART output continues.
+  set_sleep_mode(SLEEP_MODE_IDLE);
+
+  //Check the pin with interrupts disabled, so it can't change between our check and going to
+  //sleep. The instruction after sei() always runs before any interrupt; so any change after our
+  //check wakes us from sleep, rather than firing just before it.
+  cli();
+
+  while(*pin_register & mask) {
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+    cli();
+  }
+
+  sei();
+}
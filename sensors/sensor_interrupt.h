@@ -0,0 +1,46 @@
+/**
+ * EECE 387 Example Code
+ * Sensor interrupt pins.
+ *
+ * Lets a program sleep until a sensor's interrupt (INT) output tells it something has
+ * happened-- e.g. that a new reading is ready, or that the light has crossed a threshold--
+ * rather than spinning in a delay loop, or polling the sensor over the bus.
+ *
+ * Sensor INT outputs are active-low and open-drain; so the pin is set up as an input, with
+ * its pull-up enabled. The pin's pin change interrupt wakes the CPU whenever the pin changes;
+ * the CPU then checks the pin, and goes back to sleep until it's low. Since the sensor holds
+ * its output low until its interrupt is cleared, a reading can never be missed, even if it
+ * arrives while the CPU is busy.
+ *
+ * The sensor drivers use this automatically when they're told which pin their INT output
+ * is connected to; see e.g. TCS34725_SENSOR_WITH_INTERRUPT. Any pin on ports B, C or D can be used.
+ *
+ * This module provides the (empty) handlers for the pin change interrupts, PCINT0_vect,
+ * PCINT1_vect and PCINT2_vect; so programs which use it can't define their own.
+ */
+
+#ifndef __SENSORS_SENSOR_INTERRUPT_H__
+#define __SENSORS_SENSOR_INTERRUPT_H__
+
+#include <inttypes.h>
+
+/**
+ * Sets up the given pin to receive a sensor's INT output: as an input, with its pull-up
+ * enabled, and with its pin change interrupt enabled.
+ *
+ * @param pin_register The PIN register for the pin's port; e.g. PIND.
+ * @param mask A bitmask which selects the pin; e.g. _BV(PD2).
+ */
+void watch_sensor_interrupt_pin(volatile uint8_t * pin_register, uint8_t mask);
+
+/**
+ * Sleeps (in idle mode) until the given sensor INT pin is low. Returns immediately if
+ * it's already low. Interrupts must be enabled. Other interrupts (e.g. from the UART)
+ * are still handled while we sleep.
+ *
+ * @param pin_register The PIN register for the pin's port; e.g. PIND.
+ * @param mask A bitmask which selects the pin; e.g. _BV(PD2).
+ */
+void sleep_until_sensor_interrupt(volatile uint8_t * pin_register, uint8_t mask);
+
+#endif
@@ -0,0 +1,463 @@
+/*
+ * EECE 387 Example Code
+ * TCS34725 color sensor driver.
+ *
+ * See tcs34725.h for usage.
+ */
+
+#include "tcs34725.h"
+#include "sensor_interrupt.h"
+
+#include <util/delay.h>
+#include <avr/pgmspace.h>
+
+//The bits of the command byte, which precedes every register access: the command bit itself,
+//which must always be set; and the access type, which selects auto-increment or a special function.
+#define COMMAND_BIT              0x80
+#define AUTO_INCREMENT           0x20
+#define CLEAR_INTERRUPT_FUNCTION 0x66
+
+//The sensor's registers.
+#define ENABLE_REGISTER           0x00
+#define INTEGRATION_TIME_REGISTER 0x01
+#define LOW_THRESHOLD_REGISTER    0x04
+#define PERSISTENCE_REGISTER      0x0C
+#define CONTROL_REGISTER          0x0F
+#define ID_REGISTER               0x12
+#define STATUS_REGISTER           0x13
+#define CLEAR_DATA_REGISTER       0x14
+
+//The bits of the enable and status registers.
+#define POWER_ON                  0x01
+#define ADC_ENABLE                0x02
+#define INTERRUPT_ENABLE          0x10
+#define INTERRUPT_PENDING         0x10
+
+//The time the sensor's oscillator needs to warm up after power-on, before the ADC is enabled.
+#define WARM_UP_MILLISECONDS      3
+
+//The granularity of our waits between checks for a new reading.
+#define CHECK_DELAY_STEP_MICROSECONDS 100
+
+//The largest count a reading can produce, and the count each integration cycle adds at most.
+#define MAXIMUM_COUNT             65535
+#define MAXIMUM_COUNT_PER_CYCLE   1024
+
+//The command bytes sent by an asynchronous fetch: one to read all of the color data, and
+//one to clear the interrupt. Transactions send their data from RAM, so these aren't in PROGMEM.
+static const uint8_t read_color_data_command = COMMAND_BIT | AUTO_INCREMENT | CLEAR_DATA_REGISTER;
+static const uint8_t clear_interrupt_command = COMMAND_BIT | CLEAR_INTERRUPT_FUNCTION;
+
+//The gain selected by each of the TCS34725Gain settings.
+static const uint8_t gains[] PROGMEM = { 1, 4, 16, 60 };
+
+/*
+ * The ranges used for automatic ranging, from least to most sensitive; and the integration
+ * time and gain for each. The sensitivity of each is its gain times its integration cycles.
+ * We lengthen the integration before raising the gain, up to about 100ms; beyond that, raising
+ * the gain is much quicker than integrating for longer.
+ */
+static const SensorRange ranges[] PROGMEM = {
+  { 1,    1024  },
+  { 4,    4096  },
+  { 16,   16384 },
+  { 42,   43008 },
+  { 168,  43008 },
+  { 672,  43008 },
+  { 2520, 43008 },
+  { 3840, 65535 }
+};
+static const struct {
+  uint8_t integration_cycles;
+  uint8_t gain;
+} range_settings[] PROGMEM = {
+  { 1,  TCS34725Gain1x  },
+  { 4,  TCS34725Gain1x  },
+  { 16, TCS34725Gain1x  },
+  { 42, TCS34725Gain1x  },
+  { 42, TCS34725Gain4x  },
+  { 42, TCS34725Gain16x },
+  { 42, TCS34725Gain60x },
+  { 64, TCS34725Gain60x }
+};
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Writes a single one of the sensor's registers.
+ */
+static TWIResult write_register(uint8_t register_address, uint8_t value)
+{
+  return write_twi_register_block(TCS34725_ADDRESS, COMMAND_BIT | register_address, &value, 1);
+}
+
+
+/*
+ * Clears the sensor's RGBC interrupt, so we can tell when the next reading is ready.
+ */
+static TWIResult clear_interrupt()
+{
+  TWIResult result = begin_twi_write_to(TCS34725_ADDRESS);
+
+  if(result == TWISuccess) {
+    result = transmit_via_twi(COMMAND_BIT | CLEAR_INTERRUPT_FUNCTION);
+  }
+
+  end_twi_packet();
+  return result;
+}
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Sets up the sensor's integration time and gain, and starts it taking readings.
+ */
+TWIResult start_tcs34725(TCS34725 * sensor)
+{
+  //Turn on the sensor's oscillator, and give it time to warm up.
+  TWIResult result = write_register(ENABLE_REGISTER, POWER_ON);
+  _delay_ms(WARM_UP_MILLISECONDS);
+
+  //Apply our settings. With a persistence setting of zero, the sensor raises its
+  //interrupt at the end of every integration, which is how we'll know a reading is ready.
+  if(result == TWISuccess) {
+    result = configure_tcs34725(sensor);
+  }
+  if(result == TWISuccess) {
+    result = write_register(PERSISTENCE_REGISTER, 0);
+  }
+
+  //Start the ADC; and make sure we don't mistake an old interrupt for a new reading.
+  if(result == TWISuccess) {
+    result = write_register(ENABLE_REGISTER, POWER_ON | ADC_ENABLE | INTERRUPT_ENABLE);
+  }
+  if(result == TWISuccess) {
+    result = clear_interrupt();
+  }
+
+  //If the INT output is connected, get ready to sleep until it tells us a reading is ready.
+  if(sensor->interrupt_pin) {
+    watch_sensor_interrupt_pin(sensor->interrupt_pin, sensor->interrupt_mask);
+  }
+
+  return result;
+}
+
+
+/*
+ * Applies any changes to the sensor's integration time and gain.
+ */
+TWIResult configure_tcs34725(TCS34725 * sensor)
+{
+  //The sensor counts its integration time down from 256; so ATIME is 256 minus the number of cycles.
+  TWIResult result = write_register(INTEGRATION_TIME_REGISTER, 256 - sensor->integration_cycles);
+
+  if(result == TWISuccess) {
+    result = write_register(CONTROL_REGISTER, sensor->gain);
+  }
+
+  return result;
+}
+
+
+/*
+ * Limits the sensor's interrupt to readings whose clear channel is outside the given thresholds.
+ */
+TWIResult set_tcs34725_thresholds(uint16_t low_threshold, uint16_t high_threshold, uint8_t persistence)
+{
+  //The four threshold registers are consecutive, low byte first; so write them in one auto-increment burst.
+  uint8_t thresholds[] = { low_threshold & 0xFF, low_threshold >> 8, high_threshold & 0xFF, high_threshold >> 8 };
+  TWIResult result = write_twi_register_block(TCS34725_ADDRESS, COMMAND_BIT | AUTO_INCREMENT | LOW_THRESHOLD_REGISTER,
+      thresholds, sizeof(thresholds));
+
+  if(result == TWISuccess) {
+    result = write_register(PERSISTENCE_REGISTER, persistence);
+  }
+
+  //Any interrupt already raised was raised under the old rules; so clear it.
+  if(result == TWISuccess) {
+    result = clear_interrupt();
+  }
+
+  return result;
+}
+
+
+/*
+ * Reads the sensor's ID register.
+ */
+TWIResult read_tcs34725_id(uint8_t * id)
+{
+  return read_twi_register_block(TCS34725_ADDRESS, COMMAND_BIT | ID_REGISTER, id, 1);
+}
+
+
+/*
+ * @return The time between the sensor's readings, in microseconds.
+ */
+uint32_t tcs34725_reading_interval_us(TCS34725 * sensor)
+{
+  //Each reading takes one cycle of setup, followed by the integration itself.
+  return (sensor->integration_cycles + 1) * TCS34725_CYCLE_MICROSECONDS;
+}
+
+
+/*
+ * @return True iff the sensor's INT output says a new reading is ready.
+ */
+uint8_t tcs34725_reading_ready(TCS34725 * sensor)
+{
+  //The INT output is active low.
+  return sensor->interrupt_pin && !(*sensor->interrupt_pin & sensor->interrupt_mask);
+}
+
+
+/*
+ * Fetches a new reading, if the sensor has finished one since the last reading was fetched.
+ */
+TWIResult read_tcs34725_if_ready(TCS34725 * sensor, TCS34725Reading * reading, uint8_t * ready)
+{
+  uint8_t status, ignored;
+  TWIResult result;
+
+  *ready = false;
+
+  //If the sensor's INT pin is connected, it tells us whether a reading is ready, without
+  //using the bus at all.
+  if(sensor->interrupt_pin && !tcs34725_reading_ready(sensor)) {
+    return TWISuccess;
+  }
+
+  //Read the STATUS register. The color data registers follow it directly; so if a reading
+  //is ready, we can keep reading, and fetch the whole reading in the same auto-increment burst.
+  result = begin_twi_write_to(TCS34725_ADDRESS);
+
+  if(result == TWISuccess) {
+    result = transmit_via_twi(COMMAND_BIT | AUTO_INCREMENT | STATUS_REGISTER);
+  }
+  if(result == TWISuccess) {
+    result = begin_twi_read_from(TCS34725_ADDRESS);
+  }
+  if(result == TWISuccess) {
+    result = receive_via_twi(&status, RequestMore);
+  }
+
+  //Since we acknowledged the status byte, we have to read at least one more byte. If there's
+  //no new reading, read just one, and stop.
+  if(result == TWISuccess) {
+    if(status & INTERRUPT_PENDING) {
+      result = read_block_via_twi((uint8_t *)reading, sizeof(*reading));
+      *ready = (result == TWISuccess);
+    } else {
+      result = receive_via_twi(&ignored, LastByte);
+    }
+  }
+
+  end_twi_packet();
+
+  //If we've fetched a reading, clear the interrupt, so we can tell when the next one is ready.
+  if(*ready) {
+    result = clear_interrupt();
+  }
+
+  return result;
+}
+
+
+/*
+ * Waits for a single step of an integration: one TCS34725_CHECKS_PER_INTEGRATION'th of the
+ * time between readings.
+ */
+static void wait_one_step(TCS34725 * sensor)
+{
+  //The delay functions need a constant delay; so wait in small, fixed-length pieces.
+  uint16_t pieces = tcs34725_reading_interval_us(sensor) / (TCS34725_CHECKS_PER_INTEGRATION * CHECK_DELAY_STEP_MICROSECONDS);
+
+  do {
+    _delay_us(CHECK_DELAY_STEP_MICROSECONDS);
+  } while(pieces-- > 1);
+}
+
+
+/*
+ * Waits ('blocks') until the sensor has finished a new reading, and then fetches it.
+ */
+TWIResult wait_for_tcs34725_reading(TCS34725 * sensor, TCS34725Reading * reading)
+{
+  uint8_t ready, skipped, early_checks = 0;
+  TWIResult result;
+
+  //If the sensor's INT pin is connected, we don't need to guess when the reading will arrive:
+  //sleep until the sensor tells us it has, and then fetch it.
+  if(sensor->interrupt_pin) {
+    do {
+      sleep_until_sensor_interrupt(sensor->interrupt_pin, sensor->interrupt_mask);
+      result = read_tcs34725_if_ready(sensor, reading, &ready);
+    } while((result == TWISuccess) && !ready);
+
+    return result;
+  }
+
+  //Readings arrive once per integration; so if we're called from a loop, the next reading arrives
+  //about the same time after our last call returned each time. Skip the checks we learned last
+  //time would be too early.
+  for(skipped = 0; skipped < sensor->checks_to_skip; ++skipped) {
+    wait_one_step(sensor);
+  }
+
+  while(1) {
+    result = read_tcs34725_if_ready(sensor, reading, &ready);
+
+    if(result != TWISuccess) {
+      return result;
+    }
+
+    if(ready) {
+      break;
+    }
+
+    ++early_checks;
+    wait_one_step(sensor);
+  }
+
+  //Learn from this wait: skip the checks that were too early, next time. If none were, try
+  //checking a step sooner next time, in case we're now waiting longer than we need to.
+  if(early_checks) {
+    sensor->checks_to_skip = skipped + early_checks;
+  } else if(sensor->checks_to_skip) {
+    sensor->checks_to_skip--;
+  }
+
+  //There's never any point waiting longer than a whole integration.
+  if(sensor->checks_to_skip > TCS34725_CHECKS_PER_INTEGRATION) {
+    sensor->checks_to_skip = TCS34725_CHECKS_PER_INTEGRATION;
+  }
+
+  return result;
+}
+
+
+/*
+ * Starts fetching a reading in the background.
+ */
+uint8_t start_tcs34725_fetch(TCS34725Fetch * fetch, TWITransactionCallback on_complete)
+{
+  //Read all eight bytes of color data in one auto-increment burst...
+  fetch->read_transaction.address      = TCS34725_ADDRESS;
+  fetch->read_transaction.to_write     = &read_color_data_command;
+  fetch->read_transaction.write_length = 1;
+  fetch->read_transaction.read_into    = (uint8_t *)&fetch->reading;
+  fetch->read_transaction.read_length  = sizeof(fetch->reading);
+  fetch->read_transaction.on_complete  = 0;
+
+  //... and then clear the interrupt, so the INT output tells us when the next reading is ready.
+  //Transactions run in the order they're queued, so this one finishes last.
+  fetch->clear_transaction.address      = TCS34725_ADDRESS;
+  fetch->clear_transaction.to_write     = &clear_interrupt_command;
+  fetch->clear_transaction.write_length = 1;
+  fetch->clear_transaction.read_into    = 0;
+  fetch->clear_transaction.read_length  = 0;
+  fetch->clear_transaction.on_complete  = on_complete;
+
+  if(!enqueue_twi_transaction(&fetch->read_transaction)) {
+    return false;
+  }
+
+  //The read has been queued, so the clear has to follow it. If the queue is full, a place
+  //frees up as soon as the TWI interrupt starts the next transaction.
+  while(!enqueue_twi_transaction(&fetch->clear_transaction));
+
+  return true;
+}
+
+
+/*
+ * @return True iff the given fetch has finished, successfully or otherwise.
+ */
+uint8_t tcs34725_fetch_finished(TCS34725Fetch * fetch)
+{
+  return twi_transaction_finished(&fetch->clear_transaction);
+}
+
+
+/*
+ * @return The result of a finished fetch.
+ */
+TWIResult tcs34725_fetch_result(TCS34725Fetch * fetch)
+{
+  TWIResult result = twi_transaction_result(&fetch->read_transaction);
+
+  if(result == TWISuccess) {
+    result = twi_transaction_result(&fetch->clear_transaction);
+  }
+
+  return result;
+}
+
+
+/*
+ * Adjusts the sensor's integration time and gain to suit the light level of the given reading.
+ */
+TWIResult autorange_tcs34725(TCS34725 * sensor, TCS34725Reading * reading)
+{
+  SensorRange current;
+  uint16_t largest_count;
+  uint8_t range;
+  TWIResult result;
+
+  //Describe the range the reading was taken in.
+  current.sensitivity   = sensor->integration_cycles * pgm_read_byte(&gains[sensor->gain]);
+  //Up to 63 cycles (64512 counts), the count per cycle is the limit; beyond that, the register size is.
+  current.maximum_count = (sensor->integration_cycles <= MAXIMUM_COUNT / MAXIMUM_COUNT_PER_CYCLE) ?
+    (uint16_t)sensor->integration_cycles * MAXIMUM_COUNT_PER_CYCLE : MAXIMUM_COUNT;
+
+  //The clear channel usually sees the most light; but check them all, in case of e.g. a bright red light.
+  largest_count = reading->clear;
+  if(reading->red > largest_count) {
+    largest_count = reading->red;
+  }
+  if(reading->green > largest_count) {
+    largest_count = reading->green;
+  }
+  if(reading->blue > largest_count) {
+    largest_count = reading->blue;
+  }
+
+  range = choose_sensor_range(ranges, sizeof(ranges) / sizeof(*ranges), current, largest_count);
+
+  if(range == KEEP_SENSOR_RANGE) {
+    return TWISuccess;
+  }
+
+  sensor->integration_cycles = pgm_read_byte(&range_settings[range].integration_cycles);
+  sensor->gain               = pgm_read_byte(&range_settings[range].gain);
+  result = configure_tcs34725(sensor);
+
+  //New settings would normally wait for the integration underway to finish. Restart the ADC
+  //instead, so the very next reading uses them; and clear the interrupt, in case a reading
+  //with the old settings has just finished.
+  if(result == TWISuccess) {
+    result = write_register(ENABLE_REGISTER, POWER_ON | INTERRUPT_ENABLE);
+  }
+  if(result == TWISuccess) {
+    result = write_register(ENABLE_REGISTER, POWER_ON | ADC_ENABLE | INTERRUPT_ENABLE);
+  }
+  if(result == TWISuccess) {
+    result = clear_interrupt();
+  }
+
+  //Our readings now arrive at a different rate; so forget what we've learned about when to check for them.
+  sensor->checks_to_skip = 0;
+
+  return result;
+}
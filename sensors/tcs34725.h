@@ -0,0 +1,293 @@
+/**
+ * EECE 387 Example Code
+ * TCS34725 color sensor driver.
+ *
+ * Takes RGBC (clear, red, green, blue) readings from a TCS34725, over TWI. Rather than
+ * reading the sensor on a fixed schedule-- and re-reading old data whenever the schedule
+ * runs faster than the sensor-- the driver only fetches data once the sensor has finished
+ * a new integration:
+ *
+ *   - The sensor is set up to raise its RGBC interrupt at the end of every integration.
+ *   - If the sensor's INT pin is connected, the driver watches it; checking for a new
+ *     reading then costs nothing on the bus. Waiting for a reading puts the CPU to sleep
+ *     until the pin changes (see sensor_interrupt.h), rather than spinning in a delay loop.
+ *   - Otherwise, the driver reads the sensor's STATUS register, and if a reading is ready,
+ *     continues straight on to read all eight bytes of color data, in the same auto-increment
+ *     burst. Checking for a reading and fetching it take a single transaction.
+ *   - When waiting for a reading, the driver checks in steps of a fraction of the integration
+ *     time; not continuously. It also learns how long the program takes between waits, and
+ *     skips the checks which would be too early; so a program which reads the sensor in a
+ *     loop usually needs only one or two checks per reading.
+ *
+ * The gain and integration time can also be adjusted automatically, to suit the light
+ * level, with autorange_tcs34725 (see autorange.h).
+ *
+ * Programs which can't afford to wait for a reading-- e.g. tasks run by timer/scheduler.h--
+ * can instead watch the INT pin with tcs34725_reading_ready, and fetch each reading in the
+ * background with start_tcs34725_fetch, using the TWI library's asynchronous transactions.
+ *
+ * Alternatively, the interrupt can be limited to readings which cross a pair of thresholds,
+ * with set_tcs34725_thresholds; waiting for a reading then waits until the light changes.
+ *
+ * @code
+ *   TCS34725 sensor = TCS34725_SENSOR(42, TCS34725Gain4x);  // 100.8ms integrations
+ *   TCS34725Reading reading;
+ *
+ *   start_tcs34725(&sensor);
+ *
+ *   while(1) {
+ *     wait_for_tcs34725_reading(&sensor, &reading);
+ *     // use reading.clear, reading.red, ...
+ *     autorange_tcs34725(&sensor, &reading);   // optional
+ *   }
+ * @endcode
+ *
+ * The TWI hardware must already be set up (e.g. with configure_twi_clock).
+ */
+
+#ifndef __SENSORS_TCS34725_H__
+#define __SENSORS_TCS34725_H__
+
+#include "../twi/master.h"
+#include "autorange.h"
+
+/**
+ * The TCS34725's fixed TWI address.
+ */
+#define TCS34725_ADDRESS 0x29
+
+/**
+ * The value of the TCS34725's ID register. (The TCS34727 reads 0x4D.)
+ */
+#define TCS34725_ID 0x44
+
+/**
+ * The length of each of the ADC's integration cycles (and of the setup which precedes
+ * each integration), in microseconds.
+ */
+#define TCS34725_CYCLE_MICROSECONDS 2400UL
+
+/**
+ * The number of steps each integration is divided into, when waiting for a reading; the
+ * driver checks for a new reading at most once per step. Higher values fetch readings sooner
+ * after they're ready. You can override this at compile time (e.g. on the GCC command line).
+ */
+#ifndef TCS34725_CHECKS_PER_INTEGRATION
+  #define TCS34725_CHECKS_PER_INTEGRATION 16
+#endif
+
+/**
+ * The TCS34725's RGBC gain settings.
+ */
+enum TCS34725Gain_enum {
+  TCS34725Gain1x = 0,
+  TCS34725Gain4x,
+  TCS34725Gain16x,
+  TCS34725Gain60x
+};
+typedef enum TCS34725Gain_enum TCS34725Gain;
+
+
+/**
+ * A single RGBC reading. The fields are in the same order as the sensor's data registers,
+ * so a reading can be burst-read directly into this structure.
+ */
+struct TCS34725Reading_struct {
+  uint16_t clear;
+  uint16_t red;
+  uint16_t green;
+  uint16_t blue;
+};
+typedef struct TCS34725Reading_struct TCS34725Reading;
+
+
+/**
+ * A reading being fetched in the background; see start_tcs34725_fetch.
+ */
+struct TCS34725Fetch_struct {
+
+  /** The reading. Valid once the fetch has finished successfully. */
+  TCS34725Reading reading;
+
+  /** The transactions which read the color data, and then clear the sensor's interrupt. Used internally. */
+  TWITransaction read_transaction;
+  TWITransaction clear_transaction;
+
+};
+typedef struct TCS34725Fetch_struct TCS34725Fetch;
+
+
+/**
+ * Describes a TCS34725, and how it should be set up.
+ * Should be created with TCS34725_SENSOR or TCS34725_SENSOR_WITH_INTERRUPT.
+ */
+struct TCS34725_struct {
+
+  /**
+   * The length of each integration, in 2.4ms cycles, from 1 to 256. Longer integrations
+   * produce larger (more precise) readings; each cycle adds up to 1024 counts, to a maximum of 65535.
+   */
+  uint16_t integration_cycles;
+
+  /** The RGBC gain. */
+  TCS34725Gain gain;
+
+  /** The PIN register for the pin connected to the sensor's INT output; or 0 if it isn't connected. */
+  volatile uint8_t * interrupt_pin;
+
+  /** A bitmask which selects the INT pin. */
+  uint8_t interrupt_mask;
+
+  /** The number of steps to wait before first checking for a reading; see wait_for_tcs34725_reading. Used internally. */
+  uint8_t checks_to_skip;
+
+};
+typedef struct TCS34725_struct TCS34725;
+
+/**
+ * Creates a TCS34725 with the given settings, whose INT output isn't connected.
+ *
+ * @param cycles The length of each integration, in 2.4ms cycles, from 1 to 256.
+ * @param gain_setting The RGBC gain; e.g. TCS34725Gain4x.
+ */
+#define TCS34725_SENSOR(cycles, gain_setting) \
+  { .integration_cycles = (cycles), .gain = (gain_setting), .interrupt_pin = 0, .interrupt_mask = 0, .checks_to_skip = 0 }
+
+/**
+ * Creates a TCS34725 with the given settings, whose INT output is connected to the given pin.
+ * start_tcs34725 sets the pin up as an input, with its pull-up enabled, and with its pin
+ * change interrupt enabled; see sensor_interrupt.h.
+ *
+ * @param cycles The length of each integration, in 2.4ms cycles, from 1 to 256.
+ * @param gain_setting The RGBC gain; e.g. TCS34725Gain4x.
+ * @param pin_register The PIN register for the pin connected to INT; e.g. PIND.
+ * @param bit The bit number of the pin connected to INT; e.g. PD2.
+ */
+#define TCS34725_SENSOR_WITH_INTERRUPT(cycles, gain_setting, pin_register, bit) \
+  { .integration_cycles = (cycles), .gain = (gain_setting), .interrupt_pin = &(pin_register), .interrupt_mask = (1 << (bit)), \
+    .checks_to_skip = 0 }
+
+
+/**
+ * Sets up the sensor's integration time and gain, and starts it taking readings.
+ *
+ * @param sensor The sensor to be started.
+ * @return TWISuccess on success; or the reason the sensor couldn't be set up, e.g. TWIWriteAddressNotAcknowledged.
+ */
+TWIResult start_tcs34725(TCS34725 * sensor);
+
+/**
+ * Applies any changes to the sensor's integration time and gain. The new settings take
+ * effect from the sensor's next integration; the reading currently being taken (if any)
+ * will still use the old ones.
+ *
+ * @param sensor The sensor to be updated.
+ * @return TWISuccess on success; or the reason the settings couldn't be applied.
+ */
+TWIResult configure_tcs34725(TCS34725 * sensor);
+
+/**
+ * Limits the sensor's interrupt-- and so the readings wait_for_tcs34725_reading and
+ * read_tcs34725_if_ready return-- to readings whose clear channel is below the low threshold,
+ * or above the high threshold. Useful with a connected INT pin, to sleep until the light changes.
+ *
+ * The thresholds are in counts, so they depend on the sensor's integration time and gain;
+ * they're best not combined with autorange_tcs34725.
+ *
+ * @param low_threshold Clear channel readings below this count raise the interrupt.
+ * @param high_threshold Clear channel readings above this count raise the interrupt.
+ * @param persistence The sensor's persistence (PERS) setting: 0 raises the interrupt on every
+ *    reading, ignoring the thresholds (the default); 1, 2 and 3 need that many consecutive
+ *    readings outside the thresholds; and from 4 to 15, (setting - 3) * 5 readings.
+ * @return TWISuccess on success; or the reason the thresholds couldn't be set.
+ */
+TWIResult set_tcs34725_thresholds(uint16_t low_threshold, uint16_t high_threshold, uint8_t persistence);
+
+/**
+ * Reads the sensor's ID register; which should be TCS34725_ID.
+ *
+ * @param id The location which will receive the ID.
+ * @return TWISuccess on success; or the reason the ID couldn't be read.
+ */
+TWIResult read_tcs34725_id(uint8_t * id);
+
+/**
+ * @return The time between the sensor's readings, in microseconds, as set by its integration time.
+ */
+uint32_t tcs34725_reading_interval_us(TCS34725 * sensor);
+
+/**
+ * Checks the sensor's INT output, to see whether a new reading is ready. Never uses the bus.
+ *
+ * @param sensor The sensor to be checked.
+ * @return True iff a reading is ready; always false if the sensor's INT pin isn't connected.
+ */
+uint8_t tcs34725_reading_ready(TCS34725 * sensor);
+
+/**
+ * Fetches a new reading, if the sensor has finished one since the last reading was fetched.
+ * Never waits for a reading.
+ *
+ * @param sensor The sensor to be read.
+ * @param reading The location which will receive the reading. Left unmodified if no reading was ready.
+ * @param ready The location which will receive true if a new reading was fetched, or false if not.
+ * @return TWISuccess on success, whether or not a reading was ready; or the reason the sensor couldn't be read.
+ */
+TWIResult read_tcs34725_if_ready(TCS34725 * sensor, TCS34725Reading * reading, uint8_t * ready);
+
+/**
+ * Waits ('blocks') until the sensor has finished a new reading, and then fetches it.
+ *
+ * If the sensor's INT pin is connected, the CPU sleeps until the sensor raises its interrupt;
+ * interrupts must be enabled. Otherwise, this works best when called regularly, e.g. from a loop
+ * which handles each reading; the driver learns how long the loop takes, and waits accordingly,
+ * rather than checking (and using the bus) repeatedly.
+ *
+ * @param sensor The sensor to be read.
+ * @param reading The location which will receive the reading.
+ * @return TWISuccess on success; or the reason the sensor couldn't be read.
+ */
+TWIResult wait_for_tcs34725_reading(TCS34725 * sensor, TCS34725Reading * reading);
+
+/**
+ * Starts fetching a reading in the background, as a pair of asynchronous TWI transactions
+ * (see enqueue_twi_transaction): one which reads the color data, and one which then clears
+ * the sensor's interrupt. Global interrupts must be enabled.
+ *
+ * The fetch doesn't check whether a reading is ready; so only start one once it is, e.g.
+ * when tcs34725_reading_ready says so. The fetch must remain valid until it has finished,
+ * and must not be started again until then.
+ *
+ * @param fetch The fetch to be started. Its reading is filled in as the fetch runs.
+ * @param on_complete A function to be called (from the TWI interrupt) when the fetch has finished; or 0 for none.
+ * @retval 0 Returned if the TWI transaction queue is full; nothing was started.
+ * @retval 1 Returned if the fetch was started.
+ */
+uint8_t start_tcs34725_fetch(TCS34725Fetch * fetch, TWITransactionCallback on_complete);
+
+/**
+ * @return True iff the given fetch has finished, successfully or otherwise.
+ */
+uint8_t tcs34725_fetch_finished(TCS34725Fetch * fetch);
+
+/**
+ * @param fetch A fetch which has finished; see tcs34725_fetch_finished.
+ * @return TWISuccess if the reading was fetched; or the reason it couldn't be.
+ */
+TWIResult tcs34725_fetch_result(TCS34725Fetch * fetch);
+
+/**
+ * Adjusts the sensor's integration time and gain to suit the light level of the given
+ * reading, if they don't already; see autorange.h. Any change takes effect immediately:
+ * the sensor starts a new integration, so the next reading uses the new settings.
+ *
+ * Readings taken with different settings aren't directly comparable; so check the sensor's
+ * settings before comparing them, or record them with each reading.
+ *
+ * @param sensor The sensor which took the reading.
+ * @param reading The sensor's latest reading.
+ * @return TWISuccess on success, whether or not the settings changed; or the reason the settings couldn't be applied.
+ */
+TWIResult autorange_tcs34725(TCS34725 * sensor, TCS34725Reading * reading);
+
+#endif
@@ -0,0 +1,361 @@
+/*
+ * EECE 387 Example Code
+ * TSL2561 light sensor driver.
+ *
+ * See tsl2561.h for usage.
+ */
+
+#include "tsl2561.h"
+#include "sensor_interrupt.h"
+
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+
+//The bits of the command byte, which precedes every register access: the command bit itself,
+//which must always be set; the clear bit, which clears any pending interrupt; and the word bit,
+//which makes reads and writes advance through the registers.
+#define COMMAND_BIT               0x80
+#define CLEAR_BIT                 0x40
+#define WORD_BIT                  0x20
+
+//The sensor's registers.
+#define CONTROL_REGISTER          0x0
+#define TIMING_REGISTER           0x1
+#define LOW_THRESHOLD_REGISTER    0x2
+#define INTERRUPT_REGISTER        0x6
+#define ID_REGISTER               0xA
+#define DATA0_LOW_REGISTER        0xC
+
+//The values of the control register which power the sensor on and off.
+#define POWER_ON                  0x03
+#define POWER_OFF                 0x00
+
+//The interrupt register's setting for a level interrupt: the INT output is held low until cleared.
+#define LEVEL_INTERRUPT           0x10
+#define PERSISTENCE_MASK          0x0F
+
+//The fixed-point scales used by the lux calculation, in bits: for the lux itself, for the
+//ratio between the two channels, and for the channel scaling factors.
+#define LUX_SCALE                 19
+#define RATIO_SCALE               9
+#define CHANNEL_SCALE             10
+
+//The granularity of our waits for an integration to finish.
+#define WAIT_STEP_MICROSECONDS    100
+
+/*
+ * The datasheet's lux formula is for 402ms integrations, at 16x gain. The factors which scale
+ * each integration time's readings up to a 402ms integration, with CHANNEL_SCALE fractional bits:
+ * 322/11 and 322/81 for the two shorter integrations, whose lengths are 11 and 81 322nds of 402ms.
+ */
+static const uint16_t integration_scales[] PROGMEM = { 0x7517, 0x0FE7, 1 << CHANNEL_SCALE };
+
+//The largest count each integration time can produce.
+static const uint16_t maximum_counts[] PROGMEM = { 5047, 37177, 65535 };
+
+/*
+ * The ranges used for automatic ranging, from least to most sensitive; and the integration time
+ * and gain for each. The sensitivity of each is the fraction of a 402ms integration it collects,
+ * in 322nds, times its gain. (13.7ms at 16x is left out: 402ms at 1x is more sensitive, and
+ * doesn't saturate as easily; so it would never be chosen.)
+ */
+static const SensorRange ranges[] PROGMEM = {
+  { 11,   5047  },
+  { 81,   37177 },
+  { 322,  65535 },
+  { 1296, 37177 },
+  { 5152, 65535 }
+};
+static const struct {
+  uint8_t integration;
+  uint8_t gain;
+} range_settings[] PROGMEM = {
+  { TSL2561Integration13ms,  TSL2561Gain1x  },
+  { TSL2561Integration101ms, TSL2561Gain1x  },
+  { TSL2561Integration402ms, TSL2561Gain1x  },
+  { TSL2561Integration101ms, TSL2561Gain16x },
+  { TSL2561Integration402ms, TSL2561Gain16x }
+};
+
+//The fraction of a 402ms integration collected by each integration time, in 322nds.
+static const uint16_t integration_fractions[] PROGMEM = { 11, 81, 322 };
+
+//The number of segments in each package's lux approximation.
+#define SEGMENTS 8
+
+/*
+ * A piecewise-linear approximation of the datasheet's lux formula, for each package: for each
+ * range of channel 1 / channel 0 ratios (up to ratio_limit, with RATIO_SCALE fractional bits),
+ * lux = channel0 * b - channel1 * m (with LUX_SCALE fractional bits).
+ *
+ * The ratio ranges are the datasheet's. Above a ratio of about 0.5, the formula is itself linear,
+ * and b and m are its coefficients; below that, it has a ratio^1.4 term, and b and m describe the
+ * line with the smallest worst-case relative error over each range. (The datasheet's own table
+ * keeps only 14 fractional bits, which is far too coarse where the formula nears zero lux, at
+ * ratios approaching 1.3; check_tsl2561_lux.c compares this table against the formula.)
+ */
+static const struct {
+  uint16_t ratio_limit;
+  uint16_t b;
+  uint16_t m;
+} lux_segments[][SEGMENTS] PROGMEM = {
+
+  //T, FN and CL packages.
+  {
+    { 0x0040, 0x3EB5, 0x37D8 },
+    { 0x0080, 0x42EC, 0x5AEF },
+    { 0x00C0, 0x4829, 0x6FE2 },
+    { 0x0100, 0x4E5E, 0x804E },
+    { 0x0138, 0x2DE0, 0x3F7D },
+    { 0x019A, 0x1A37, 0x1F56 },
+    { 0x029A, 0x02FD, 0x024B },
+    { 0x029A, 0x0000, 0x0000 }
+  },
+
+  //CS package.
+  {
+    { 0x0043, 0x40F8, 0x3662 },
+    { 0x0085, 0x453D, 0x5866 },
+    { 0x00C8, 0x4A85, 0x6CB7 },
+    { 0x010A, 0x50C4, 0x7C9C },
+    { 0x014D, 0x2EE6, 0x3B99 },
+    { 0x019A, 0x2027, 0x24DD },
+    { 0x029A, 0x06EC, 0x0553 },
+    { 0x029A, 0x0000, 0x0000 }
+  }
+};
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Writes a single one of the sensor's registers.
+ */
+static TWIResult write_register(TSL2561 * sensor, uint8_t register_address, uint8_t value)
+{
+  return write_twi_register_block(sensor->address, COMMAND_BIT | register_address, &value, 1);
+}
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Powers on the sensor, and sets up its integration time and gain.
+ */
+TWIResult start_tsl2561(TSL2561 * sensor)
+{
+  //Configuring the sensor leaves it powered on.
+  TWIResult result = configure_tsl2561(sensor);
+
+  //If the INT output is connected, have the sensor raise a level interrupt at the end of every
+  //integration (a persistence of zero), and get ready to sleep until it does.
+  if(sensor->interrupt_pin) {
+    if(result == TWISuccess) {
+      result = set_tsl2561_thresholds(sensor, 0, 0, 0);
+    }
+
+    watch_sensor_interrupt_pin(sensor->interrupt_pin, sensor->interrupt_mask);
+  }
+
+  return result;
+}
+
+
+/*
+ * Applies any changes to the sensor's integration time and gain.
+ */
+TWIResult configure_tsl2561(TSL2561 * sensor)
+{
+  //Power the sensor down while we change its settings; when it's powered back up, it starts
+  //a fresh integration, so the next reading won't be a mix of the old settings and the new.
+  TWIResult result = write_register(sensor, CONTROL_REGISTER, POWER_OFF);
+
+  //Clear any interrupt raised by a reading with the old settings, as we apply the new ones.
+  if(result == TWISuccess) {
+    result = write_register(sensor, CLEAR_BIT | TIMING_REGISTER, sensor->gain | sensor->integration);
+  }
+  if(result == TWISuccess) {
+    result = write_register(sensor, CONTROL_REGISTER, POWER_ON);
+  }
+
+  return result;
+}
+
+
+/*
+ * Limits the sensor's interrupt to readings whose channel 0 count is outside the given thresholds.
+ */
+TWIResult set_tsl2561_thresholds(TSL2561 * sensor, uint16_t low_threshold, uint16_t high_threshold, uint8_t persistence)
+{
+  //The four threshold registers are consecutive, low byte first; so write them in one burst.
+  uint8_t thresholds[] = { low_threshold & 0xFF, low_threshold >> 8, high_threshold & 0xFF, high_threshold >> 8 };
+  TWIResult result = write_twi_register_block(sensor->address, COMMAND_BIT | WORD_BIT | LOW_THRESHOLD_REGISTER,
+      thresholds, sizeof(thresholds));
+
+  //Any interrupt already raised was raised under the old rules; so clear it as we apply the new ones.
+  if(result == TWISuccess) {
+    result = write_register(sensor, CLEAR_BIT | INTERRUPT_REGISTER, LEVEL_INTERRUPT | (persistence & PERSISTENCE_MASK));
+  }
+
+  return result;
+}
+
+
+/*
+ * Reads the sensor's ID register.
+ */
+TWIResult read_tsl2561_id(TSL2561 * sensor, uint8_t * id)
+{
+  return read_twi_register_block(sensor->address, COMMAND_BIT | ID_REGISTER, id, 1);
+}
+
+
+/*
+ * @return The time between the sensor's readings, in microseconds.
+ */
+uint32_t tsl2561_reading_interval_us(TSL2561 * sensor)
+{
+  switch(sensor->integration) {
+    case TSL2561Integration13ms:
+      return 13700;
+    case TSL2561Integration101ms:
+      return 101000;
+    default:
+      return 402000;
+  }
+}
+
+
+/*
+ * Reads both of the sensor's channels, in a single transaction.
+ */
+TWIResult read_tsl2561(TSL2561 * sensor, TSL2561Reading * reading)
+{
+  //The channel 1 registers directly follow the channel 0 registers; so with the word bit set,
+  //we can read all four bytes in one burst. Reading each low byte latches its high byte, so
+  //we never see half of one reading and half of the next. The clear bit acknowledges any
+  //interrupt in the same transaction, so the INT output is ready to tell us about the next reading.
+  return read_twi_register_block(sensor->address, COMMAND_BIT | CLEAR_BIT | WORD_BIT | DATA0_LOW_REGISTER,
+      (uint8_t *)reading, sizeof(*reading));
+}
+
+
+/*
+ * Waits for a new reading, and then reads both of the sensor's channels.
+ */
+TWIResult wait_for_tsl2561_reading(TSL2561 * sensor, TSL2561Reading * reading)
+{
+  uint16_t steps;
+
+  //If the sensor's INT pin is connected, sleep until the sensor tells us a reading is ready.
+  if(sensor->interrupt_pin) {
+    sleep_until_sensor_interrupt(sensor->interrupt_pin, sensor->interrupt_mask);
+    return read_tsl2561(sensor, reading);
+  }
+
+  //Otherwise, wait for a full integration. The delay functions need a constant delay; so wait
+  //in small, fixed-length steps.
+  steps = tsl2561_reading_interval_us(sensor) / WAIT_STEP_MICROSECONDS;
+
+  do {
+    _delay_us(WAIT_STEP_MICROSECONDS);
+  } while(steps-- > 1);
+
+  return read_tsl2561(sensor, reading);
+}
+
+
+/*
+ * @return True iff either of the reading's channels is saturated.
+ */
+uint8_t tsl2561_reading_is_saturated(TSL2561 * sensor, TSL2561Reading * reading)
+{
+  uint16_t maximum_count = pgm_read_word(&maximum_counts[sensor->integration]);
+  return (reading->broadband >= maximum_count) || (reading->infrared >= maximum_count);
+}
+
+
+/*
+ * Converts a reading to lux, using only integer math.
+ * This is the CalculateLux algorithm from the TSL2561 datasheet, with more precise coefficients.
+ */
+uint32_t tsl2561_lux(TSL2561 * sensor, TSL2561Reading * reading)
+{
+  uint32_t scale, channel0, channel1, ratio;
+  uint64_t positive, negative;
+  uint8_t i;
+
+  if(tsl2561_reading_is_saturated(sensor, reading)) {
+    return TSL2561_LUX_SATURATED;
+  }
+
+  //Scale both channels up to what a 402ms integration, at 16x gain, would have read.
+  scale = pgm_read_word(&integration_scales[sensor->integration]);
+
+  if(sensor->gain == TSL2561Gain1x) {
+    scale <<= 4;
+  }
+
+  channel0 = (reading->broadband * scale) >> CHANNEL_SCALE;
+  channel1 = (reading->infrared * scale) >> CHANNEL_SCALE;
+
+  //Find the ratio of infrared to broadband light, rounded to RATIO_SCALE fractional bits.
+  //(We compute it with one extra bit, so we can round.)
+  ratio = 0;
+  if(channel0) {
+    ratio = ((channel1 << (RATIO_SCALE + 1)) / channel0 + 1) >> 1;
+  }
+
+  //Find the segment of the lux approximation which covers that ratio; the last segment covers
+  //all ratios above the others...
+  for(i = 0; (i < SEGMENTS - 1) && (ratio > pgm_read_word(&lux_segments[sensor->package][i].ratio_limit)); ++i);
+
+  //... and apply it. At 1x gain, the scaled channels can reach 22 bits, so the products need 64.
+  //The segments never produce negative lux for readings in their range, but clamp anyway, in case of noise.
+  positive = (uint64_t)channel0 * pgm_read_word(&lux_segments[sensor->package][i].b);
+  negative = (uint64_t)channel1 * pgm_read_word(&lux_segments[sensor->package][i].m);
+
+  if(negative > positive) {
+    return 0;
+  }
+
+  //Round, and drop the fractional bits.
+  return (positive - negative + (1UL << (LUX_SCALE - 1))) >> LUX_SCALE;
+}
+
+
+/*
+ * Adjusts the sensor's gain and integration time to suit the light level of the given reading.
+ */
+TWIResult autorange_tsl2561(TSL2561 * sensor, TSL2561Reading * reading)
+{
+  SensorRange current;
+  uint8_t range;
+
+  //Describe the range the reading was taken in. The broadband channel sees all of the light
+  //the infrared channel does, and more; so it's always the larger of the two.
+  current.sensitivity   = pgm_read_word(&integration_fractions[sensor->integration]);
+  current.maximum_count = pgm_read_word(&maximum_counts[sensor->integration]);
+
+  if(sensor->gain == TSL2561Gain16x) {
+    current.sensitivity *= 16;
+  }
+
+  range = choose_sensor_range(ranges, sizeof(ranges) / sizeof(*ranges), current, reading->broadband);
+
+  if(range == KEEP_SENSOR_RANGE) {
+    return TWISuccess;
+  }
+
+  sensor->integration = pgm_read_byte(&range_settings[range].integration);
+  sensor->gain        = pgm_read_byte(&range_settings[range].gain);
+  return configure_tsl2561(sensor);
+}
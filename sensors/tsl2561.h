@@ -0,0 +1,265 @@
+/**
+ * EECE 387 Example Code
+ * TSL2561 light sensor driver.
+ *
+ * Takes readings from a TSL2561 over TWI, and converts them to lux. Each reading
+ * fetches both of the sensor's channels-- channel 0 (visible and infrared light) and
+ * channel 1 (infrared only)-- in a single four-byte auto-increment burst.
+ *
+ * The TSL2561 has no status register to say when a reading is ready. If its INT pin is
+ * connected, the driver has it raise a level interrupt at the end of every integration, and
+ * wait_for_tsl2561_reading sleeps until the pin goes low (see sensor_interrupt.h); each read
+ * clears the interrupt in the same transaction. Otherwise, rather than polling,
+ * wait_for_tsl2561_reading waits for a full integration between reads. Either way, the same
+ * reading is never fetched twice.
+ *
+ * With the INT pin connected, the interrupt can also be limited to readings which cross a pair
+ * of thresholds, with set_tsl2561_thresholds; waiting for a reading then waits until the light changes.
+ *
+ * Lux is computed with the integer-only algorithm from the TSL2561 datasheet, which
+ * approximates the datasheet's empirical formula with a table of line segments; so no
+ * floating point math is needed, which would take milliseconds per reading on the AVR.
+ *
+ * The gain and integration time can also be adjusted automatically, to suit the light
+ * level, with autorange_tsl2561 (see autorange.h).
+ *
+ * @code
+ *   TSL2561 sensor = TSL2561_SENSOR(TSL2561_ADDRESS_FLOAT, TSL2561Integration101ms, TSL2561Gain1x);
+ *   TSL2561Reading reading;
+ *
+ *   start_tsl2561(&sensor);
+ *
+ *   while(1) {
+ *     wait_for_tsl2561_reading(&sensor, &reading);
+ *     lux = tsl2561_lux(&sensor, &reading);
+ *     autorange_tsl2561(&sensor, &reading);   // optional
+ *   }
+ * @endcode
+ *
+ * The TWI hardware must already be set up (e.g. with configure_twi_clock).
+ */
+
+#ifndef __SENSORS_TSL2561_H__
+#define __SENSORS_TSL2561_H__
+
+#include "../twi/master.h"
+#include "autorange.h"
+
+/**
+ * The TSL2561's TWI addresses, selected by its ADDR SEL pin.
+ */
+#define TSL2561_ADDRESS_GROUND 0x29
+#define TSL2561_ADDRESS_FLOAT  0x39
+#define TSL2561_ADDRESS_VDD    0x49
+
+/**
+ * The value tsl2561_lux returns when a reading is saturated, and so can't be converted to lux.
+ */
+#define TSL2561_LUX_SATURATED 0xFFFFFFFFUL
+
+/**
+ * The TSL2561's integration times. Longer integrations produce larger (more precise)
+ * readings, but saturate in less light.
+ */
+enum TSL2561Integration_enum {
+  TSL2561Integration13ms  = 0,  // 13.7ms; saturates at 5047 counts.
+  TSL2561Integration101ms = 1,  // 101ms; saturates at 37177 counts.
+  TSL2561Integration402ms = 2   // 402ms; saturates at 65535 counts.
+};
+typedef enum TSL2561Integration_enum TSL2561Integration;
+
+/**
+ * The TSL2561's gain settings. The values are those of the TIMING register's GAIN bit.
+ */
+enum TSL2561Gain_enum {
+  TSL2561Gain1x  = 0x00,
+  TSL2561Gain16x = 0x10
+};
+typedef enum TSL2561Gain_enum TSL2561Gain;
+
+/**
+ * The TSL2561's packages, which have slightly different responses; so each has its
+ * own lux coefficients.
+ */
+enum TSL2561Package_enum {
+  TSL2561PackageT = 0,  // The T, FN and CL packages.
+  TSL2561PackageCS      // The CS (chipscale) package.
+};
+typedef enum TSL2561Package_enum TSL2561Package;
+
+
+/**
+ * A single reading. The fields are in the same order as the sensor's data registers,
+ * so a reading can be burst-read directly into this structure.
+ */
+struct TSL2561Reading_struct {
+
+  /** The channel 0 reading: visible and infrared light. */
+  uint16_t broadband;
+
+  /** The channel 1 reading: infrared light only. */
+  uint16_t infrared;
+
+};
+typedef struct TSL2561Reading_struct TSL2561Reading;
+
+
+/**
+ * Describes a TSL2561, and how it should be set up.
+ * Should be created with TSL2561_SENSOR or TSL2561_SENSOR_WITH_INTERRUPT.
+ */
+struct TSL2561_struct {
+
+  /** The sensor's TWI address; e.g. TSL2561_ADDRESS_FLOAT. */
+  uint8_t address;
+
+  /** The length of each integration. */
+  TSL2561Integration integration;
+
+  /** The gain. */
+  TSL2561Gain gain;
+
+  /** The sensor's package, which selects the coefficients used to compute lux. */
+  TSL2561Package package;
+
+  /** The PIN register for the pin connected to the sensor's INT output; or 0 if it isn't connected. */
+  volatile uint8_t * interrupt_pin;
+
+  /** A bitmask which selects the INT pin. */
+  uint8_t interrupt_mask;
+
+};
+typedef struct TSL2561_struct TSL2561;
+
+/**
+ * Creates a TSL2561 (in the T, FN or CL package) with the given settings.
+ * For the CS package, set the result's package field to TSL2561PackageCS.
+ *
+ * @param sensor_address The sensor's TWI address; e.g. TSL2561_ADDRESS_FLOAT.
+ * @param integration_time The length of each integration; e.g. TSL2561Integration101ms.
+ * @param gain_setting The gain; e.g. TSL2561Gain1x.
+ */
+#define TSL2561_SENSOR(sensor_address, integration_time, gain_setting) \
+  { .address = (sensor_address), .integration = (integration_time), .gain = (gain_setting), .package = TSL2561PackageT, \
+    .interrupt_pin = 0, .interrupt_mask = 0 }
+
+/**
+ * Creates a TSL2561 (in the T, FN or CL package) with the given settings, whose INT output
+ * is connected to the given pin. start_tsl2561 sets the pin up as an input, with its pull-up
+ * enabled, and with its pin change interrupt enabled; see sensor_interrupt.h.
+ *
+ * @param sensor_address The sensor's TWI address; e.g. TSL2561_ADDRESS_FLOAT.
+ * @param integration_time The length of each integration; e.g. TSL2561Integration101ms.
+ * @param gain_setting The gain; e.g. TSL2561Gain1x.
+ * @param pin_register The PIN register for the pin connected to INT; e.g. PIND.
+ * @param bit The bit number of the pin connected to INT; e.g. PD3.
+ */
+#define TSL2561_SENSOR_WITH_INTERRUPT(sensor_address, integration_time, gain_setting, pin_register, bit) \
+  { .address = (sensor_address), .integration = (integration_time), .gain = (gain_setting), .package = TSL2561PackageT, \
+    .interrupt_pin = &(pin_register), .interrupt_mask = (1 << (bit)) }
+
+
+/**
+ * Powers on the sensor, and sets up its integration time and gain. The first reading
+ * is ready once the first integration has finished. If the sensor's INT pin is connected,
+ * also sets up its interrupt, to be raised at the end of every integration.
+ *
+ * @param sensor The sensor to be started.
+ * @return TWISuccess on success; or the reason the sensor couldn't be set up, e.g. TWIWriteAddressNotAcknowledged.
+ */
+TWIResult start_tsl2561(TSL2561 * sensor);
+
+/**
+ * Applies any changes to the sensor's integration time and gain. The sensor is briefly
+ * powered down, so it starts a new integration with the new settings; so the next reading
+ * is ready once it has finished.
+ *
+ * @param sensor The sensor to be updated.
+ * @return TWISuccess on success; or the reason the settings couldn't be applied.
+ */
+TWIResult configure_tsl2561(TSL2561 * sensor);
+
+/**
+ * Limits the sensor's interrupt-- and so, if its INT pin is connected, the readings
+ * wait_for_tsl2561_reading returns-- to readings whose channel 0 count is below the low
+ * threshold, or above the high threshold. Useful to sleep until the light changes.
+ *
+ * The thresholds are in counts, so they depend on the sensor's integration time and gain;
+ * they're best not combined with autorange_tsl2561.
+ *
+ * @param sensor The sensor to be set up.
+ * @param low_threshold Channel 0 readings below this count raise the interrupt.
+ * @param high_threshold Channel 0 readings above this count raise the interrupt.
+ * @param persistence 0 to raise the interrupt at the end of every integration, ignoring the thresholds
+ *    (as start_tsl2561 does); or, from 1 to 15, the number of consecutive readings which must
+ *    be outside the thresholds.
+ * @return TWISuccess on success; or the reason the thresholds couldn't be set.
+ */
+TWIResult set_tsl2561_thresholds(TSL2561 * sensor, uint16_t low_threshold, uint16_t high_threshold, uint8_t persistence);
+
+/**
+ * Reads the sensor's ID register. The high nibble is the part number; the low nibble, its revision.
+ *
+ * @param sensor The sensor to be read.
+ * @param id The location which will receive the ID.
+ * @return TWISuccess on success; or the reason the ID couldn't be read.
+ */
+TWIResult read_tsl2561_id(TSL2561 * sensor, uint8_t * id);
+
+/**
+ * @return The time between the sensor's readings, in microseconds, as set by its integration time.
+ */
+uint32_t tsl2561_reading_interval_us(TSL2561 * sensor);
+
+/**
+ * Reads both of the sensor's channels, in a single transaction; and clears the sensor's interrupt.
+ *
+ * @param sensor The sensor to be read.
+ * @param reading The location which will receive the reading.
+ * @return TWISuccess on success; or the reason the sensor couldn't be read.
+ */
+TWIResult read_tsl2561(TSL2561 * sensor, TSL2561Reading * reading);
+
+/**
+ * Waits ('blocks') for a new reading, and then reads both of the sensor's channels.
+ * When called in a loop, this reads each new reading at most once.
+ *
+ * If the sensor's INT pin is connected, the CPU sleeps until the sensor raises its interrupt;
+ * interrupts must be enabled. Otherwise, this waits for a full integration.
+ *
+ * @param sensor The sensor to be read.
+ * @param reading The location which will receive the reading.
+ * @return TWISuccess on success; or the reason the sensor couldn't be read.
+ */
+TWIResult wait_for_tsl2561_reading(TSL2561 * sensor, TSL2561Reading * reading);
+
+/**
+ * @return True iff either of the reading's channels is saturated, for the sensor's current
+ *    integration time; in which case the reading doesn't reflect the actual light level.
+ */
+uint8_t tsl2561_reading_is_saturated(TSL2561 * sensor, TSL2561Reading * reading);
+
+/**
+ * Converts a reading to lux, using only integer math. Takes the sensor's integration
+ * time, gain and package into account.
+ *
+ * @param sensor The sensor which took the reading.
+ * @param reading The reading to be converted.
+ * @return The illuminance, in whole lux; or TSL2561_LUX_SATURATED, if the reading is saturated.
+ */
+uint32_t tsl2561_lux(TSL2561 * sensor, TSL2561Reading * reading);
+
+/**
+ * Adjusts the sensor's gain and integration time to suit the light level of the given
+ * reading, if they don't already; see autorange.h. Any change takes effect immediately,
+ * so the next reading (e.g. from wait_for_tsl2561_reading) uses the new settings.
+ *
+ * Since tsl2561_lux uses the sensor's current settings, convert the reading before calling this.
+ *
+ * @param sensor The sensor which took the reading.
+ * @param reading The sensor's latest reading.
+ * @return TWISuccess on success, whether or not the settings changed; or the reason the settings couldn't be applied.
+ */
+TWIResult autorange_tsl2561(TSL2561 * sensor, TSL2561Reading * reading);
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ * EECE 387 Example Code
+ * Cooperative task scheduler.
+ *
+ * See scheduler.h for usage.
+ */
+
+#include "scheduler.h"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#ifndef F_CPU
+  #error "The scheduler needs to know the device's clock speed (F_CPU)."
+#endif
+
+//Timer 0 runs in CTC mode, counting at F_CPU / 64, and wrapping back to zero (and
+//interrupting) once per millisecond.
+#define TIMER_PRESCALER          64
+#define COUNTS_PER_MILLISECOND   (F_CPU / TIMER_PRESCALER / 1000)
+
+#if (COUNTS_PER_MILLISECOND < 1) || (COUNTS_PER_MILLISECOND > 256)
+  #error "The scheduler can't produce a one millisecond tick at this clock speed (F_CPU)."
+#endif
+
+//The number of milliseconds since the scheduler started.
+static volatile uint32_t milliseconds = 0;
+
+//Every task which has ever been scheduled; newest first. Tasks stay in the list once they've
+//been added, and are skipped while they're not scheduled; so the list only ever grows at its
+//head, which is safe even while it's being walked.
+static Task * tasks = 0;
+
+
+/*
+ * Ticks the scheduler's clock, once per millisecond.
+ */
+ISR(TIMER0_COMPA_vect)
+{
+  ++milliseconds;
+}
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+/*
+ * @return True iff the given task is scheduled, and due at the given time.
+ */
+static uint8_t is_due(Task * task, uint32_t now)
+{
+  //Subtracting the times, rather than comparing them, keeps this right when the clock wraps around.
+  return task->scheduled && ((int32_t)(now - task->due_at) >= 0);
+}
+
+
+/*
+ * Counts runs of the given task which have missed their deadlines.
+ */
+static void count_missed_deadlines(Task * task, uint32_t missed)
+{
+  if(missed > (uint16_t)(UINT16_MAX - task->missed_deadlines)) {
+    task->missed_deadlines = UINT16_MAX;
+  } else {
+    task->missed_deadlines += missed;
+  }
+}
+
+
+/*
+ * If the given task is due, moves its schedule on to its next run, and notes whether this
+ * one is late.
+ *
+ * @return True iff the task is due, and should be run now.
+ */
+static uint8_t start_run(Task * task, uint32_t now)
+{
+  uint32_t skipped;
+  uint8_t due;
+
+  //The task can be rescheduled from an interrupt, so keep its schedule consistent while we work.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+
+    due = is_due(task, now);
+
+    if(due) {
+      if(task->deadline && (now - task->due_at > task->deadline)) {
+        count_missed_deadlines(task, 1);
+      }
+
+      //Periodic tasks are next due a period after this run was due, so they don't drift;
+      //unless they've fallen a whole period behind, in which case the runs they've missed are skipped.
+      if(task->period) {
+        task->due_at += task->period;
+
+        if(is_due(task, now)) {
+          skipped       = (now - task->due_at) / task->period + 1;
+          task->due_at += skipped * task->period;
+          count_missed_deadlines(task, skipped);
+        }
+      } else {
+        task->scheduled = 0;
+      }
+    }
+  }
+
+  return due;
+}
+
+
+/*
+ * @return True iff any task is due now. Should be called with interrupts disabled.
+ */
+static uint8_t any_task_due()
+{
+  Task * task;
+
+  for(task = tasks; task; task = task->next) {
+    if(is_due(task, milliseconds)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Sets up timer/counter 0 to tick once per millisecond, and starts the scheduler's clock.
+ */
+void start_scheduler(void)
+{
+  //Set up the timer in CTC mode, so it counts up to OCR0A, and then starts again from zero.
+  TCCR0A = _BV(WGM01);
+  OCR0A  = COUNTS_PER_MILLISECOND - 1;
+  TCNT0  = 0;
+
+  //Interrupt on each compare match, and start the timer, with a prescaler of 64.
+  TIMSK0 |= _BV(OCIE0A);
+  TCCR0B  = _BV(CS01) | _BV(CS00);
+}
+
+
+/*
+ * @return The number of milliseconds since start_scheduler was called.
+ */
+uint32_t scheduler_milliseconds(void)
+{
+  uint32_t now;
+
+  //The count is four bytes long, so it could tick between reading one byte and the next.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    now = milliseconds;
+  }
+
+  return now;
+}
+
+
+/*
+ * Schedules a task to run after the given delay.
+ */
+void schedule_task(Task * task, uint16_t delay_ms)
+{
+  Task * known;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    task->due_at    = milliseconds + delay_ms;
+    task->scheduled = 1;
+
+    //Add the task to our list, if it isn't already there.
+    for(known = tasks; known && (known != task); known = known->next);
+
+    if(!known) {
+      task->next = tasks;
+      tasks      = task;
+    }
+  }
+}
+
+
+/*
+ * Stops a task from running, until it's scheduled again.
+ */
+void cancel_task(Task * task)
+{
+  task->scheduled = 0;
+}
+
+
+/*
+ * Runs each task which is due, once.
+ */
+uint8_t run_due_tasks(void)
+{
+  uint32_t now = scheduler_milliseconds();
+  uint8_t count = 0;
+  Task * task;
+
+  for(task = tasks; task; task = task->next) {
+    if(start_run(task, now)) {
+      task->run(task);
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+
+/*
+ * Runs the scheduled tasks, forever.
+ */
+void run_scheduler(void)
+{
+  set_sleep_mode(SLEEP_MODE_IDLE);
+
+  while(1) {
+    run_due_tasks();
+
+    //Sleep until the next interrupt, unless a task has become due while we were running the
+    //others. The check is made with interrupts disabled; and the instruction after sei() always
+    //runs before any interrupt, so nothing can schedule a task between our check and our sleep.
+    cli();
+
+    if(!any_task_due()) {
+      sleep_enable();
+      sei();
+      sleep_cpu();
+      sleep_disable();
+    }
+
+    sei();
+  }
+}
@@ -0,0 +1,134 @@
+/**
+ * EECE 387 Example Code
+ * Cooperative task scheduler.
+ *
+ * Runs a program as a set of short tasks, rather than as one loop which waits ('blocks')
+ * for each thing in turn. Timer/counter 0 ticks once per millisecond; each task is due at
+ * a given tick, and the scheduler runs each task once it's due, sleeping in between. Tasks
+ * are never interrupted by other tasks, so they don't need to protect their data from each
+ * other; but they should return quickly-- rather than waiting for something (e.g. a TWI
+ * transaction, or room in the UART's transmit buffer), a task checks whether it's ready,
+ * and if not, schedules itself to check again later.
+ *
+ *   - Periodic tasks run every period milliseconds. Their schedule doesn't drift: each run
+ *     is due a period after the last one was due, however long the tasks take.
+ *   - Other tasks run once each time they're scheduled, e.g. by another task, or from an
+ *     interrupt, like a TWI transaction's on_complete callback.
+ *   - A task can be given a deadline: the number of milliseconds it may start late. Runs which
+ *     start later than that are counted in the task's missed_deadlines; a periodic task which
+ *     has fallen a whole period behind skips the runs it's missed, rather than running them
+ *     back-to-back to catch up.
+ *
+ * @code
+ *   static void blink(Task * task) { PINB = _BV(PB5); }
+ *   static Task blink_task = TASK(blink, 500, 0);   // every 500ms
+ *
+ *   start_scheduler();
+ *   sei();
+ *   schedule_task(&blink_task, 0);
+ *   run_scheduler();
+ * @endcode
+ *
+ * The scheduler uses timer/counter 0, and provides its compare match A interrupt handler
+ * (TIMER0_COMPA_vect); so programs which use it can't use the timer for anything else.
+ */
+
+#ifndef __TIMER_SCHEDULER_H__
+#define __TIMER_SCHEDULER_H__
+
+#include <inttypes.h>
+
+struct Task_struct;
+
+/**
+ * A function which performs a task. It's passed the task, so it can e.g. reschedule itself.
+ */
+typedef void (*TaskFunction)(struct Task_struct * task);
+
+/**
+ * Describes a task. Should be created with TASK, and must remain valid while it's scheduled
+ * (so it's usually static).
+ */
+struct Task_struct {
+
+  /** The function which performs the task. */
+  TaskFunction run;
+
+  /** The time between the task's runs, in milliseconds; or 0, if it only runs when scheduled. */
+  uint16_t period;
+
+  /** The number of milliseconds the task may start late before it's missed its deadline; or 0 for no deadline. */
+  uint16_t deadline;
+
+  /** The number of runs which have started after their deadline (or been skipped). Stops at its maximum value. */
+  uint16_t missed_deadlines;
+
+  /** The time the task is next due, in scheduler milliseconds. Used internally. */
+  uint32_t due_at;
+
+  /** True iff the task is scheduled to run. Used internally. */
+  volatile uint8_t scheduled;
+
+  /** The next task the scheduler knows about. Used internally. */
+  struct Task_struct * next;
+
+};
+typedef struct Task_struct Task;
+
+/**
+ * Creates a task.
+ *
+ * @param function The function which performs the task.
+ * @param period_ms The time between the task's runs, in milliseconds; or 0, if it only runs when scheduled.
+ * @param deadline_ms The number of milliseconds the task may start late; or 0 for no deadline.
+ */
+#define TASK(function, period_ms, deadline_ms) \
+  { .run = (function), .period = (period_ms), .deadline = (deadline_ms), .missed_deadlines = 0, .due_at = 0, \
+    .scheduled = 0, .next = 0 }
+
+
+/**
+ * Sets up timer/counter 0 to tick once per millisecond, and starts the scheduler's clock.
+ * Interrupts must be enabled (e.g. with sei()) for the clock to run.
+ */
+void start_scheduler(void);
+
+/**
+ * @return The number of milliseconds since start_scheduler was called. Wraps around after
+ *    about 49 days; so compare times by subtracting them, rather than directly.
+ */
+uint32_t scheduler_milliseconds(void);
+
+/**
+ * Schedules a task to run after the given delay. If the task is already scheduled, it's
+ * moved to the new time. Periodic tasks keep running every period from then on.
+ *
+ * This can be called from interrupt handlers; e.g. from a TWI transaction's on_complete callback.
+ *
+ * @param task The task to be scheduled.
+ * @param delay_ms The number of milliseconds until the task is due; 0 to run it as soon as possible.
+ */
+void schedule_task(Task * task, uint16_t delay_ms);
+
+/**
+ * Stops a task from running, until it's scheduled again. A task can cancel itself.
+ *
+ * @param task The task to be cancelled.
+ */
+void cancel_task(Task * task);
+
+/**
+ * Runs each task which is due, once. Useful for running tasks from a program's own loop;
+ * most programs should use run_scheduler instead.
+ *
+ * @return The number of tasks run.
+ */
+uint8_t run_due_tasks(void);
+
+/**
+ * Runs the scheduled tasks, forever. The CPU sleeps (in idle mode) whenever no task is due;
+ * any interrupt (including the scheduler's own tick) wakes it. Never returns.
+ */
+void run_scheduler(void) __attribute__((noreturn));
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * EECE 387 Example Code
+ * Host-side Bus Pirate command compiler.
+ *
+ * Runs on the build machine (not the AVR!), and performs two jobs:
+ *
+ *  - Compiles a file of named bus pirate commands (a ".bp" file) into a C header
+ *    containing pre-compiled programs, stored in program memory. These can be
+ *    executed with execute_bus_pirate_program_P, so the AVR never needs to
+ *    parse-- or even link-- the bus pirate string parser.
+ *
+ *  - Checks the bus pirate command literals in a set of C source files, catching
+ *    mistakes (like a series of reads which ends in "r" rather than "s") at build
+ *    time, rather than as a lock-up on the device.
+ *
+ * Usage:
+ *   bpcompile <commands.bp> <output.h>
+ *   bpcompile --check <source.c> [source.c ...]
+ *
+ * Each non-blank line of a .bp file has the form:
+ *
+ *   name = [ 0x52 0xB4 [ 0x53 rr rr rr rs ]
+ *
+ * Lines starting with '#' are comments.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "../twi/bus_pirate_compiler.h"
+
+/*
+ * The longest line (or string literal) we're willing to handle.
+ */
+#define MAXIMUM_COMMAND_LENGTH 512
+
+/*
+ * Human-readable descriptions of each BusPirateProgramError.
+ */
+static const char * error_descriptions[] = {
+  [BusPirateProgramValid]       = "no error",
+  [BusPirateUnterminatedRead]   = "the last read before a stop or restart must be an 's', not an 'r'; otherwise, the TWI hardware will lock up",
+  [BusPirateReadAfterLastRead]  = "read after an 's'; the device has already been told that no more data is wanted",
+  [BusPirateReadWhileWriting]   = "read in a packet addressed for writing (the address's least significant bit is 0)",
+  [BusPirateWriteWhileReading]  = "write in a packet addressed for reading (the address's least significant bit is 1)",
+  [BusPirateOutsidePacket]      = "read or write outside of a packet; did you forget a '['?",
+  [BusPirateUnterminatedPacket] = "command ends without a stop condition (']'), leaving the bus busy"
+};
+
+
+/*
+ * Compiles and validates a single command, printing a compiler-style diagnostic if it's invalid.
+ *
+ * @param program A buffer of at least 256 bytes, which receives the compiled program.
+ * @return The length of the compiled program, or 0 if the command is invalid.
+ */
+static uint8_t compile_and_check(const char * command, uint8_t * program, const char * filename, int line) {
+
+  uint16_t error_offset;
+  BusPirateProgramError error;
+
+  //Ensure the program will fit into the AVR-side program buffers, which are limited to 255 bytes.
+  if(bus_pirate_program_length(command) > 255) {
+    fprintf(stderr, "%s:%d: error: bus pirate command is too long: \"%s\"\n", filename, line, command);
+    return 0;
+  }
+
+  compile_bus_pirate_twi_command(command, program, 255);
+  error = validate_bus_pirate_program(program, &error_offset);
+
+  if(error != BusPirateProgramValid) {
+    fprintf(stderr, "%s:%d: error: %s: \"%s\"\n", filename, line, error_descriptions[error], command);
+    return 0;
+  }
+
+  return bus_pirate_program_length(command);
+}
+
+
+/*
+ * Compiles a .bp file into a header full of program memory tables.
+ *
+ * @return The number of errors encountered.
+ */
+static int compile_command_file(const char * input_filename, const char * output_filename) {
+
+  char line[MAXIMUM_COMMAND_LENGTH];
+  uint8_t program[256];
+  int line_number = 0, errors = 0;
+
+  FILE * input  = fopen(input_filename, "r");
+  FILE * output;
+
+  if(!input) {
+    perror(input_filename);
+    return 1;
+  }
+
+  //Write into a temporary file, so we never leave a half-written header behind.
+  char temporary_filename[strlen(output_filename) + 5];
+  sprintf(temporary_filename, "%s.tmp", output_filename);
+
+  output = fopen(temporary_filename, "w");
+  if(!output) {
+    perror(temporary_filename);
+    fclose(input);
+    return 1;
+  }
+
+  fprintf(output, "/*\n * Generated from %s by tools/bpcompile. Do not edit!\n */\n\n", input_filename);
+  fprintf(output, "#include <inttypes.h>\n#include <avr/pgmspace.h>\n\n");
+
+  while(fgets(line, sizeof(line), input)) {
+
+    char * name = line, * command, * end;
+    uint8_t length;
+
+    ++line_number;
+
+    //Trim leading and trailing whitespace...
+    while(isspace((unsigned char)*name)) {
+      ++name;
+    }
+    for(end = name + strlen(name); end > name && isspace((unsigned char)end[-1]); --end);
+    *end = '\0';
+
+    //... and skip blank lines and comments.
+    if(!*name || *name == '#') {
+      continue;
+    }
+
+    //Split the line into its name and command.
+    command = strchr(name, '=');
+    if(!command) {
+      fprintf(stderr, "%s:%d: error: expected 'name = command'\n", input_filename, line_number);
+      ++errors;
+      continue;
+    }
+
+    for(end = command; end > name && isspace((unsigned char)end[-1]); --end);
+    *end = '\0';
+
+    for(++command; isspace((unsigned char)*command); ++command);
+
+    //Compile the command, and emit it as a table.
+    length = compile_and_check(command, program, input_filename, line_number);
+    if(!length) {
+      ++errors;
+      continue;
+    }
+
+    fprintf(output, "/* %s */\nstatic const uint8_t %s[] PROGMEM = {", command, name);
+    for(uint8_t i = 0; i < length; ++i) {
+      fprintf(output, "%s0x%02x", i ? ", " : " ", program[i]);
+    }
+    fprintf(output, " };\n\n");
+  }
+
+  fclose(input);
+  fclose(output);
+
+  //Only publish the header if everything compiled.
+  if(errors) {
+    remove(temporary_filename);
+  } else if(rename(temporary_filename, output_filename)) {
+    perror(output_filename);
+    ++errors;
+  }
+
+  return errors;
+}
+
+
+/*
+ * Checks each bus pirate command literal in a C source file. String literals are treated
+ * as bus pirate commands if their first non-whitespace character is a '[' or '{'.
+ *
+ * @return The number of errors encountered.
+ */
+static int check_source_file(const char * filename) {
+
+  char literal[MAXIMUM_COMMAND_LENGTH];
+  uint8_t program[256];
+  int errors = 0, line = 1, c;
+
+  FILE * source = fopen(filename, "r");
+
+  if(!source) {
+    perror(filename);
+    return 1;
+  }
+
+  while((c = fgetc(source)) != EOF) {
+
+    switch(c) {
+
+      case '\n':
+        ++line;
+        break;
+
+      //Skip over comments, so commented-out commands aren't checked.
+      case '/':
+        c = fgetc(source);
+
+        if(c == '/') {
+          while((c = fgetc(source)) != EOF && c != '\n');
+          ++line;
+        }
+        else if(c == '*') {
+          int previous = 0;
+          while((c = fgetc(source)) != EOF && !(previous == '*' && c == '/')) {
+            line += (c == '\n');
+            previous = c;
+          }
+        }
+        else if(c != EOF) {
+          ungetc(c, source);
+        }
+        break;
+
+      //Skip character literals, so '"' isn't mistaken for the start of a string.
+      case '\'':
+        while((c = fgetc(source)) != EOF && c != '\'') {
+          if(c == '\\') {
+            fgetc(source);
+          }
+        }
+        break;
+
+      //Capture string literals, and check any that look like bus pirate commands.
+      case '"':
+        {
+          size_t length = 0;
+          const char * start;
+
+          while((c = fgetc(source)) != EOF && c != '"' && c != '\n') {
+            if(c == '\\') {
+              c = fgetc(source);
+            }
+            if(length < sizeof(literal) - 1) {
+              literal[length++] = c;
+            }
+          }
+          literal[length] = '\0';
+
+          if(c == '\n') {
+            ++line;
+          }
+
+          for(start = literal; isspace((unsigned char)*start); ++start);
+
+          if((*start == '[' || *start == '{') && !compile_and_check(literal, program, filename, line)) {
+            ++errors;
+          }
+        }
+        break;
+    }
+  }
+
+  fclose(source);
+  return errors;
+}
+
+
+int main(int argc, char ** argv) {
+
+  int errors = 0;
+
+  //Check mode: validate the literals in each source file.
+  if(argc >= 2 && !strcmp(argv[1], "--check")) {
+    for(int i = 2; i < argc; ++i) {
+      errors += check_source_file(argv[i]);
+    }
+  }
+  //Compile mode: generate a header from a .bp file.
+  else if(argc == 3) {
+    errors = compile_command_file(argv[1], argv[2]);
+  }
+  else {
+    fprintf(stderr, "usage: %s <commands.bp> <output.h>\n", argv[0]);
+    fprintf(stderr, "       %s --check <source.c> [source.c ...]\n", argv[0]);
+    return 2;
+  }
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * EECE 387 Example Code
+ * Host-side decoder for UART frames.
+ *
+ * Runs on the host machine (not the AVR!), and decodes the frames sent by
+ * send_uart_frame (see uart/frame.h): splits the incoming bytes on zeros,
+ * undoes the COBS encoding, and checks each frame's CRC. Each valid frame's
+ * data is printed as a single line; corrupted frames are reported on stderr.
+ *
+ * Usage:
+ *   framedecode [--words] [input]
+ *
+ * Reads from the given file (e.g. a serial device, such as /dev/ttyACM0), or from
+ * standard input if none is given. By default, each frame is printed as a series of
+ * hex bytes; with --words, it's printed as a series of unsigned 16-bit values (in the
+ * AVR's little-endian byte order), which suits frames of sensor readings.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/*
+ * The largest encoded frame we'll accept: a frame of 255 data bytes, plus its CRC and COBS overhead.
+ */
+#define MAXIMUM_FRAME_LENGTH 300
+
+
+/*
+ * Updates a CRC-CCITT with a single byte. Identical to avr-libc's _crc_ccitt_update,
+ * which is used on the AVR side.
+ */
+static uint16_t crc_ccitt_update(uint16_t crc, uint8_t data) {
+  data ^= crc & 0xFF;
+  data ^= data << 4;
+  return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+
+
+/*
+ * Undoes the COBS encoding of a single frame (without its terminating zero).
+ *
+ * @return The length of the decoded frame, or -1 if the frame is malformed.
+ */
+static int decode_cobs(const uint8_t * encoded, int length, uint8_t * decoded) {
+
+  int position = 0, decoded_length = 0;
+  uint8_t code, i;
+
+  while(position < length) {
+
+    //Each block starts with a code byte, which is never zero...
+    code = encoded[position++];
+    if(!code || (position + code - 1 > length)) {
+      return -1;
+    }
+
+    //... followed by (code - 1) data bytes...
+    for(i = 1; i < code; ++i) {
+      decoded[decoded_length++] = encoded[position++];
+    }
+
+    //... and, unless the block was full, or was the last block, an implied zero.
+    if((code != 0xFF) && (position < length)) {
+      decoded[decoded_length++] = 0;
+    }
+  }
+
+  return decoded_length;
+}
+
+
+/*
+ * Decodes, checks, and prints a single frame.
+ */
+static void handle_frame(const uint8_t * encoded, int length, int print_words, unsigned long frame_number) {
+
+  uint8_t decoded[MAXIMUM_FRAME_LENGTH];
+  uint16_t crc = 0xFFFF;
+  int decoded_length, i;
+
+  //Ignore empty frames; these just mean we saw two zeros in a row, as we do when we
+  //start listening partway through a frame.
+  if(!length) {
+    return;
+  }
+
+  decoded_length = decode_cobs(encoded, length, decoded);
+  if(decoded_length < 2) {
+    fprintf(stderr, "frame %lu: malformed frame; discarding\n", frame_number);
+    return;
+  }
+
+  //Check the CRC, which follows the data, least significant byte first.
+  decoded_length -= 2;
+  for(i = 0; i < decoded_length; ++i) {
+    crc = crc_ccitt_update(crc, decoded[i]);
+  }
+
+  if(crc != (decoded[decoded_length] | (decoded[decoded_length + 1] << 8))) {
+    fprintf(stderr, "frame %lu: CRC mismatch; discarding\n", frame_number);
+    return;
+  }
+
+  //Print the frame's data.
+  if(print_words) {
+    for(i = 0; i + 1 < decoded_length; i += 2) {
+      printf("%s%u", i ? ", " : "", decoded[i] | (decoded[i + 1] << 8));
+    }
+  } else {
+    for(i = 0; i < decoded_length; ++i) {
+      printf("%s%02x", i ? " " : "", decoded[i]);
+    }
+  }
+
+  printf("\n");
+  fflush(stdout);
+}
+
+
+int main(int argc, char ** argv) {
+
+  uint8_t frame[MAXIMUM_FRAME_LENGTH];
+  int length = 0, overflowed = 0, print_words = 0, c;
+  unsigned long frame_number = 0;
+  FILE * input = stdin;
+
+  if((argc > 1) && !strcmp(argv[1], "--words")) {
+    print_words = 1;
+    --argc;
+    ++argv;
+  }
+
+  if(argc > 2) {
+    fprintf(stderr, "usage: framedecode [--words] [input]\n");
+    return 1;
+  }
+
+  if(argc == 2) {
+    input = fopen(argv[1], "rb");
+    if(!input) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+
+  //Collect bytes until we see a zero, which ends the current frame.
+  while((c = fgetc(input)) != EOF) {
+
+    if(c) {
+      if(length < MAXIMUM_FRAME_LENGTH) {
+        frame[length++] = c;
+      } else {
+        overflowed = 1;
+      }
+      continue;
+    }
+
+    if(overflowed) {
+      fprintf(stderr, "frame %lu: frame too long; discarding\n", frame_number);
+    } else {
+      handle_frame(frame, length, print_words, frame_number);
+    }
+
+    frame_number += (length != 0);
+    length = 0;
+    overflowed = 0;
+  }
+
+  return 0;
+}
@@ -0,0 +1,212 @@
+/*
+ * EECE 387 Example Code
+ * Bus Pirate-style command interpreter for the TWI library.
+ *
+ * Commands are handled in two steps: the command string is first compiled
+ * into a compact program of opcodes (see bus_pirate_compiler.c), which is then
+ * executed against the TWI hardware.
+ */
+
+#include "master.h"
+#include "bus_pirate.h"
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Compiles a bus pirate command into a temporary program, and then executes it.
+ *
+ * @param read_count Incremented once for each read performed.
+ */
+static TWIResult perform_bus_pirate_command_from(const char * command, va_list arguments, uint8_t * read_count);
+
+
+/*
+ * Executes a compiled bus pirate program.
+ *
+ * @param in_program_memory True iff the program is stored in program memory, rather than RAM.
+ * @param read_count Incremented once for each read performed.
+ */
+static TWIResult execute_bus_pirate_program_from(const uint8_t * program, uint8_t in_program_memory, va_list arguments, uint8_t * read_count);
+
+
+/*
+ * Fetches a single byte of a compiled program, from either RAM or program memory.
+ */
+static inline uint8_t fetch_program_byte(const uint8_t * address, uint8_t in_program_memory) {
+  return in_program_memory ? pgm_read_byte(address) : *address;
+}
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Performs a given bus pirate command.
+ *
+ * The command is compiled into a temporary program (on the stack), and
+ * then executed. See bus_pirate.h for the supported syntax.
+ *
+ * @param command The bus pirate command, as a null-terminated string.
+ * @param ...     A single uint8_t * for each read command, or a single uint8_t for each write.
+ * @return The number of reads performed.
+ */
+uint8_t perform_bus_pirate_twi_command(const char * command, ...) {
+
+  uint8_t read_count = 0;
+  va_list variadic_arguments;
+
+  va_start(variadic_arguments, command);
+  perform_bus_pirate_command_from(command, variadic_arguments, &read_count);
+  va_end(variadic_arguments);
+
+  return read_count;
+}
+
+
+/*
+ * Performs a given bus pirate command, reporting whether it succeeded.
+ * Otherwise identical to perform_bus_pirate_twi_command.
+ *
+ * @param command The bus pirate command, as a null-terminated string.
+ * @param ...     A single uint8_t * for each read command, or a single uint8_t for each write.
+ * @return TWISuccess if every operation succeeded; or the result of the first operation to fail.
+ */
+TWIResult execute_bus_pirate_twi_command(const char * command, ...) {
+
+  TWIResult result;
+  uint8_t read_count = 0;
+  va_list variadic_arguments;
+
+  va_start(variadic_arguments, command);
+  result = perform_bus_pirate_command_from(command, variadic_arguments, &read_count);
+  va_end(variadic_arguments);
+
+  return result;
+}
+
+
+/*
+ * Executes a compiled bus pirate program, which is stored in RAM.
+ */
+TWIResult execute_bus_pirate_program(const uint8_t * program, ...) {
+
+  TWIResult result;
+  uint8_t read_count = 0;
+  va_list variadic_arguments;
+
+  va_start(variadic_arguments, program);
+  result = execute_bus_pirate_program_from(program, false, variadic_arguments, &read_count);
+  va_end(variadic_arguments);
+
+  return result;
+}
+
+
+/*
+ * Executes a compiled bus pirate program, which is stored in program memory (PROGMEM).
+ */
+TWIResult execute_bus_pirate_program_P(const uint8_t * program, ...) {
+
+  TWIResult result;
+  uint8_t read_count = 0;
+  va_list variadic_arguments;
+
+  va_start(variadic_arguments, program);
+  result = execute_bus_pirate_program_from(program, true, variadic_arguments, &read_count);
+  va_end(variadic_arguments);
+
+  return result;
+}
+
+
+/*
+ * Compiles a bus pirate command into a temporary program (on the stack), and then executes it.
+ *
+ * @param read_count Incremented once for each read performed.
+ */
+static TWIResult perform_bus_pirate_command_from(const char * command, va_list arguments, uint8_t * read_count) {
+
+  //Figure out how much space the compiled program will need...
+  uint16_t program_length = bus_pirate_program_length(command);
+
+  //... compile it into a buffer of exactly that size...
+  uint8_t program[program_length];
+  compile_bus_pirate_twi_command(command, program, program_length);
+
+  //... and execute the program we've just created.
+  return execute_bus_pirate_program_from(program, false, arguments, read_count);
+}
+
+
+/*
+ * Executes a compiled bus pirate program. Execution stops at the first operation
+ * which fails; the packet is then terminated, so the failure costs as little bus time as possible.
+ *
+ * @param in_program_memory True iff the program is stored in program memory, rather than RAM.
+ * @param read_count Incremented once for each read performed.
+ */
+static TWIResult execute_bus_pirate_program_from(const uint8_t * program, uint8_t in_program_memory, va_list arguments, uint8_t * read_count) {
+
+  TWIResult result = TWISuccess;
+  uint8_t opcode;
+  uint8_t * read_target;
+
+  //Execute each opcode in the program, until we reach the end-- or something fails.
+  while(result == TWISuccess) {
+
+    opcode = fetch_program_byte(program++, in_program_memory);
+
+    switch(opcode) {
+
+      case BusPirateEnd:
+        return TWISuccess;
+
+      case BusPirateStart:
+        result = transmit_twi_start_condition();
+        break;
+
+      case BusPirateStop:
+        result = end_twi_packet();
+        break;
+
+      //Send the literal which follows the opcode.
+      case BusPirateWrite:
+        result = transmit_via_twi(fetch_program_byte(program++, in_program_memory));
+        break;
+
+      //Send the next argument.
+      case BusPirateWriteArgument:
+        result = transmit_via_twi(va_arg(arguments, unsigned int));
+        break;
+
+      //Read a byte into the target provided by the next argument, acknowledging it
+      //(for 'r'), or indicating that we expect no further data (for 's').
+      case BusPirateRead:
+      case BusPirateReadLast:
+        read_target = va_arg(arguments, uint8_t *);
+        result = receive_via_twi(read_target, opcode == BusPirateRead ? RequestMore : LastByte);
+
+        if(result == TWISuccess) {
+          ++*read_count;
+        }
+        break;
+
+      case BusPirateDelay:
+        _delay_us(1);
+        break;
+    }
+  }
+
+  //If something failed, there's no point in clocking the rest of the script out to
+  //a device that isn't listening. Release the bus, and report what went wrong.
+  end_twi_packet();
+  return result;
+}
@@ -0,0 +1,131 @@
+/*
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *
+ *  EECE 387 Example Code
+ *  Bus Pirate-style command interpreter for the TWI library.
+ *
+ *  Bus pirate commands can be performed directly from their strings (which are
+ *  parsed each time they're performed), or compiled once into a compact
+ *  "program" of opcodes, which can then be executed as many times as necessary
+ *  without any further parsing. Programs can also be written by hand and
+ *  stored in program memory (PROGMEM), using the BUS_PIRATE_ macros in
+ *  bus_pirate_compiler.h-- or generated at build time by tools/bpcompile.
+ */
+
+#ifndef _TWI_BUS_PIRATE_H__
+#define _TWI_BUS_PIRATE_H__
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <avr/pgmspace.h>
+
+#include "bus_pirate_compiler.h"
+
+/**@{*/
+
+/**
+ * Performs a given bus pirate command.
+ *
+ * Supports the following features:
+ * {}, [], R/r, 0-255, 0b, 0h, &
+ *
+ * See: http://dangerousprototypes.com/bus-pirate-manual/i2c-guide/
+ *
+ * Two additional commands are also implemented:
+ *  s: Reads a single byte, and then responds with a NAK.
+ *  w: Transmits a single byte, provided as an argument. This allows programatic
+ *     control of transmission.
+ *
+ * Important note! You'll need to replace your last "r" with an "s",
+ * or the TWI library will "lock up", as the AVR views the transmission
+ * as being incomplete.
+ *
+ * For each read, a pointer should be provided to a uint8_t target.
+ * For example:
+ *
+ * @code
+ *   uint8_t hello;
+ *   perform_bus_pirate_twi_command("[ 0x72 0x80 0x03 [ 0x73 s ]", &hello);
+ * @endcode
+ *
+ * would read a single byte to the variable hello.
+ *
+ * For each _write_, a (non-pointer) uint8_t should be provided.
+ * For example:
+ *
+ * @code
+ *   perform_bus_pirate_twi_command("[ 0x72 0x80 w ]", 0x55);
+ * @endcode
+ *
+ * would send 0x72 (the address and write bit), then 0x80, and then 0x55.
+ *
+ * The command is re-parsed each time this function is called. If you're going to
+ * perform the same command repeatedly, consider compiling it once with
+ * compile_bus_pirate_twi_command, and then using execute_bus_pirate_program.
+ *
+ * If any operation fails-- for example, if the device doesn't acknowledge its address--
+ * the rest of the command is skipped, and the packet is terminated with a stop condition.
+ * Any targets for reads which weren't performed are left unmodified. To find out why
+ * a command failed, use execute_bus_pirate_twi_command instead.
+ *
+ * @param command The bus pirate command, as a null-terminated string.
+ * @param ...     A single uint8_t * for each read command, or a single uint8_t for each write.
+ * @return The number of reads performed; which is smaller than the number of reads
+ *    in the command if any operation failed.
+ *
+ */
+uint8_t perform_bus_pirate_twi_command(const char * command, ...);
+
+
+/**
+ * Performs a given bus pirate command, reporting whether it succeeded.
+ * Otherwise identical to perform_bus_pirate_twi_command.
+ *
+ * @code
+ *   uint8_t hello;
+ *
+ *   if(execute_bus_pirate_twi_command("[ 0x72 0x80 0x03 [ 0x73 s ]", &hello) != TWISuccess) {
+ *     //... the device isn't responding...
+ *   }
+ * @endcode
+ *
+ * @param command The bus pirate command, as a null-terminated string.
+ * @param ...     A single uint8_t * for each read command, or a single uint8_t for each write.
+ * @return TWISuccess if every operation succeeded; or the result of the first operation to fail.
+ */
+TWIResult execute_bus_pirate_twi_command(const char * command, ...);
+
+
+/**
+ * Executes a compiled bus pirate program, which is stored in RAM.
+ *
+ * @param program The program to be executed, as produced by compile_bus_pirate_twi_command.
+ * @param ...     A single uint8_t * for each read command, or a single uint8_t for each write.
+ * @return TWISuccess if every operation succeeded; or the result of the first operation to fail.
+ */
+TWIResult execute_bus_pirate_program(const uint8_t * program, ...);
+
+
+/**
+ * Executes a compiled bus pirate program, which is stored in program memory (PROGMEM).
+ *
+ * @param program The program to be executed.
+ * @param ...     A single uint8_t * for each read command, or a single uint8_t for each write.
+ * @return TWISuccess if every operation succeeded; or the result of the first operation to fail.
+ */
+TWIResult execute_bus_pirate_program_P(const uint8_t * program, ...);
+
+
+/**@}*/
+#endif
@@ -0,0 +1,336 @@
+/*
+ * EECE 387 Example Code
+ * Bus Pirate command compiler for the TWI library.
+ *
+ * Converts bus pirate command strings into compact programs of opcodes, which
+ * can be executed by bus_pirate.c. This file is intentionally hardware-independent,
+ * so it can be built both for the AVR and for the host machine (see tools/bpcompile.c).
+ */
+
+#include "bus_pirate_compiler.h"
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Compiles a bus pirate command into a program. If the program doesn't fit in
+ * the given buffer, the remainder of the program is discarded.
+ *
+ * @return The length of the complete program, whether or not it fit into the buffer.
+ */
+static uint16_t translate_bus_pirate_command(const char * command, uint8_t * program, uint16_t program_size);
+
+/*
+ * Defines the states a TWI packet can be in, from the perspective of the validator.
+ */
+enum PacketMode_enum {
+  NoPacket,
+  AwaitingAddress,
+  Writing,
+  Reading,
+  UnknownDirection
+};
+typedef enum PacketMode_enum PacketMode;
+
+
+/*
+ * Appends a single byte to a program under construction, if there's room.
+ */
+static inline void append_to_program(uint8_t * program, uint16_t program_size, uint16_t * length, uint8_t value) {
+
+  //Only store the byte if it fits; but always count it, so we know how
+  //much space the program would have needed.
+  if(*length < program_size) {
+    program[*length] = value;
+  }
+
+  ++*length;
+}
+
+
+/*
+ * Returns the numeric value of a digit in the given radix; or 0xFF if
+ * the character isn't a valid digit in that radix.
+ */
+static inline uint8_t digit_value(char digit, uint8_t radix) {
+
+  uint8_t is_lowercase_hex = (digit >= 'a') && (digit <= 'f') && (radix == 16);
+  uint8_t is_uppercase_hex = (digit >= 'A') && (digit <= 'F') && (radix == 16);
+  uint8_t is_decimal_digit = (digit >= '0') && (digit <= '9') && (radix >= 10);
+  uint8_t is_valid_binary  = (digit >= '0') && (digit <= '1') && (radix ==  2);
+
+  //If we have a number format, convert the number to a raw numeric value.
+  if(is_lowercase_hex) {
+    return digit - 'a' + 10;
+  }
+  else if(is_uppercase_hex) {
+    return digit - 'A' + 10;
+  }
+  else if(is_decimal_digit || is_valid_binary) {
+    return digit - '0';
+  }
+
+  //Otherwise, the value is nonsensical.
+  return 0xFF;
+}
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Compiles a bus pirate command into a compact program, which can be performed
+ * repeatedly via execute_bus_pirate_program without re-parsing the command.
+ *
+ * @param command The bus pirate command, as a null-terminated string.
+ * @param program The buffer which will receive the compiled program.
+ * @param program_size The size of the program buffer, in bytes.
+ * @return The length of the compiled program, in bytes; or 0 if the program didn't fit in the provided buffer.
+ */
+uint16_t compile_bus_pirate_twi_command(const char * command, uint8_t * program, uint16_t program_size) {
+
+  uint16_t program_length = translate_bus_pirate_command(command, program, program_size);
+
+  //If the program didn't fit, report failure.
+  if(program_length > program_size) {
+    return 0;
+  }
+
+  return program_length;
+}
+
+
+/*
+ * Determines the size of the program that compile_bus_pirate_twi_command would produce
+ * for the given command.
+ *
+ * @param command The bus pirate command, as a null-terminated string.
+ * @return The length of the compiled program, in bytes.
+ */
+uint16_t bus_pirate_program_length(const char * command) {
+  return translate_bus_pirate_command(command, 0, 0);
+}
+
+
+/*
+ * Checks a compiled bus pirate program for mistakes which would cause it to misbehave
+ * at runtime-- most notably, a series of reads which doesn't end with an "s".
+ *
+ * @param program The program to be checked, stored in RAM.
+ * @param error_offset If non-zero, receives the offset of the opcode at which the problem was found.
+ * @return BusPirateProgramValid, or a description of the first problem found.
+ */
+BusPirateProgramError validate_bus_pirate_program(const uint8_t * program, uint16_t * error_offset) {
+
+  PacketMode mode = NoPacket;
+  BusPirateProgramError error = BusPirateProgramValid;
+
+  //Keeps track of the last read in the current packet: 0 for none, or the read opcode.
+  uint8_t last_read = 0;
+  uint16_t offset;
+
+  //Walk the program, tracking the direction of the current packet.
+  for(offset = 0; error == BusPirateProgramValid; ++offset) {
+
+    uint8_t opcode = program[offset];
+
+    switch(opcode) {
+
+      //A start condition (or stop condition, or the end of the program) ends any reads in progress;
+      //which must have been terminated with an 's'.
+      case BusPirateStart:
+      case BusPirateStop:
+      case BusPirateEnd:
+
+        if(mode == Reading && last_read == BusPirateRead) {
+          error = BusPirateUnterminatedRead;
+          break;
+        }
+
+        //If we've reached the end of the program, make sure we haven't left a packet open.
+        if(opcode == BusPirateEnd) {
+          if(mode != NoPacket) {
+            error = BusPirateUnterminatedPacket;
+            break;
+          }
+
+          return BusPirateProgramValid;
+        }
+
+        mode = (opcode == BusPirateStart) ? AwaitingAddress : NoPacket;
+        last_read = 0;
+        break;
+
+      //The first byte written after a start condition is the device's address,
+      //whose least significant bit determines the direction of the packet.
+      case BusPirateWrite:
+      case BusPirateWriteArgument:
+
+        if(mode == NoPacket) {
+          error = BusPirateOutsidePacket;
+        }
+        else if(mode == Reading) {
+          error = BusPirateWriteWhileReading;
+        }
+        else if(mode == AwaitingAddress) {
+
+          //If we know the address, we know the direction; otherwise, we'll find out later.
+          if(opcode == BusPirateWrite) {
+            mode = (program[offset + 1] & 0x01) ? Reading : Writing;
+          } else {
+            mode = UnknownDirection;
+          }
+        }
+
+        //Skip the literal which follows a write.
+        if(opcode == BusPirateWrite) {
+          ++offset;
+        }
+        break;
+
+      case BusPirateRead:
+      case BusPirateReadLast:
+
+        if(mode == NoPacket) {
+          error = BusPirateOutsidePacket;
+        }
+        else if(mode == Writing || mode == AwaitingAddress) {
+          error = BusPirateReadWhileWriting;
+        }
+        else if(last_read == BusPirateReadLast) {
+          error = BusPirateReadAfterLastRead;
+        }
+
+        //If we're reading, the packet must have been addressed for reading.
+        mode = Reading;
+        last_read = opcode;
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  //Report where we found the problem. (The loop has already moved past the offending opcode.)
+  if(error_offset) {
+    *error_offset = offset - 1;
+  }
+
+  return error;
+}
+
+
+/*
+ * Compiles a bus pirate command into a program. If the program doesn't fit in
+ * the given buffer, the remainder of the program is discarded.
+ *
+ * @return The length of the complete program, whether or not it fit into the buffer.
+ */
+static uint16_t translate_bus_pirate_command(const char * command, uint8_t * program, uint16_t program_size) {
+
+  uint16_t length = 0;
+
+  //Stores the current radix, which is decimal by default.
+  uint8_t radix = 10;
+  uint8_t to_transmit = 0, is_transmission = 0;
+
+  //Process each character in the command, including its terminating null.
+  for(;; ++command) {
+
+    uint8_t numeric_value = digit_value(*command, radix);
+
+    //If we have a piece of a literal, accumulate it.
+    if(numeric_value != 0xFF) {
+
+      //Since we have a valid value to transmit, mark this as a transmission.
+      //This is idempotent, so it doesn't matter if this is run multiple times.
+      is_transmission = 1;
+
+      //Move the existing number over by a single radix place, "making room"
+      //to add the new number to the right, and then add the new value in the vacated spot.
+      to_transmit = (to_transmit * radix) + numeric_value;
+      continue;
+    }
+
+    //If we have an 'x', switch the active radix to hex.
+    if(*command == 'x') {
+      radix = 16;
+      continue;
+    }
+
+    //If we have a 'b', switch the active radix to binary. (In hex, 'b' is a digit, and
+    //was handled above.)
+    if(*command == 'b') {
+      radix = 2;
+      continue;
+    }
+
+    //Any other character ends the literal in progress, if there is one; so
+    //emit the write for that literal before handling the new command.
+    if(is_transmission) {
+      append_to_program(program, program_size, &length, BusPirateWrite);
+      append_to_program(program, program_size, &length, to_transmit);
+    }
+
+    //Reset our state to the default.
+    radix = 10;
+    is_transmission = to_transmit = 0;
+
+    switch(*command) {
+
+      //If we've reached the end of the command, terminate the program.
+      case '\0':
+        append_to_program(program, program_size, &length, BusPirateEnd);
+        return length;
+
+      //If we have an open brace, issue a TWI start condition.
+      case '{':
+      case '[':
+        append_to_program(program, program_size, &length, BusPirateStart);
+        break;
+
+      //If we have a close brace, issue a TWI stop condition.
+      case '}':
+      case ']':
+        append_to_program(program, program_size, &length, BusPirateStop);
+        break;
+
+      //Read a single byte from the TWI device, and then
+      //send an acknowledgement, indicating that we expect further data.
+      case 'r':
+      case 'R':
+        append_to_program(program, program_size, &length, BusPirateRead);
+        break;
+
+      //Read a single byte from the TWI device, and then send a negative
+      //acknowledgement, indicating that we expect no further data.
+      case 's':
+      case 'S':
+        append_to_program(program, program_size, &length, BusPirateReadLast);
+        break;
+
+      // Send a single byte via the TWI interface, which should be
+      // provided as an argument.
+      case 'w':
+      case 'W':
+        append_to_program(program, program_size, &length, BusPirateWriteArgument);
+        break;
+
+      //Delay 1us.
+      case '&':
+        append_to_program(program, program_size, &length, BusPirateDelay);
+        break;
+
+      //Delimiters (and any other nonsensical characters) are skipped.
+      default:
+        break;
+    }
+  }
+}
@@ -0,0 +1,154 @@
+/*
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *
+ *  EECE 387 Example Code
+ *  Bus Pirate command compiler for the TWI library.
+ *
+ *  Converts bus pirate command strings into compact programs of opcodes,
+ *  and checks those programs for common mistakes. This code doesn't touch
+ *  any hardware, so it can also be built for the host machine; this is how
+ *  tools/bpcompile generates pre-compiled programs at build time.
+ */
+
+#ifndef _TWI_BUS_PIRATE_COMPILER_H__
+#define _TWI_BUS_PIRATE_COMPILER_H__
+
+#include <inttypes.h>
+
+/**@{*/
+
+/**
+ * Defines the opcodes which make up a compiled bus pirate program.
+ * Each opcode is a single byte; BusPirateWrite is followed by the byte to be written.
+ */
+enum BusPirateOpcode_enum {
+  BusPirateEnd           = 0x00,
+  BusPirateStart         = 0x01,
+  BusPirateStop          = 0x02,
+  BusPirateWrite         = 0x03,
+  BusPirateWriteArgument = 0x04,
+  BusPirateRead          = 0x05,
+  BusPirateReadLast      = 0x06,
+  BusPirateDelay         = 0x07
+};
+typedef enum BusPirateOpcode_enum BusPirateOpcode;
+
+
+/**
+ * Macros for writing bus pirate programs by hand; e.g.:
+ *
+ * @code
+ *   const uint8_t read_device_id[] PROGMEM = {
+ *     BUS_PIRATE_START, BUS_PIRATE_WRITE(0x72), BUS_PIRATE_WRITE(0x8A),
+ *     BUS_PIRATE_START, BUS_PIRATE_WRITE(0x73), BUS_PIRATE_READ_LAST, BUS_PIRATE_STOP,
+ *     BUS_PIRATE_END
+ *   };
+ * @endcode
+ *
+ * is equivalent to the command "[ 0x72 0x8A [ 0x73 s ]".
+ */
+#define BUS_PIRATE_START           BusPirateStart
+#define BUS_PIRATE_STOP            BusPirateStop
+#define BUS_PIRATE_WRITE(value)    BusPirateWrite, (value)
+#define BUS_PIRATE_WRITE_ARGUMENT  BusPirateWriteArgument
+#define BUS_PIRATE_READ            BusPirateRead
+#define BUS_PIRATE_READ_LAST       BusPirateReadLast
+#define BUS_PIRATE_DELAY           BusPirateDelay
+#define BUS_PIRATE_END             BusPirateEnd
+
+/**
+ * Evaluates to a program buffer size which is always large enough to hold the
+ * compiled form of the given string literal.
+ */
+#define BUS_PIRATE_PROGRAM_SIZE(command_literal) (2 * sizeof(command_literal) - 1)
+
+
+/**
+ * Defines the problems that validate_bus_pirate_program can detect.
+ */
+enum BusPirateProgramError_enum {
+
+  /** The program looks reasonable. */
+  BusPirateProgramValid = 0,
+
+  /** A series of reads ends with an "r" rather than an "s"; this would "lock up" the TWI hardware. */
+  BusPirateUnterminatedRead,
+
+  /** A read follows an "s", after we've already told the device we don't want any more data. */
+  BusPirateReadAfterLastRead,
+
+  /** A read is performed in a packet which was addressed for writing. */
+  BusPirateReadWhileWriting,
+
+  /** A byte is written in a packet which was addressed for reading. */
+  BusPirateWriteWhileReading,
+
+  /** A read or write occurs outside of any packet (i.e. before a start condition). */
+  BusPirateOutsidePacket,
+
+  /** The program ends without a stop condition, leaving the bus busy. */
+  BusPirateUnterminatedPacket
+
+};
+typedef enum BusPirateProgramError_enum BusPirateProgramError;
+
+
+/**
+ * Compiles a bus pirate command (in the format accepted by perform_bus_pirate_twi_command)
+ * into a compact program, which can be performed repeatedly via execute_bus_pirate_program
+ * without re-parsing the command.
+ *
+ * @code
+ *   uint8_t read_channel_zero[BUS_PIRATE_PROGRAM_SIZE("[ 0x72 0xAC [ 0x73 r s ]")];
+ *   compile_bus_pirate_twi_command("[ 0x72 0xAC [ 0x73 r s ]", read_channel_zero, sizeof(read_channel_zero));
+ *
+ *   while(1) {
+ *     execute_bus_pirate_program(read_channel_zero, &low, &high);
+ *   }
+ * @endcode
+ *
+ * @param command The bus pirate command, as a null-terminated string.
+ * @param program The buffer which will receive the compiled program.
+ * @param program_size The size of the program buffer, in bytes.
+ * @return The length of the compiled program, in bytes; or 0 if the program didn't fit in the provided buffer.
+ */
+uint16_t compile_bus_pirate_twi_command(const char * command, uint8_t * program, uint16_t program_size);
+
+
+/**
+ * Determines the size of the program that compile_bus_pirate_twi_command would produce
+ * for the given command.
+ *
+ * @param command The bus pirate command, as a null-terminated string.
+ * @return The length of the compiled program, in bytes.
+ */
+uint16_t bus_pirate_program_length(const char * command);
+
+
+/**
+ * Checks a compiled bus pirate program for mistakes which would cause it to misbehave
+ * at runtime-- most notably, a series of reads which doesn't end with an "s".
+ *
+ * Packets whose address is provided as an argument ("w") can't be fully checked,
+ * as their direction isn't known until runtime.
+ *
+ * @param program The program to be checked, stored in RAM.
+ * @param error_offset If non-zero, receives the offset of the opcode at which the problem was found.
+ * @return BusPirateProgramValid, or a description of the first problem found.
+ */
+BusPirateProgramError validate_bus_pirate_program(const uint8_t * program, uint16_t * error_offset);
+
+
+/**@}*/
+#endif
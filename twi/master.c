@@ -11,13 +11,33 @@
 
 #include "master.h"
 
+#include <avr/interrupt.h>
+#include <util/atomic.h>
 
-/* define CPU frequency in Mhz here if not defined in Makefile */
-#ifndef F_CPU
-  #warning "You've attempted to use the TWI library without specifying a device clock speed (F_CPU). Assuming 8MHz."
-  #define F_CPU 8000000UL
+#if (TWI_TRANSACTION_QUEUE_SIZE & (TWI_TRANSACTION_QUEUE_SIZE - 1)) != 0
+  #error "TWI_TRANSACTION_QUEUE_SIZE must be a power of two."
 #endif
 
+/* 
+ * The GPIO pins which share the TWI hardware's SDA and SCL lines. These are used
+ * to manually clock the bus during bus recovery. The defaults are correct for the
+ * ATmega48/88/168/328 family.
+ */ 
+#ifndef TWI_PORT
+  #define TWI_PORT     PORTC
+  #define TWI_DDR      DDRC
+  #define TWI_PIN      PINC
+  #define TWI_SDA_BIT  PC4
+  #define TWI_SCL_BIT  PC5
+#endif
+
+/*
+ * The approximate number of CPU cycles taken by a single iteration of one of our 
+ * timeout-bounded wait loops; used to convert timeouts into loop counts. This is
+ * kept a power of two, so the conversion is a shift rather than a 32-bit division.
+ */ 
+#define TWI_WAIT_LOOP_CYCLES 8
+
 
 /*
  * -------------------------------------
@@ -33,24 +53,142 @@
  */ 
 static uint8_t raw_twi_write(uint8_t data);
 
+/*
+ * Converts a TWI status value into a TWIResult.
+ *
+ * @param twi_status The status to be converted; typically returned by raw_twi_write.
+ * @param expected, alternate The statuses which indicate that the operation succeeded.
+ * @return TWISuccess if the status matches either expected status; or the status itself otherwise.
+ */ 
+static TWIResult twi_result_from_status(uint8_t twi_status, uint8_t expected, uint8_t alternate);
+
 /*
  * Waits for any active TWI communications to complete.
+ *
+ * @return False if the operation didn't complete in time, in which case the bus has been recovered; true otherwise.
  */  
-static inline void wait_for_twi_operation_to_complete();
+static inline uint8_t wait_for_twi_operation_to_complete();
 
 /*
- * Given a TWI prescaler value, determines the amount of clock periods necessary to
- * reach a given frequency.
+ * Waits for any stop condition currently being sent to complete.
+ *
+ * @return False if the stop condition didn't complete in time, in which case the bus has been recovered; true otherwise.
+ */  
+static inline uint8_t wait_for_stop_condition_to_complete();
+
+/*
+ * Recomputes our timeouts from the current TWI bitrate settings.
  */ 
-static inline uint32_t clock_periods_from_prescaler(uint32_t target_speed, uint32_t prescaler) {
- 
-  //This function solves the following equation for TWBR (the Two Wire Bitrate Register value),
-  //while avoiding floating point math. Solutions are truncated to the nearest integer.
-  //
-  //   target_speed = F_CPU / (16 + 2 * TWBR *(4 ^ prescaler))
-  //
-  //This is useful for computing the a prescalar / TWBR pair that allows a given clock frequency.
-  return (F_CPU / ((2 << (2 * prescaler)) * target_speed)) - (8  >> (prescaler * 2));
+static void update_twi_timeout();
+
+/*
+ * Advances the active asynchronous transaction by a single step. Called each time
+ * the TWI hardware finishes an operation (i.e. from the TWI interrupt).
+ */ 
+static void handle_twi_event();
+
+/*
+ * Waits for all queued asynchronous transactions to complete.
+ */ 
+static void wait_for_twi_transactions_to_finish();
+
+/*
+ * Marks a transaction as finished, and notifies its owner.
+ */ 
+static void complete_twi_transaction(TWITransaction * transaction, TWITransactionState final_state);
+
+/*
+ * Gives up on the active asynchronous transaction, which has stalled; recovers the bus, 
+ * and moves on to the next queued transaction.
+ */ 
+static void abort_active_twi_transaction();
+
+
+/*
+ * Keeps track of the progress made by the TWI hardware while we wait for
+ * asynchronous transactions, so we can tell when the hardware has stalled.
+ */ 
+struct TWIWatchdog_struct {
+  uint8_t last_event_count;
+  uint32_t loops_remaining;
+};
+typedef struct TWIWatchdog_struct TWIWatchdog;
+
+/*
+ * Sets up a watchdog, which will give up on the active transaction if the hardware
+ * doesn't make progress within the current timeout.
+ */ 
+static void start_twi_watchdog(TWIWatchdog * watchdog);
+
+/*
+ * Performs a single iteration of a loop that waits on asynchronous transactions:
+ * advances the transaction manually if interrupts are disabled, and aborts the 
+ * transaction if the hardware has stalled.
+ */ 
+static void service_twi_transactions(TWIWatchdog * watchdog);
+
+
+/*
+ * The number of wait-loop iterations we'll wait for a single TWI operation to complete
+ * before giving up. Computed from the bitrate by update_twi_timeout; until then, we
+ * assume a 100kHz bus.
+ */ 
+static uint32_t twi_timeout_loops = ((F_CPU / 100000UL) * 9UL * TWI_TIMEOUT_BYTE_TIMES) / TWI_WAIT_LOOP_CYCLES;
+
+/*
+ * Incremented each time the TWI hardware finishes an operation on behalf of an
+ * asynchronous transaction; used to detect stalled transactions.
+ */ 
+static volatile uint8_t twi_event_count = 0;
+
+/*
+ * Sends a stop condition, and marks the active asynchronous transaction as finished.
+ * If another transaction is queued, it's started immediately.
+ */ 
+static void finish_twi_transaction(TWITransactionState final_state);
+
+/*
+ * Removes the next transaction from the transaction queue, and makes it the active
+ * transaction; then applies the given TWI control bits, adding a start condition if 
+ * a transaction was waiting.
+ */ 
+static void begin_next_twi_transaction(uint8_t control_bits);
+
+
+/*
+ * The asynchronous transaction currently being performed, or 0 if the TWI
+ * hardware isn't currently being driven by the TWI interrupt.
+ */ 
+static TWITransaction * volatile active_transaction = 0;
+
+/*
+ * True iff the active transaction has moved into its read phase.
+ */ 
+static volatile uint8_t active_transaction_is_reading = 0;
+
+/*
+ * A ring of transactions waiting to be run, once the active transaction is complete.
+ * The oldest transaction is located at transaction_queue_head.
+ */ 
+static TWITransaction * volatile transaction_queue[TWI_TRANSACTION_QUEUE_SIZE];
+static volatile uint8_t transaction_queue_head  = 0;
+static volatile uint8_t transaction_queue_count = 0;
+
+/*
+ * Converts a TWI status value into a TWIResult.
+ */ 
+static TWIResult twi_result_from_status(uint8_t twi_status, uint8_t expected, uint8_t alternate) {
+
+  if((twi_status == expected) || (twi_status == alternate)) {
+    return TWISuccess;
+  }
+
+  //The hardware reports a bus error as status zero, which would otherwise read as success.
+  if(twi_status == TW_BUS_ERROR) {
+    return TWIBusError;
+  }
+
+  return (TWIResult)twi_status;
 }
 
 
@@ -66,42 +204,102 @@ static inline uint32_t clock_periods_from_prescaler(uint32_t target_speed, uint3
  * method need only be called once.
  *
  * @brief Sets up the TWI hardware interface.
- * @param twi_clock_Speed The clock speed for the TWI interface, in Hz. 
- *    You must ensure that ((F_CPU / TWI_CLOCk_SPEED) - 16)/ 2 is less than 256, or this function won't work!
- * @return none
+ * @param twi_bitrate The clock speed for the TWI interface, in Hz. 
+ * @return The bitrate actually achieved, in Hz; or 0 if the requested bitrate can't be reached.
  */ 
-void set_up_twi_hardware(uint32_t twi_bitrate)
+uint32_t set_up_twi_hardware(uint32_t twi_bitrate)
 {
+  //Compute an appropriate Two Wire prescaler and Two Wire Bitrate Register (TWBR) value,
+  //which together determine the TWI clock speed. See compute_twi_clock_settings for details.
+  TWIClockSettings settings = compute_twi_clock_settings(twi_bitrate);
 
-  uint8_t  prescaler = -1;
-  uint32_t clock_periods;
+  //If we can't reach the requested bitrate, leave the hardware alone.
+  if(!settings.bitrate) {
+    return 0;
+  }
+
+  configure_twi_clock(settings.prescaler, settings.bitrate_register);
+  return settings.bitrate;
+}
 
-  //Compute an appropriate Two Wire prescaler value, which will
-  //determine the rate of the main TWI clock speed.
-  //
-  //The TWI clock speed is defined as follows:
-  //
-  // F_CPU /(16 + 2 * TWBR *(4 ^ prescaler))
-  //
-  // Due to hardware register sizes, two condition have to be met:
-  //  1) The prescaler has to be less than four, as to fit in a two-bit register; and
-  //  2) The "constant" TWBR must be between 0-255, inclusive.
-  //
-  //  We'll iterate through prescaler values until we find one that allows us to satisfy condition #2.
-  //  
-  do {
-    prescaler += 1;
-    clock_periods = clock_periods_from_prescaler(twi_bitrate, prescaler); 
-  } 
-  while(clock_periods > 255 && prescaler < 3);
 
-  //Apply the prescaler we've found.
-  TWSR &= ~0x03;
-  TWSR |= prescaler;
+/*
+ * Applies a given prescaler / TWBR pair to the TWI hardware.
+ *
+ * @param prescaler The prescaler setting (TWPS), from 0-3.
+ * @param bitrate_register The Two Wire Bitrate Register (TWBR) value.
+ */ 
+void configure_twi_clock(uint8_t prescaler, uint8_t bitrate_register)
+{
+  //Apply the prescaler...
+  TWSR = (TWSR & ~0x03) | (prescaler & 0x03);
 
-  //... and apply the Two Wire Bitrate Register (TWBR) value that we've determined.
-  TWBR = clock_periods;
+  //... and the Two Wire Bitrate Register (TWBR) value.
+  TWBR = bitrate_register;
 
+  //Finally, adjust our timeouts to match the new bitrate.
+  update_twi_timeout();
+}
+
+
+/*
+ * Attempts to free a TWI bus which has become stuck-- typically, because a device was
+ * interrupted mid-transfer, and is holding SDA low waiting for clock pulses that will 
+ * never come. This is called automatically whenever a TWI operation times out.
+ */ 
+void recover_twi_bus()
+{
+  uint8_t i, saved_port_bits;
+
+  //Disable the TWI hardware, which returns control of the SDA and SCL pins to us.
+  //This also aborts any operation in progress, and disables the TWI interrupt.
+  TWCR = 0;
+
+  //Release both lines. We'll emulate an open-drain output: a line is driven low
+  //by making it an output (with its PORT bit cleared), and released-- and pulled up 
+  //by the bus's pull-up resistors-- by making it an input.
+  saved_port_bits = TWI_PORT & ((1 << TWI_SDA_BIT) | (1 << TWI_SCL_BIT));
+  TWI_PORT &= ~((1 << TWI_SDA_BIT) | (1 << TWI_SCL_BIT));
+  TWI_DDR  &= ~((1 << TWI_SDA_BIT) | (1 << TWI_SCL_BIT));
+  _delay_us(5);
+
+  //Clock SCL up to nine times, until the device lets go of SDA. Nine clocks are
+  //enough to finish any byte (and its acknowledge bit) a device could be sending.
+  for(i = 0; (i < 9) && bit_is_clear(TWI_PIN, TWI_SDA_BIT); ++i) {
+    TWI_DDR |= (1 << TWI_SCL_BIT);
+    _delay_us(5);
+    TWI_DDR &= ~(1 << TWI_SCL_BIT);
+    _delay_us(5);
+  }
+
+  //Generate a stop condition (SDA rising while SCL is high), which returns all 
+  //devices on the bus to their idle state.
+  TWI_DDR |= (1 << TWI_SDA_BIT);
+  _delay_us(5);
+  TWI_DDR &= ~(1 << TWI_SDA_BIT);
+  _delay_us(5);
+
+  //Restore any pull-ups the user had enabled, and hand the lines back to the TWI hardware.
+  TWI_PORT |= saved_port_bits;
+  TWCR = (1 << TWEN);
+}
+
+
+/*
+ * Recomputes our timeouts from the current TWI bitrate settings.
+ */ 
+static void update_twi_timeout()
+{
+  //Determine the length of a single SCL period, in CPU cycles. From the datasheet:
+  //
+  //  SCL period = 16 + 2 * TWBR * (4 ^ prescaler)
+  //
+  uint32_t scl_period = 16 + ((uint32_t)TWBR << (1 + 2 * (TWSR & 0x03)));
+
+  //Every TWI operation (a byte and its acknowledge bit, or a start condition) takes 
+  //at most nine SCL periods. We'll allow TWI_TIMEOUT_BYTE_TIMES of those, to give
+  //devices some leeway to stretch the clock.
+  twi_timeout_loops = (scl_period * 9 * TWI_TIMEOUT_BYTE_TIMES) / TWI_WAIT_LOOP_CYCLES;
 }
 
 /*
@@ -109,11 +307,11 @@ void set_up_twi_hardware(uint32_t twi_bitrate)
  * (This transmits a start bit, an address bit, and a direction bit.)
  *
  * @param address The device's TWI address.
- * @retval 0 Returned if we can't communicate with the given device; e.g. if the device doesn't acknowledge communications.
+ * @retval 0 Returned if we can't communicate with the given device.
  * @retval 1 Returned on success.
  */ 
 uint8_t start_twi_read_from(uint8_t address) {
-  return start_twi_communication(address, Read);
+  return begin_twi_read_from(address) == TWISuccess;
 }
 
 /*
@@ -121,20 +319,65 @@ uint8_t start_twi_read_from(uint8_t address) {
  * (This transmits a start bit, an address bit, and a direction bit.)
  *
  * @param address The device's TWI address.
- * @retval 0 Returned if we can't communicate with the given device; e.g. if the device doesn't acknowledge communications.
+ * @retval 0 Returned if we can't communicate with the given device.
  * @retval 1 Returned on success.
  */ 
 uint8_t start_twi_write_to(uint8_t address) {
-  return start_twi_communication(address, Write);
+  return begin_twi_write_to(address) == TWISuccess;
+}
+
+/*
+ * Begins an TWI communication to a given address in either read or write mode.
+ *
+ * @param address The device's TWI address.
+ * @param direction The communication direction for the given TWI device. Should be either TWI_READ or TWI_WRITE.
+ * @retval 0 Returned if we can't communicate with the given device.
+ * @retval 1 Returned on success.
+ */
+uint8_t start_twi_communication(uint8_t address, TWIDataDirection direction) {
+  return begin_twi_communication(address, direction) == TWISuccess;
 }
 
 /*
  * Sends a TWI start condition.
- * 
- * @retval 0 Returned if we can't communicate with the given device; e.g. if the device doesn't acknowledge communications.
+ *
+ * @retval 0 Returned if we couldn't gain control of the bus.
  * @retval 1 Returned on success.
  */ 
 uint8_t send_twi_start_condition() {
+  return transmit_twi_start_condition() == TWISuccess;
+}
+
+/*
+ * Begins a TWI packet intended to read from the provided address; or sends a repeated start condition.
+ *
+ * @param address The device's TWI address.
+ * @return TWISuccess on success; or the reason we can't communicate with the device.
+ */ 
+TWIResult begin_twi_read_from(uint8_t address) {
+  return begin_twi_communication(address, Read);
+}
+
+/*
+ * Begins a TWI packet intended to write to the provided address; or sends a repeated start condition.
+ *
+ * @param address The device's TWI address.
+ * @return TWISuccess on success; or the reason we can't communicate with the device.
+ */ 
+TWIResult begin_twi_write_to(uint8_t address) {
+  return begin_twi_communication(address, Write);
+}
+
+/*
+ * Sends a TWI start condition, reporting why it failed.
+ * 
+ * @return TWISuccess on success; or the reason we couldn't gain control of the bus.
+ */ 
+TWIResult transmit_twi_start_condition() {
+
+  //If a background transaction currently owns the TWI hardware, wait for it to finish
+  //before starting our own packet.
+  wait_for_twi_transactions_to_finish();
 
   //Start the TWI connection.
   // The following Two Wire Control Register bits are set:
@@ -144,12 +387,14 @@ uint8_t send_twi_start_condition() {
   //         Confusingly enough, writing a '1' to this bit clears it.
 	TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
 
-  wait_for_twi_operation_to_complete();
+  if(!wait_for_twi_operation_to_complete()) {
+    return TWITimedOut;
+  }
 
 	//Check to see if we were succesfully able to gain control of the bus,
   //indicated by the most significant five bits of the TW_STATUS register.
   uint8_t two_wire_status = TW_STATUS & 0xF8;
-	return (two_wire_status == TW_START) || (two_wire_status == TW_REP_START);
+	return twi_result_from_status(two_wire_status, TW_START, TW_REP_START);
 }
 
 
@@ -157,29 +402,29 @@ uint8_t send_twi_start_condition() {
  * Begins an TWI communication to a given address in either read or write mode.
  * Sends a start bit, the target address, and a driection bit.
  *
- * You may prefer to use start_twi_read_from / start_twi_write_to.
+ * You may prefer to use begin_twi_read_from / begin_twi_write_to.
  * 
  * @param address The device's TWI address.
  * @param direction The communication direction for the given TWI device. Should be either TWI_READ or TWI_WRITE.
- * @retval 0 Returned if we can't communicate with the given device; e.g. if the device doesn't acknowledge communications.
- * @retval 1 Returned on success.
+ * @return TWISuccess on success; or the reason we can't communicate with the device.
  */
-uint8_t start_twi_communication(uint8_t address, TWIDataDirection direction)
+TWIResult begin_twi_communication(uint8_t address, TWIDataDirection direction)
 {
   uint8_t twi_status;
 
   //Attempt to send a start condition. 
-  //If we fail to take control of the bus, return false.
-  if(!send_twi_start_condition()) {
-    return false;
+  //If we fail to take control of the bus, report why.
+  TWIResult result = transmit_twi_start_condition();
+  if(result != TWISuccess) {
+    return result;
   }
 
   //Send the TWI device address and the data direction bit.
   twi_status = raw_twi_write(address << 1 | direction);
 
-  //Return true if the resultant status indicatied that the Master Transmitted, SLAve ACKnowledged,
+  //We've succeeded if the resultant status indicatied that the Master Transmitted, SLAve ACKnowledged,
   //or if the status wwas Master Read, SLAve ACKnowledged.
-	return (twi_status == TW_MT_SLA_ACK) || (twi_status == TW_MR_SLA_ACK);
+	return twi_result_from_status(twi_status, TW_MT_SLA_ACK, TW_MR_SLA_ACK);
 }
 
 
@@ -187,7 +432,8 @@ uint8_t start_twi_communication(uint8_t address, TWIDataDirection direction)
  * Performs a simple TWI write, and then returns the resultant status.
  *
  * @param data The byte of data to be transmitted...A
- * @return The TWI status value, which can be compared to the constants in <util/twi.h>.
+ * @return The TWI status value, which can be compared to the constants in <util/twi.h>;
+ *    or TWI_STATUS_TIMEOUT if the write didn't complete in time.
  */ 
 static uint8_t raw_twi_write(uint8_t data) {
 
@@ -202,7 +448,9 @@ static uint8_t raw_twi_write(uint8_t data) {
   //         Confusingly enough, writing a '1' to this bit clears it.
 	TWCR = (1 << TWINT) | (1 << TWEN);
 
-  wait_for_twi_operation_to_complete();
+  if(!wait_for_twi_operation_to_complete()) {
+    return TWI_STATUS_TIMEOUT;
+  }
 
 	// check value of TWI Status Register. Mask prescaler bits.
 	return TW_STATUS & 0xF8;
@@ -212,11 +460,47 @@ static uint8_t raw_twi_write(uint8_t data) {
 
 /*
  * Waits for any active TWI communications to complete.
+ *
+ * @return False if the operation didn't complete in time, in which case the bus has been recovered; true otherwise.
  */  
-static inline void wait_for_twi_operation_to_complete() {
+static inline uint8_t wait_for_twi_operation_to_complete() {
+
+  uint32_t loops_remaining = twi_timeout_loops;
+
 	//Wait for the current operation to be finished, as indicated by the
   //Two Wire INTerrupt flag being set to '1'.
-  while(!(TWCR & (1 << TWINT)));
+  while(!(TWCR & (1 << TWINT))) {
+
+    //If the operation is taking far longer than it should, something (likely a 
+    //misbehaving device) has stalled the bus. Give up, and try to free the bus.
+    if(!--loops_remaining) {
+      recover_twi_bus();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+/*
+ * Waits for any stop condition currently being sent to complete.
+ *
+ * @return False if the stop condition didn't complete in time, in which case the bus has been recovered; true otherwise.
+ */  
+static inline uint8_t wait_for_stop_condition_to_complete() {
+
+  uint32_t loops_remaining = twi_timeout_loops;
+
+  //Wait until we're no longer sending a Two Wire STOp condition.
+  while(TWCR & (1 << TWSTO)) {
+    if(!--loops_remaining) {
+      recover_twi_bus();
+      return false;
+    }
+  }
+
+  return true;
 }
 
 
@@ -247,7 +531,7 @@ void ensure_twi_communication(uint8_t address, TWIDataDirection direction)
       //(Master Transmit, SLAve Negative ACKnowledgement OR 
       // Master Receive, SLAve Negative ACKnowledgement), 
       // release the bus, and wait for the device to be ready.
-    	if((twi_status == TW_MT_SLA_NACK ) || (twi_status == TW_MR_DATA_NACK)) {    	    
+    	if((twi_status == TW_MT_SLA_NACK ) || (twi_status == TW_MR_SLA_NACK)) {    	    
         //Abort the current TWI packet, and wait for the device to report that it's ready.
         end_twi_packet();     
     	}
@@ -261,8 +545,10 @@ void ensure_twi_communication(uint8_t address, TWIDataDirection direction)
 
 /* 
  * Terminates TWI communication with the given bus. 
+ *
+ * @return TWISuccess on success; or TWITimedOut if the stop condition couldn't be sent in time.
  */
-void end_twi_packet()
+TWIResult end_twi_packet()
 {
   //Terminate the active TWI packet by sending a stop condition.
   // The following Two Wire Control Register bits are set:
@@ -273,23 +559,40 @@ void end_twi_packet()
   TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
   
   //Wait until we're no longer sending a Two Wire STOp condition.
-  while(TWCR & (1 << TWSTO));
+  return wait_for_stop_condition_to_complete() ? TWISuccess : TWITimedOut;
 }
 
 
 /*
- * Sends a single byte via the TWI interface.
+ * Sends a single byte via the TWI interface; either a device's address, or data.
  *
- * @param data The data to be transmitted via SPI.
- * @return data True iff the sent data is succesfully acknolwedged by a device.
+ * @param data The data to be transmitted via TWI.
+ * @return True iff the sent data is succesfully acknowledged by a device.
  */ 
 uint8_t send_via_twi(uint8_t data)
+{
+  return transmit_via_twi(data) == TWISuccess;
+}
+
+
+/*
+ * Sends a single byte via the TWI interface, reporting whether it was accepted.
+ *
+ * @param data The data to be transmitted via TWI.
+ * @return TWISuccess if the byte was acknowledged by a device; or the reason it wasn't.
+ */ 
+TWIResult transmit_via_twi(uint8_t data)
 {	
   //Write the given byte to the TWI interface...
   uint8_t twi_status = raw_twi_write(data);
 
-  //... and return true if we've recieved a Master Transmit DATA ACknowledgement.
-	return (twi_status == TW_MT_DATA_ACK);
+  //... and succeed if we've recieved a Master Transmit DATA ACknowledgement. An address
+  //sent directly after a start condition is instead acknowledged with a SLAve ACKnowledgement.
+  if(twi_status == TW_MT_SLA_ACK) {
+    return TWISuccess;
+  }
+
+	return twi_result_from_status(twi_status, TW_MT_DATA_ACK, TW_MR_SLA_ACK);
 }
 
 
@@ -298,9 +601,26 @@ uint8_t send_via_twi(uint8_t data)
  *
  * @param read_mode Specifies the read mode for the given TWI communication, 
  *    which in turn specifies whether an additional byte is requested.
- * @return The byte read via TWI.
+ * @return The byte read via TWI; or 0xFF (the value of an idle bus) if the read timed out.
  */
 uint8_t read_via_twi(TWIReadMode read_mode)
+{
+  uint8_t data = 0xFF;
+
+  receive_via_twi(&data, read_mode);
+  return data;
+}
+
+
+/*
+ * Reads a single byte via TWI, reporting whether the read succeeded.
+ *
+ * @param data The location which will receive the byte read. Left unmodified if the read fails.
+ * @param read_mode Specifies the read mode for the given TWI communication, 
+ *    which in turn specifies whether an additional byte is requested.
+ * @return TWISuccess on success; or the reason the read failed.
+ */
+TWIResult receive_via_twi(uint8_t * data, TWIReadMode read_mode)
 {
     //Ininitate a TWI read.
     // The following Two Wire Control Register bits are set:
@@ -311,199 +631,541 @@ uint8_t read_via_twi(TWIReadMode read_mode)
     //
     //The lack of any other instruction (e.g. TWSTA) indicates that we're reading.
     TWCR = (1 << TWINT) | (1 << TWEN) | (read_mode << TWEA);
-    wait_for_twi_operation_to_complete();
 
-    return TWDR;
+    if(!wait_for_twi_operation_to_complete()) {
+      return TWITimedOut;
+    }
+
+    //We expect to have received data, and to have responded as the read mode requested:
+    //with a DATA ACKnowledgement if we asked for more, or a DATA Negative ACKnowledgement if not.
+    uint8_t expected_status = (read_mode == RequestMore) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK;
+    TWIResult result = twi_result_from_status(TW_STATUS & 0xF8, expected_status, expected_status);
+
+    if(result == TWISuccess) {
+      *data = TWDR;
+    }
+
+    return result;
 }
 
 /*
- * Performs a given bus pirate command.
- *
- * Supports the following features:
- * {}, [], R/r, 0-255, 0b, 0h, &
- *
- * See: http://dangerousprototypes.com/bus-pirate-manual/i2c-guide/ 
+ * Sends a block of bytes via the TWI interface. Transmission stops early if any 
+ * byte isn't acknowledged.
  *
- * Two additional commands are also implemented:
- *  s: Reads a single byte, and then responds with a NAK.
- *  w: Transmits a single byte, provided as an argument. This allows programatic 
- *     control of transmission.
- *
- * Important note! You'll need to replace your last "r" with an "s",
- * or the TWI library will "lock up", as the AVR views the transmission
- * as being incomplete.
+ * @param data The data to be transmitted.
+ * @param length The number of bytes to be transmitted.
+ * @return TWISuccess on success; or the reason a byte wasn't accepted.
+ */ 
+TWIResult write_block_via_twi(const uint8_t * data, uint8_t length)
+{
+  uint8_t twi_status;
+
+  while(length--) {
+
+    //If the device doesn't acknowledge a byte, there's no point in sending the rest.
+    twi_status = raw_twi_write(*data++);
+    if(twi_status != TW_MT_DATA_ACK) {
+      return twi_result_from_status(twi_status, TW_MT_DATA_ACK, TW_MT_DATA_ACK);
+    }
+  }
+
+  return TWISuccess;
+}
+
+
+/*
+ * Reads a block of bytes via TWI. Every byte but the last is acknowledged,
+ * requesting more data; the last is not, indicating that we're done.
  *
- * For each read, a pointer should be provided to a uint8_t target.
- * For example:
+ * @param buffer The buffer which will receive the data.
+ * @param length The number of bytes to be read.
+ * @return TWISuccess on success; or TWITimedOut if the read timed out.
+ */ 
+TWIResult read_block_via_twi(uint8_t * buffer, uint8_t length)
+{
+  uint8_t data;
+
+  //Precompute the two Two Wire Control Register values we'll be using:
+  //one which acknowledges the received byte (TWEA), requesting more; and one which
+  //doesn't, indicating we want no further data. See read_via_twi for details.
+  const uint8_t request_more = (1 << TWINT) | (1 << TWEN) | (1 << TWEA);
+  const uint8_t last_byte    = (1 << TWINT) | (1 << TWEN);
+
+  if(!length) {
+    return TWISuccess;
+  }
+
+  //Request the first byte.
+  TWCR = (length > 1) ? request_more : last_byte;
+
+  while(1) {
+    if(!wait_for_twi_operation_to_complete()) {
+      return TWITimedOut;
+    }
+
+    //Grab the byte we've just received. We have to do this before touching TWCR again, 
+    //as the next byte is shifted directly into TWDR.
+    data = TWDR;
+
+    //If that was the last byte, we're done.
+    if(!--length) {
+      *buffer = data;
+      return TWISuccess;
+    }
+
+    //Otherwise, immediately request the next byte, and only then store the current one;
+    //this keeps the bus busy while we're working.
+    TWCR = (length > 1) ? request_more : last_byte;
+    *buffer++ = data;
+  }
+}
+
+
+/*
+ * Writes a block of data to a device's registers, in a single packet:
+ * a start condition, the device's address, the register address, the data, 
+ * and a stop condition.
  *
- * @code
- *   uint8_t hello;
- *   perform_bus_pirate_twi_command("[ 0x72 0x80 0x03 [ 0x73 s ]", &hello);
- * @endcode
+ * @param address The device's TWI address.
+ * @param register_command The register address to write to, including any command bits 
+ *    the device requires (e.g. an auto-increment bit).
+ * @param data The data to be written.
+ * @param length The number of bytes to be written.
+ * @return TWISuccess on success; or the result of the first operation to fail.
+ */ 
+TWIResult write_twi_register_block(uint8_t address, uint8_t register_command, const uint8_t * data, uint8_t length)
+{
+  //Perform each step in turn, stopping as soon as one fails.
+  TWIResult result = begin_twi_write_to(address);
+
+  if(result == TWISuccess) {
+    result = transmit_via_twi(register_command);
+  }
+  if(result == TWISuccess) {
+    result = write_block_via_twi(data, length);
+  }
+
+  //Always release the bus, even if we weren't successful.
+  end_twi_packet();
+  return result;
+}
+
+
+/*
+ * Reads a block of data from a device's registers, in a single packet: 
+ * writes the register address, and then uses a repeated start to burst-read 
+ * the given number of bytes. 
  *
- * would read a single byte to the variable hello.
+ * @param address The device's TWI address.
+ * @param register_command The register address to read from, including any command bits 
+ *    the device requires (e.g. an auto-increment bit).
+ * @param buffer The buffer which will receive the data.
+ * @param length The number of bytes to be read.
+ * @return TWISuccess on success; or the result of the first operation to fail.
+ */ 
+TWIResult read_twi_register_block(uint8_t address, uint8_t register_command, uint8_t * buffer, uint8_t length)
+{
+  //Perform each step in turn, stopping as soon as one fails.
+  TWIResult result = begin_twi_write_to(address);
+
+  if(result == TWISuccess) {
+    result = transmit_via_twi(register_command);
+  }
+  if(result == TWISuccess) {
+    result = begin_twi_read_from(address);
+  }
+  if(result == TWISuccess) {
+    result = read_block_via_twi(buffer, length);
+  }
+
+  //Always release the bus, even if we weren't successful.
+  end_twi_packet();
+  return result;
+}
+
+
+/*
+ * Queues an asynchronous TWI transaction, which will be run in the background
+ * by the TWI interrupt as soon as any previously queued transactions are complete. 
  *
- * For each _write_, a (non-pointer) uint8_t should be provided.
- * For example:
+ * @param transaction The transaction to be performed.
+ * @retval 0 Returned if the transaction queue is full.
+ * @retval 1 Returned if the transaction was queued.
+ */ 
+uint8_t enqueue_twi_transaction(TWITransaction * transaction)
+{
+  uint8_t queued = false;
+
+  //The TWI interrupt also manipulates the queue, so we'll need to keep it from
+  //firing while we work.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+
+    //If we have room in the queue, add the transaction to its tail.
+    if(transaction_queue_count < TWI_TRANSACTION_QUEUE_SIZE) {
+
+      uint8_t tail = (transaction_queue_head + transaction_queue_count) & (TWI_TRANSACTION_QUEUE_SIZE - 1);
+
+      transaction->state = TransactionQueued;
+      transaction_queue[tail] = transaction;
+      ++transaction_queue_count;
+      queued = true;
+
+      //If the TWI hardware is idle, nothing else will start this transaction,
+      //so we'll need to kick it off ourselves. First, we'll wait for the stop 
+      //condition from any previous packet to go out.
+      if(!active_transaction) {
+        wait_for_stop_condition_to_complete();
+        begin_next_twi_transaction(0);
+      }
+    }
+  }
+
+  return queued;
+}
+
+
+/*
+ * Begins an asynchronous TWI transaction. Equivalent to enqueue_twi_transaction.
  *
- * @code
- *   perform_bus_pirate_twi_command("[ 0x72 0x80 w ]", 0x55);
- * @endcode 
+ * @param transaction The transaction to be performed.
+ * @retval 0 Returned if the transaction queue is full.
+ * @retval 1 Returned if the transaction was queued.
+ */ 
+uint8_t start_twi_transaction(TWITransaction * transaction)
+{
+  return enqueue_twi_transaction(transaction);
+}
+
+
+/*
+ * Checks to see if a queued transaction has finished, successfully or otherwise.
  *
- * would send 0x72 (the address and write bit), then 0x80, and then 0x55.
+ * @param transaction The transaction to check on.
+ * @return True iff the transaction is complete or has failed.
+ */ 
+uint8_t twi_transaction_finished(TWITransaction * transaction)
+{
+  return (transaction->state == TransactionComplete) || (transaction->state == TransactionFailed);
+}
+
+
+/*
+ * Waits ('blocks') until a queued transaction has finished.
+ * This works whether or not interrupts are enabled.
  *
+ * @param transaction The transaction to wait for.
+ * @return The transaction's result; see twi_transaction_result.
+ */ 
+TWIResult wait_for_twi_transaction(TWITransaction * transaction)
+{
+  TWIWatchdog watchdog;
+  start_twi_watchdog(&watchdog);
+
+  while(!twi_transaction_finished(transaction)) {
+    service_twi_transactions(&watchdog);
+  }
+
+  return twi_transaction_result(transaction);
+}
+
+
+/*
+ * Performs a TWI transaction, waiting ('blocking') until it's complete.
+ * This works whether or not interrupts are enabled.
  *
- * @param command The bus pirate command, as a null-terminated string.
- * @param ...     A single uint8_t * for each read command, or a single uint8_t for each write.
+ * @param transaction The transaction to be performed.
+ * @return The transaction's result; see twi_transaction_result.
+ */ 
+TWIResult perform_twi_transaction(TWITransaction * transaction)
+{
+  TWIWatchdog watchdog;
+  start_twi_watchdog(&watchdog);
+
+  //Wait until there's room in the queue for our transaction...
+  while(!enqueue_twi_transaction(transaction)) {
+    service_twi_transactions(&watchdog);
+  }
+
+  //... and then wait for it to finish.
+  return wait_for_twi_transaction(transaction);
+}
+
+
+/*
+ * Determines the result of a finished transaction.
  *
+ * @param transaction The transaction to check on.
+ * @return TWISuccess if the transaction completed; or the reason it failed.
  */ 
-uint8_t perform_bus_pirate_twi_command(const char * command, ...) {
+TWIResult twi_transaction_result(TWITransaction * transaction)
+{
+  if(transaction->state == TransactionComplete) {
+    return TWISuccess;
+  }
 
+  //Otherwise, the transaction records the status which caused it to fail. 
+  //The hardware reports a bus error as status zero, which would otherwise read as success.
+  if(transaction->twi_status == TW_BUS_ERROR) {
+    return TWIBusError;
+  }
 
-  //Stores the current radix, which is decimal by default.
-  uint8_t radix = 10;
-  uint8_t to_transmit = 0, is_transmission = 0, read_count = 0;
+  return (TWIResult)transaction->twi_status;
+}
 
-  //Set up handling of the variadic arguments, which are used
-  //for reading.
-  va_list variadic_arguments;
-  uint8_t * read_target = 0;
-  va_start(variadic_arguments, command);
 
-  //Process each argument in the command.
-  for(; *command; ++command) {
-    switch(*command) {
-  
-      //If we have an open brace, issue a TWI start condition.
-      case '{':
-      case '[':
-        send_twi_start_condition();
-        break;
-
-      //If we have a close brace, issue a TWI stop condition.
-      case '}':
-      case ']':
-        end_twi_packet();
-        break;
-   
-      //If we have an 'x', switch the active radix to hex.
-      case 'x':
-        radix = 16;
-        break;
-
-      //If we have a 'b', switch the active radix to binary.
-      case 'b':
-        radix = 2;
-        break;
-
-
-      //Read a single byte from the TWI device, and then
-      //send an acknowledgement, indicating that we expect further data.
-      case 'r':
-      case 'R':
-      case 's':
-      case 'S':
-        {
-
-          TWIReadMode read_mode;
-
-          //If we're been provided the 's' command,
-          //set the read mode to "last byte", which sends
-          //a negative acknowledgement to the device.
-          if(*command == 's' || *command == 'S') {
-            read_mode = LastByte;
-          } 
-          //Otherwise, send an ACK, indiacting that we
-          //would like additional data.
-          else {
-            read_mode = RequestMore;
-          }
-          
-          //Get the address that the read is targeting...
-          read_target = va_arg(variadic_arguments, uint8_t *);
-
-          //... and then perform the read.
-          *read_target = read_via_twi(read_mode);
-
-          //... increment the number of total reads, and continue.
-          ++read_count;
-          break;
-        }
-
-      // Send a single byte via the TWI interface, which should be
-      // provided as an argument.
-      case 'w':
-      case 'W':
-
-        //Since we're writing, this is a transmission.
-        is_transmission = 1;
-
-        //Read the byte that should be transmitted...
-        to_transmit = va_arg(variadic_arguments, unsigned int);
-
-        //... and "roll" directly into the transmit case.
-
-      //If we have a delimiter, handle any actions that have been queued.
-      case ' ':
-      case ',':
-        if(is_transmission) {
-          send_via_twi(to_transmit);
-        }
-
-        //Reset our state to the default.
-        radix = 10;
-        is_transmission = to_transmit = 0;
-        break;
-
-      //Delay 1us.
-      case '&':
-        _delay_us(1);
-        break;
-
-      //In all other cases, check to see if we have a piece of a literal.
-      default:
-        {
-         
-          uint8_t numeric_value;
-          uint8_t is_lowercase_hex = (*command >= 'a') && (*command <= 'f') && (radix == 16);
-          uint8_t is_uppercase_hex = (*command >= 'A') && (*command <= 'F') && (radix == 16);
-          uint8_t is_decimal_digit = (*command >= '0') && (*command <= '9') && (radix >= 10);
-          uint8_t is_valid_binary  = (*command >= '0') && (*command <= '1') && (radix ==  2);
-
-          //If we have a number format, convert the number to a raw numeric value.
-          if(is_lowercase_hex) {
-            numeric_value = *command - 'a' + 10;
-          }
-          else if(is_uppercase_hex) {
-            numeric_value = *command - 'A' + 10;
-          }
-          else if(is_decimal_digit || is_valid_binary) {
-            numeric_value = *command - '0';
-          } 
-          //Otherwise, the value is nonsensical, and should be skipped.
-          else {
-            break; 
-          }
-        
-          //Since we have a valid value to transmit, mark this as a transmission.
-          //This is idempotent, so it doesn't matter if this is run multiple times.
-          is_transmission = 1;
-
-          //Move the existing number over by a single radix place, "making room"
-          //to add the new number to the right...
-          to_transmit *= radix;
-
-          //... and then add the new value in the vacated spot.
-          to_transmit += numeric_value;
-
-          break;
-        }
+/*
+ * @return True iff any asynchronous TWI transactions are currently queued or in progress.
+ */ 
+uint8_t twi_transaction_in_progress() 
+{
+  return (active_transaction != 0) || (transaction_queue_count != 0);
+}
+
+
+/*
+ * Waits for all queued asynchronous transactions to complete.
+ */ 
+static void wait_for_twi_transactions_to_finish()
+{
+  TWIWatchdog watchdog;
+  start_twi_watchdog(&watchdog);
+
+  while(twi_transaction_in_progress()) {
+    service_twi_transactions(&watchdog);
+  }
+}
+
+
+/*
+ * Sets up a watchdog, which will give up on the active transaction if the hardware
+ * doesn't make progress within the current timeout.
+ */ 
+static void start_twi_watchdog(TWIWatchdog * watchdog)
+{
+  watchdog->last_event_count = twi_event_count;
+  watchdog->loops_remaining  = twi_timeout_loops;
+}
+
+
+/*
+ * Performs a single iteration of a loop that waits on asynchronous transactions:
+ * advances the transaction manually if interrupts are disabled, and aborts the 
+ * transaction if the hardware has stalled.
+ */ 
+static void service_twi_transactions(TWIWatchdog * watchdog)
+{
+  //If interrupts are disabled, the TWI interrupt will never fire-- so anyone waiting
+  //on a transaction needs to advance it themselves each time the hardware finishes 
+  //an operation.
+  if(bit_is_clear(SREG, SREG_I) && bit_is_set(TWCR, TWINT) && bit_is_set(TWCR, TWIE)) {
+    handle_twi_event();
+  }
+
+  //If the hardware has made progress since we last checked, restart the watchdog...
+  if(watchdog->last_event_count != twi_event_count) {
+    start_twi_watchdog(watchdog);
+  }
+  //... otherwise, if it's been stuck for too long, give up on the active transaction.
+  else if(!--watchdog->loops_remaining) {
+    abort_active_twi_transaction();
+    start_twi_watchdog(watchdog);
+  }
+}
+
+
+/*
+ * Gives up on the active asynchronous transaction, which has stalled; recovers the bus, 
+ * and moves on to the next queued transaction.
+ */ 
+static void abort_active_twi_transaction()
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+
+    TWITransaction * transaction = active_transaction;
+
+    //Free up the bus. This also disables the TWI interrupt, so it won't fire while we work.
+    recover_twi_bus();
+
+    //If a transaction was active, mark it as failed, and move on to the next one.
+    if(transaction) {
+      transaction->twi_status = TWI_STATUS_TIMEOUT;
+      begin_next_twi_transaction(0);
+      complete_twi_transaction(transaction, TransactionFailed);
     }
   }
+}
+
+
+/*
+ * Advances the active asynchronous transaction by a single step. Called each time
+ * the TWI hardware finishes an operation (i.e. from the TWI interrupt).
+ */ 
+static void handle_twi_event()
+{
+  TWITransaction * transaction = active_transaction;
+  uint8_t twi_status = TW_STATUS & 0xF8;
+
+  //If we don't have a transaction to work on, this event isn't ours. Stop listening 
+  //for TWI events, and leave the hardware alone.
+  if(!transaction) {
+    TWCR &= ~((1 << TWIE) | (1 << TWINT));
+    return;
+  }
+
+  transaction->twi_status = twi_status;
+  ++twi_event_count;
+
+  switch(twi_status) {
+
+    //If we've just sent a start condition, send the device's address and the direction 
+    //bit for the phase we're in.
+    case TW_START:
+    case TW_REP_START:
+      TWDR = (transaction->address << 1) | (active_transaction_is_reading ? Read : Write);
+      TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+      break;
+
+    //If the device has accepted our address or our last byte, move on to the next byte--
+    //or, if we're out of bytes to write, move on to the read phase.
+    case TW_MT_SLA_ACK:
+    case TW_MT_DATA_ACK:
+
+      //If we still have data to write, send the next byte.
+      if(transaction->position < transaction->write_length) {
+        TWDR = transaction->to_write[transaction->position++];
+        TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+      }
+      //If we have data to read, send a repeated start, and switch to reading.
+      else if(transaction->read_length) {
+        active_transaction_is_reading = 1;
+        transaction->position = 0;
+        TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE);
+      }
+      //Otherwise, we're done!
+      else {
+        finish_twi_transaction(TransactionComplete);
+      }
+      break;
+
+    //If we've just received a byte (and asked for more), store it...
+    case TW_MR_DATA_ACK:
+      transaction->read_into[transaction->position++] = TWDR;
+
+      //... and "roll" into requesting the next byte.
+      /* fall through */
+
+    //Request the next byte. We acknowledge (TWEA) every byte except the last, 
+    //which tells the device that we don't want any further data.
+    case TW_MR_SLA_ACK:
+      if(transaction->position + 1 < transaction->read_length) {
+        TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE) | (1 << TWEA);
+      } else {
+        TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+      }
+      break;
+
+    //If we've just received the last byte, store it, and finish the transaction.
+    case TW_MR_DATA_NACK:
+      transaction->read_into[transaction->position++] = TWDR;
+      finish_twi_transaction(TransactionComplete);
+      break;
+
+    //If we've lost arbitration, another master owns the bus-- so we can't send a 
+    //stop condition. Release the bus (starting the next transaction once the bus is 
+    //free), and mark the transaction as failed.
+    case TW_MT_ARB_LOST:
+      begin_next_twi_transaction(0);
+      complete_twi_transaction(transaction, TransactionFailed);
+      break;
+
+    //In any other case, the device has NAK'd us, or something's gone wrong on the bus.
+    //Abort the transaction.
+    default:
+      finish_twi_transaction(TransactionFailed);
+      break;
+
+  }
+}
+
+
+/*
+ * Sends a stop condition, and marks the active asynchronous transaction as finished.
+ * If another transaction is queued, it's started immediately.
+ */ 
+static void finish_twi_transaction(TWITransactionState final_state)
+{
+  TWITransaction * transaction = active_transaction;
+
+  //Send a stop condition. If another transaction is waiting, the hardware will follow 
+  //the stop condition directly with a start condition, chaining the two transactions
+  //without any help from the main loop. Unlike end_twi_packet, we don't wait around 
+  //for the stop condition to finish.
+  begin_next_twi_transaction(1 << TWSTO);
+
+  //Report the finished transaction's outcome.
+  complete_twi_transaction(transaction, final_state);
+}
+
+
+/*
+ * Removes the next transaction from the transaction queue, and makes it the active
+ * transaction; then applies the given TWI control bits, adding a start condition if 
+ * a transaction was waiting.
+ */ 
+static void begin_next_twi_transaction(uint8_t control_bits)
+{
+  TWITransaction * transaction;
+
+  //If there's nothing waiting, release the TWI hardware, and stop listening 
+  //for TWI events.
+  if(!transaction_queue_count) {
+    active_transaction = 0;
+    TWCR = (1 << TWINT) | (1 << TWEN) | control_bits;
+    return;
+  }
+
+  //Otherwise, pull the next transaction from the head of the queue...
+  transaction = transaction_queue[transaction_queue_head];
+  transaction_queue_head = (transaction_queue_head + 1) & (TWI_TRANSACTION_QUEUE_SIZE - 1);
+  --transaction_queue_count;
+
+  //... set up its initial state. If it has nothing to write (but something to read),
+  //we'll skip directly to the transaction's read phase.
+  transaction->state      = TransactionInProgress;
+  transaction->twi_status = TW_NO_INFO;
+  transaction->position   = 0;
+  active_transaction_is_reading = (transaction->write_length == 0) && (transaction->read_length != 0);
+  active_transaction = transaction;
+
+  //... and kick it off with a start condition. From here on, the transaction
+  //is handled by the TWI interrupt.
+  // The following Two Wire Control Register bits are set:
+  //  TWEN:  Sets the Two Wire ENable bit, which must be written to start any TWI communication.
+  //  TWSTA: Sets the Two Wire STArt bit, which specifies that we want to create a start condition.
+  //  TWINT: Clears any existing Two Wire INTerrupts, allowing us to move forwad. 
+  //  TWIE:  Sets the Two Wire Interrupt Enable bit, which fires the TWI interrupt once the start is complete.
+  TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE) | control_bits;
+}
 
-  //Halt parsing of varaidic arguments.
-  va_end(variadic_arguments);
 
-  //Return the number of reads performed.
-  return read_count;
+/*
+ * Marks a transaction as finished, and notifies its owner.
+ */ 
+static void complete_twi_transaction(TWITransaction * transaction, TWITransactionState final_state)
+{
+  transaction->state = final_state;
+
+  if(transaction->on_complete) {
+    transaction->on_complete(transaction);
+  }
+}
+
+
+/*
+ * TWI interrupt: fires each time the TWI hardware finishes an operation
+ * on behalf of an asynchronous transaction.
+ */ 
+ISR(TWI_vect)
+{
+  handle_twi_event();
 }
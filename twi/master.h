@@ -1,246 +1,726 @@
-/*
- *  This program is free software: you can redistribute it and/or modify
- *  it under the terms of the GNU General Public License as published by
- *  the Free Software Foundation, either version 3 of the License, or
- *  (at your option) any later version.
- *
- *  This program is distributed in the hope that it will be useful,
- *  but WITHOUT ANY WARRANTY; without even the implied warranty of
- *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- *  GNU General Public License for more details.
- *
- *  You should have received a copy of the GNU General Public License
- *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
- *
- *  EECE 387 Example Code
- *  Simple TWI (Two Wire Interface) library for TWI-enabled AVRs.
- *  
- *  Kyle J. Temkin <ktemkin@binghamton.edu>
- *  Peter Fleury <pfleury@gmx.ch>
- *
- *  This library is based on the I2C Master Library by Peter Fleury (http://jump.to/fleury),
- *  which is in turn based on the contents of the AVR300.
- */
-
-
-#ifndef _TWI_MASTER_H__
-#define _TWI_MASTER_H__
-
-#include <stdbool.h>
-#include <stdarg.h>
-#include <inttypes.h>
-#include <compat/twi.h>
-#include <util/delay.h>
-
-#ifdef DOXYGEN
-/**
- @brief Software Library for TWI Masters
-
- Basic routines for communicating with TWI slave devices. This single master 
- implementation is limited to one bus master on the TWI bus. 
-
- This I2c library is implemented as a compact assembler software implementation of the TWI protocol 
- which runs on any AVR (i2cmaster.S) and as a TWI hardware interface for all AVR with built-in TWI hardware (twimaster.c).
- Since the API for these two implementations is exactly the same, an application can be linked either against the
- software TWI implementation or the hardware TWI implementation.
-
- Use an appropriately sized pull-up resistor on the SDA and SCL pin. For testing, a 4.7k resistor is usually fine.
- 
- @par API Usage Example
-  The following code shows typical usage of this library. See example sample_twi_tsl2561.
-
- @code
-  #include "twi/master.h"
-  #include <util/delay.h>
-
-  int main() {
-
-    uint8_t device_id;
-
-    //Set up the microcontrollers's I2C hardware, running at 100kHz.
-    set_up_twi_hardware(100000);
-    _delay_ms(1);
-
-    //Read the device's ID-- simple, but less optimal method.
-    perform_bus_pirate_twi_command("[ 0x72 0x8A [ 0x73 r ]", &device_id);
-
-    //Read the device's ID-- more optimal method.
-    start_twi_write_to(0x39);
-    send_via_twi(0x8A);
-    start_twi_read_from(0x39);
-    device_id = read_via_twi(LastByte);
-    end_twi_packet();
-    printf("Re-read device ID: 0x%x\n", device_id);
-
-    //Wait forever.
-    while(1);
-    return 0;
-
-  }
- @endcode
-
-*/
-#endif /* DOXYGEN */
-
-/**@{*/
-
-#include <avr/io.h>
-
-/**
- * Defines a direction constant used for reading from TWI devices.
- */
-
-/**
- * Defines one of the two TWI data directions.
- */ 
-enum TWIDataDirection_enum {
-  Read = 1,
-  Write = 0
-};
-typedef enum TWIDataDirection_enum TWIDataDirection;
-
-
-/**
- * Defines the possible TWi read modes.
- */ 
-enum TWIReadMode_enum {
-  RequestMore = 1,
-  NonLastByte = 1,
-  LastByte = 0
-};
-typedef enum TWIReadMode_enum TWIReadMode;
-
-
-/**
- * Sets up the TWI hardware interface, preparing the TWI hardware for
- * communications. Unless the TWI clock settings are adjusted, this
- * method need only be called once.
- *
- * @brief Sets up the TWI hardware interface.
- * @param uint32_t The clock speed for the TWI interface, in Hz.
- * @return none
- */ 
-void set_up_twi_hardware(uint32_t i2c_clock_speed);
-
-/**
- *
- * Begins a TWI packet intended to read from the provided address.
- * (This transmits a start bit, an address bit, and a direction bit.)
- *
- * This method should only be used for the first time sending a start bit.
- * To send a start bit in the middle of a packet, use restart_communication_as_read_from.
- *
- * @param address The device's TWI address.
- * @retval 0 Returned if we can't communicate with the given device; e.g. if the device doesn't acknowledge communications.
- * @retval 1 Returned on success.
- */ 
-uint8_t start_twi_read_from(uint8_t address);
-
-/**
- * Begins a TWI packet intended to write to the provided address.
- * (This transmits a start bit, an address bit, and a direction bit.)
- *
- * This method should only be used for the first time sending a start bit.
- * To send a start bit in the middle of a packet, use restart_communication_as_write_to.
- *
- * @param address The device's TWI address.
- * @retval 0 Returned if we can't communicate with the given device; e.g. if the device doesn't acknowledge communications.
- * @retval 1 Returned on success.
- */ 
-uint8_t start_twi_write_to(uint8_t address);
-
-
-/**
- * Begins an TWI communication to a given address in either read or write mode.
- * Sends a start bit, the target address, and a driection bit.
- *
- * You may prefer to use start_twi_read_from / start_twi_write_to.
- * 
- * @param address The device's TWI address.
- * @param direction The communication direction for the given TWI device. Should be either TWI_READ or TWI_WRITE.
- * @retval 0 Returned if we can't communicate with the given device; e.g. if the device doesn't acknowledge communications.
- * @retval 1 Returned on success.
- */
-uint8_t start_twi_communication(uint8_t address, TWIDataDirection direction);
-
-
-/**
- * Attempts to start an TWI communication. If the device responds that it's
- * not available, retry until the device /is/ available.
- *
- * Use of this function is only appropriate in some limited circumstances,
- * but it is included as to be a complete implementation of the Master TWI library.
- */
-void ensure_twi_communication(uint8_t address, TWIDataDirection direction);
-
-
-/** 
- * Terminates TWI communication with the given bus. 
- */
-void end_twi_packet();
-
- 
-/**
- * Sends a single byte via the TWI interface.
- *
- * @param data The data to be transmitted via SPI.
- * @return data True iff the sent data is succesfully acknolwedged by a device.
- */ 
-uint8_t send_via_twi(uint8_t data);
-
-/**
- * Reads a single byte via TWI, and the requests more.
- *
- * @param read_mode Specifies the read mode for the given TWI communication, 
- *    which in turn specifies whether an additional byte is requested.
- * @return The byte read via TWI.
- */
-uint8_t read_via_twi(TWIReadMode read_mode);
-
-
-/**
- * Performs a given bus pirate command.
- *
- * Supports the following features:
- * {}, [], R/r, 0-255, 0b, 0h, &
- *
- * See: http://dangerousprototypes.com/bus-pirate-manual/i2c-guide/ 
- *
- * Two additional commands are also implemented:
- *  s: Reads a single byte, and then responds with a NAK.
- *  w: Transmits a single byte, provided as an argument. This allows programatic 
- *     control of transmission.
- *
- * Important note! You'll need to replace your last "r" with an "s",
- * or the TWI library will "lock up", as the AVR views the transmission
- * as being incomplete.
- *
- * For each read, a pointer should be provided to a uint8_t target.
- * For example:
- *
- * @code
- *   uint8_t hello;
- *   perform_bus_pirate_twi_command("[ 0x72 0x80 0x03 [ 0x73 s ]", &hello);
- * @endcode
- *
- * would read a single byte to the variable hello.
- *
- * For each _write_, a (non-pointer) uint8_t should be provided.
- * For example:
- *
- * @code
- *   perform_bus_pirate_twi_command("[ 0x72 0x80 w ]", 0x55);
- * @endcode 
- *
- * would send 0x72 (the address and write bit), then 0x80, and then 0x55.
- *
- *
- * @param command The bus pirate command, as a null-terminated string.
- * @param ...     A single uint8_t * for each read command, or a single uint8_t for each write.
- *
- */ 
-uint8_t perform_bus_pirate_twi_command(const char * command, ...);
-
-
-/**@}*/
-#endif
+/*
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *
+ *  EECE 387 Example Code
+ *  Simple TWI (Two Wire Interface) library for TWI-enabled AVRs.
+ *  
+ *  Kyle J. Temkin <ktemkin@binghamton.edu>
+ *  Peter Fleury <pfleury@gmx.ch>
+ *
+ *  This library is based on the I2C Master Library by Peter Fleury (http://jump.to/fleury),
+ *  which is in turn based on the contents of the AVR300.
+ */
+
+
+#ifndef _TWI_MASTER_H__
+#define _TWI_MASTER_H__
+
+//If you do not specify F_CPU at the compile time (e.g. on the GCC command line),
+//assume 8MHz.
+#ifndef F_CPU
+  #warning "You've attempted to use the TWI library without specifying a device clock speed (F_CPU). Assuming 8MHz."
+  #define F_CPU 8000000UL
+#endif
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <compat/twi.h>
+#include <util/delay.h>
+
+#ifdef DOXYGEN
+/**
+ @brief Software Library for TWI Masters
+
+ Basic routines for communicating with TWI slave devices. This single master 
+ implementation is limited to one bus master on the TWI bus. 
+
+ This I2c library is implemented as a software ("bit-banged") implementation of the TWI protocol 
+ which runs on any AVR's GPIO pins (twi/software_master.c), and as a TWI hardware interface for all AVR with built-in 
+ TWI hardware (twi/master.c). Since the API for these two implementations is exactly the same, an application can be 
+ linked either against the software TWI implementation or the hardware TWI implementation. The software implementation
+ can also drive several buses, on any pins; see twi/software_master.h.
+
+ Use an appropriately sized pull-up resistor on the SDA and SCL pin. For testing, a 4.7k resistor is usually fine.
+ 
+ @par API Usage Example
+  The following code shows typical usage of this library. See example sample_twi_tsl2561.
+
+ @code
+  #include "twi/master.h"
+  #include <util/delay.h>
+
+  int main() {
+
+    uint8_t device_id;
+
+    //Set up the microcontrollers's I2C hardware, running at 100kHz.
+    set_up_twi_hardware(100000);
+    _delay_ms(1);
+
+    //Read the device's ID-- simple, but less optimal method.
+    perform_bus_pirate_twi_command("[ 0x72 0x8A [ 0x73 s ]", &device_id);
+
+    //Read the device's ID-- more optimal method. Each of these functions returns true on success;
+    //the begin_/transmit_ variants (e.g. begin_twi_write_to) report the reason for any failure.
+    start_twi_write_to(0x39);
+    send_via_twi(0x8A);
+    start_twi_read_from(0x39);
+    device_id = read_via_twi(LastByte);
+    end_twi_packet();
+    printf("Re-read device ID: 0x%x\n", device_id);
+
+    //Read several registers at once-- the most optimal method.
+    uint8_t channel_zero[2];
+    TWIResult result = read_twi_register_block(0x39, 0xAC, channel_zero, sizeof(channel_zero));
+
+    //Each operation reports TWISuccess, or the TWI status which caused it to fail.
+    if(result != TWISuccess) {
+      printf("Couldn't read from the sensor (status 0x%02x).\n", result);
+    }
+
+    //Wait forever.
+    while(1);
+    return 0;
+
+  }
+ @endcode
+
+ @par Background Transactions
+  Whole transactions can also be run in the background by the TWI interrupt,
+  leaving the main loop free to do other work. Several transactions can be queued
+  at once; the TWI interrupt runs them back to back.
+
+ @code
+  uint8_t channel_zero_command = 0xAC, color_command = 0xB4;
+  uint8_t channel_zero[2], colors[8];
+
+  TWITransaction read_channel_zero = { .address = 0x39, 
+    .to_write = &channel_zero_command, .write_length = 1, .read_into = channel_zero, .read_length = 2 };
+  TWITransaction read_colors = { .address = 0x29, 
+    .to_write = &color_command, .write_length = 1, .read_into = colors, .read_length = 8 };
+
+  sei();
+  enqueue_twi_transaction(&read_channel_zero);
+  enqueue_twi_transaction(&read_colors);
+
+  while(!twi_transaction_finished(&read_colors)) {
+    //... do other work...
+  }
+ @endcode
+
+ @par Blocking and Background Operations
+  The byte-level functions (start_twi_communication, send_via_twi, read_via_twi and friends)
+  deliberately don't go through the transaction queue; they drive the hardware directly,
+  waiting on TWINT. A background transaction has to be described completely before it's
+  queued, and always ends with a stop condition-- while a byte-level packet stays open
+  between calls, and the caller decides what to send next based on the last result
+  (the bus pirate interpreter works this way). Routing each byte through the queue would
+  leave the bus "owned" by a half-finished transaction between calls, and would still
+  need a polling loop to wait for each byte; so we keep the two paths separate. This also
+  keeps the byte-level functions usable with interrupts disabled, at no cost in queue space.
+
+  The two paths share the hardware safely, as long as they aren't interleaved:
+  send_twi_start_condition waits for any queued transactions to finish before starting
+  a new packet. Don't queue a transaction (e.g. from an interrupt) while a byte-level
+  packet is open; it would start in the middle of that packet.
+
+*/
+#endif /* DOXYGEN */
+
+/**@{*/
+
+#include <avr/io.h>
+
+/**
+ * The maximum number of asynchronous transactions which can be waiting to be run.
+ * Must be a power of two. You can override this at compile time (e.g. on the GCC command line).
+ */
+#ifndef TWI_TRANSACTION_QUEUE_SIZE
+  #define TWI_TRANSACTION_QUEUE_SIZE 4
+#endif
+
+/**
+ * The amount of time we'll wait for any single TWI operation to complete before
+ * giving up and recovering the bus, in units of "the time it takes to send one byte 
+ * at the current bitrate". Values above one allow devices to stretch the clock.
+ * You can override this at compile time (e.g. on the GCC command line).
+ */
+#ifndef TWI_TIMEOUT_BYTE_TIMES
+  #define TWI_TIMEOUT_BYTE_TIMES 16
+#endif
+
+/**
+ * Pseudo-status reported when the TWI hardware doesn't complete an operation in time.
+ * Real TWI status values are always multiples of eight, so this can't be confused with one.
+ */
+#define TWI_STATUS_TIMEOUT 0x01
+
+/**
+ * Defines the possible results of a TWI operation. 
+ *
+ * Successful operations report TWISuccess, which is zero. Failed operations report
+ * the raw TW_STATUS value which caused them to fail, so they can be compared to any
+ * of the constants in <util/twi.h>; the most common failures are named below.
+ */ 
+enum TWIResult_enum {
+  TWISuccess = 0,
+
+  /** The operation didn't complete in time; the bus has been recovered. */
+  TWITimedOut = TWI_STATUS_TIMEOUT,
+
+  /** 
+   * An illegal start or stop condition was detected. The hardware reports this as 
+   * TW_BUS_ERROR (0x00), which we'd otherwise confuse with success.
+   */
+  TWIBusError = 0x02,
+
+  /** No device acknowledged the given address. */
+  TWIWriteAddressNotAcknowledged = TW_MT_SLA_NACK,
+  TWIReadAddressNotAcknowledged  = TW_MR_SLA_NACK,
+
+  /** The device refused a byte we sent. */
+  TWIDataNotAcknowledged = TW_MT_DATA_NACK,
+
+  /** Another master took control of the bus. */
+  TWIArbitrationLost = TW_MT_ARB_LOST
+};
+typedef enum TWIResult_enum TWIResult;
+
+/**
+ * Defines a direction constant used for reading from TWI devices.
+ */
+
+/**
+ * Defines one of the two TWI data directions.
+ */ 
+enum TWIDataDirection_enum {
+  Read = 1,
+  Write = 0
+};
+typedef enum TWIDataDirection_enum TWIDataDirection;
+
+
+/**
+ * Defines the possible TWi read modes.
+ */ 
+enum TWIReadMode_enum {
+  RequestMore = 1,
+  NonLastByte = 1,
+  LastByte = 0
+};
+typedef enum TWIReadMode_enum TWIReadMode;
+
+
+/**
+ * Defines the possible states of an asynchronous TWI transaction.
+ */ 
+enum TWITransactionState_enum {
+  TransactionIdle = 0,
+  TransactionQueued,
+  TransactionInProgress,
+  TransactionComplete,
+  TransactionFailed
+};
+typedef enum TWITransactionState_enum TWITransactionState;
+
+
+struct TWITransaction_struct;
+
+/**
+ * Function called when an asynchronous TWI transaction finishes.
+ * Note that this is called from inside the TWI interrupt, and thus should be kept short!
+ */ 
+typedef void (*TWITransactionCallback)(struct TWITransaction_struct * transaction);
+
+
+/**
+ * Describes a complete TWI transaction, which can be run in the background.
+ *
+ * A transaction consists of a start condition, the device's address, write_length
+ * bytes from to_write, and-- if read_length is non-zero-- a repeated start, the device's 
+ * address (in read mode) and read_length bytes read into read_into. The transaction 
+ * is always terminated with a stop condition.
+ *
+ * A transaction with nothing to write (write_length of zero) but something to read skips 
+ * its write phase entirely: it sends the device's address in read mode directly after the 
+ * start condition. If the device doesn't respond, the transaction fails with
+ * TWIReadAddressNotAcknowledged. A transaction with nothing to write or read just sends 
+ * the device's address (in write mode), which is useful for checking that a device is present.
+ */ 
+struct TWITransaction_struct {
+
+  /** The (7-bit) address of the device to communicate with. */
+  uint8_t address;
+
+  /** The bytes to be written to the device, if any. */
+  const uint8_t * to_write;
+  uint8_t write_length;
+
+  /** The buffer which should receive any data read from the device. */
+  uint8_t * read_into;
+  uint8_t read_length;
+
+  /** A function to be called when the transaction completes; or 0 for none. */
+  TWITransactionCallback on_complete;
+
+  /** The current state of the transaction; this can be polled to determine when the transaction is complete. */
+  volatile TWITransactionState state;
+
+  /** 
+   * The last TW_STATUS value observed during the transaction; useful for determining why a transaction failed. 
+   * If the transaction stalled, and was aborted, this will be TWI_STATUS_TIMEOUT.
+   */
+  volatile uint8_t twi_status;
+
+  /** The number of bytes of the current phase (write or read) which have been handled. Used internally. */
+  volatile uint8_t position;
+
+};
+typedef struct TWITransaction_struct TWITransaction;
+
+
+/**
+ * Describes a set of TWI clock settings: a prescaler / Two Wire Bitrate Register (TWBR)
+ * pair, and the bitrate they produce. 
+ */ 
+struct TWIClockSettings_struct {
+
+  /** The prescaler setting (TWPS), from 0-3. The TWBR value is multiplied by 4 ^ prescaler. */
+  uint8_t prescaler;
+
+  /** The Two Wire Bitrate Register (TWBR) value. */
+  uint8_t bitrate_register;
+
+  /** The bitrate these settings produce, in Hz; or 0 if the requested bitrate can't be reached. */
+  uint32_t bitrate;
+
+};
+typedef struct TWIClockSettings_struct TWIClockSettings;
+
+
+/**
+ * Determines the bitrate produced by a given prescaler / TWBR pair.
+ *
+ * @param prescaler The prescaler setting (TWPS), from 0-3.
+ * @param bitrate_register The Two Wire Bitrate Register (TWBR) value.
+ * @return The resultant bitrate, in Hz.
+ */ 
+static inline __attribute__((always_inline)) uint32_t twi_bitrate_from_settings(uint8_t prescaler, uint8_t bitrate_register) {
+
+  //From the datasheet, the SCL frequency is:
+  //
+  //   F_CPU / (16 + 2 * TWBR * (4 ^ prescaler))
+  //
+  return F_CPU / (16 + ((uint32_t)bitrate_register << (1 + 2 * prescaler)));
+}
+
+
+/**
+ * Determines the smallest TWBR value which, with the given prescaler, produces a
+ * bitrate no faster than the target bitrate. 
+ *
+ * @param target_bitrate The desired bitrate, in Hz. Must be non-zero.
+ * @param prescaler The prescaler setting (TWPS), from 0-3.
+ * @return The TWBR value; which may be larger than 255 if the bitrate can't be reached with this prescaler.
+ */ 
+static inline __attribute__((always_inline)) uint32_t twi_bitrate_register_for(uint32_t target_bitrate, uint8_t prescaler) {
+
+  //Determine the minimum length of an SCL period, in CPU cycles. We round up, 
+  //as any shorter period would produce a bitrate faster than we asked for.
+  uint32_t scl_period = (F_CPU + target_bitrate - 1) / target_bitrate;
+
+  //Each step of TWBR adds 2 * (4 ^ prescaler) cycles to the hardware's fixed 16.
+  uint32_t cycles_per_step = 2UL << (2 * prescaler);
+
+  //If the fixed 16 cycles are already slow enough, we don't need any more.
+  if(scl_period <= 16) {
+    return 0;
+  }
+
+  //Otherwise, add enough steps to cover the rest of the period-- again, rounding up.
+  return (scl_period - 16 + cycles_per_step - 1) / cycles_per_step;
+}
+
+
+/**
+ * Finds the TWI clock settings which produce the bitrate closest to the target
+ * bitrate, without exceeding it. 
+ *
+ * This function is always inlined, so if the target bitrate is a constant, the whole
+ * computation happens at compile time.
+ *
+ * Note that the fastest possible bitrate is F_CPU / 16 (e.g. 1MHz, at 16MHz); and 
+ * that the AVR datasheets only guarantee operation up to 400kHz.
+ *
+ * @param target_bitrate The desired bitrate, in Hz; e.g. 100000 (standard mode) or 400000 (fast mode).
+ * @return The clock settings. If the bitrate can't be reached (i.e. it's too slow
+ *    to fit in TWBR even with the largest prescaler), the settings' bitrate will be 0.
+ */ 
+static inline __attribute__((always_inline)) TWIClockSettings compute_twi_clock_settings(uint32_t target_bitrate) {
+
+  TWIClockSettings settings = { 0, 0, 0 };
+  uint32_t bitrate_register;
+  uint8_t prescaler;
+
+  if(!target_bitrate) {
+    return settings;
+  }
+
+  //Smaller prescalers give us finer control over the bitrate, so we'll use the smallest 
+  //prescaler that allows TWBR to fit into its eight bits.
+  for(prescaler = 0; prescaler < 4; ++prescaler) {
+
+    bitrate_register = twi_bitrate_register_for(target_bitrate, prescaler);
+
+    if(bitrate_register <= 255) {
+      settings.prescaler        = prescaler;
+      settings.bitrate_register = bitrate_register;
+      settings.bitrate          = twi_bitrate_from_settings(prescaler, bitrate_register);
+      break;
+    }
+  }
+
+  return settings;
+}
+
+
+/**
+ * Applies a given prescaler / TWBR pair to the TWI hardware. 
+ * Most code should use set_up_twi_hardware instead.
+ *
+ * @param prescaler The prescaler setting (TWPS), from 0-3.
+ * @param bitrate_register The Two Wire Bitrate Register (TWBR) value.
+ */ 
+void configure_twi_clock(uint8_t prescaler, uint8_t bitrate_register);
+
+
+/**
+ * Sets up the TWI hardware interface, preparing the TWI hardware for
+ * communications. Unless the TWI clock settings are adjusted, this
+ * method need only be called once.
+ *
+ * The hardware is set to the bitrate closest to the requested bitrate, without exceeding it;
+ * see compute_twi_clock_settings. 
+ *
+ * @brief Sets up the TWI hardware interface.
+ * @param uint32_t The clock speed for the TWI interface, in Hz.
+ * @return The bitrate actually achieved, in Hz; or 0 if the requested bitrate can't be reached,
+ *    in which case the hardware's settings are left unchanged.
+ */ 
+uint32_t set_up_twi_hardware(uint32_t i2c_clock_speed);
+
+
+/**
+ * Identical to set_up_twi_hardware, but inline: when the bitrate is a constant, the
+ * prescaler and TWBR values are computed at compile time, and no division code is needed.
+ *
+ * @param bitrate The clock speed for the TWI interface, in Hz.
+ * @return The bitrate actually achieved, in Hz; or 0 if the requested bitrate can't be reached.
+ */ 
+static inline __attribute__((always_inline)) uint32_t set_up_twi_hardware_inline(uint32_t bitrate) {
+
+  TWIClockSettings settings = compute_twi_clock_settings(bitrate);
+
+  if(settings.bitrate) {
+    configure_twi_clock(settings.prescaler, settings.bitrate_register);
+  }
+
+  return settings.bitrate;
+}
+
+/**
+ *
+ * Begins a TWI packet intended to read from the provided address.
+ * (This transmits a start bit, an address bit, and a direction bit.)
+ *
+ * This method should only be used for the first time sending a start bit.
+ * To send a start bit in the middle of a packet, use restart_communication_as_read_from.
+ *
+ * @param address The device's TWI address.
+ * @retval 0 Returned if we can't communicate with the given device; e.g. if the device doesn't acknowledge communications.
+ * @retval 1 Returned on success.
+ */ 
+uint8_t start_twi_read_from(uint8_t address);
+
+/**
+ * Begins a TWI packet intended to write to the provided address.
+ * (This transmits a start bit, an address bit, and a direction bit.)
+ *
+ * This method should only be used for the first time sending a start bit.
+ * To send a start bit in the middle of a packet, use restart_communication_as_write_to.
+ *
+ * @param address The device's TWI address.
+ * @retval 0 Returned if we can't communicate with the given device; e.g. if the device doesn't acknowledge communications.
+ * @retval 1 Returned on success.
+ */ 
+uint8_t start_twi_write_to(uint8_t address);
+
+
+/**
+ * Begins an TWI communication to a given address in either read or write mode.
+ * Sends a start bit, the target address, and a driection bit.
+ *
+ * You may prefer to use start_twi_read_from / start_twi_write_to.
+ * 
+ * @param address The device's TWI address.
+ * @param direction The communication direction for the given TWI device. Should be either TWI_READ or TWI_WRITE.
+ * @retval 0 Returned if we can't communicate with the given device; e.g. if the device doesn't acknowledge communications.
+ * @retval 1 Returned on success.
+ */
+uint8_t start_twi_communication(uint8_t address, TWIDataDirection direction);
+
+
+/**
+ * Sends a TWI start condition; or a repeated start condition, if a packet is already in progress.
+ *
+ * @retval 0 Returned if we couldn't gain control of the bus.
+ * @retval 1 Returned on success.
+ */ 
+uint8_t send_twi_start_condition();
+
+
+/**
+ * Begins a TWI packet intended to read from the provided address, reporting why it failed.
+ * Otherwise identical to start_twi_read_from.
+ *
+ * @param address The device's TWI address.
+ * @return TWISuccess on success; or the reason we can't communicate with the device, e.g. TWIReadAddressNotAcknowledged.
+ */ 
+TWIResult begin_twi_read_from(uint8_t address);
+
+/**
+ * Begins a TWI packet intended to write to the provided address, reporting why it failed.
+ * Otherwise identical to start_twi_write_to.
+ *
+ * @param address The device's TWI address.
+ * @return TWISuccess on success; or the reason we can't communicate with the device, e.g. TWIWriteAddressNotAcknowledged.
+ */ 
+TWIResult begin_twi_write_to(uint8_t address);
+
+/**
+ * Begins an TWI communication to a given address, reporting why it failed.
+ * Otherwise identical to start_twi_communication.
+ * 
+ * @param address The device's TWI address.
+ * @param direction The communication direction for the given TWI device. Should be either TWI_READ or TWI_WRITE.
+ * @return TWISuccess on success; or the reason we can't communicate with the device.
+ */
+TWIResult begin_twi_communication(uint8_t address, TWIDataDirection direction);
+
+/**
+ * Sends a TWI start condition, reporting why it failed.
+ * Otherwise identical to send_twi_start_condition.
+ *
+ * @return TWISuccess on success; or the reason we couldn't gain control of the bus, e.g. TWIArbitrationLost.
+ */ 
+TWIResult transmit_twi_start_condition();
+
+
+/**
+ * Attempts to start an TWI communication. If the device responds that it's
+ * not available, retry until the device /is/ available.
+ *
+ * Use of this function is only appropriate in some limited circumstances,
+ * but it is included as to be a complete implementation of the Master TWI library.
+ */
+void ensure_twi_communication(uint8_t address, TWIDataDirection direction);
+
+
+/** 
+ * Terminates TWI communication with the given bus. 
+ *
+ * @return TWISuccess on success; or TWITimedOut if the stop condition couldn't be sent in time, 
+ *    and the bus had to be recovered.
+ */
+TWIResult end_twi_packet();
+
+
+/**
+ * Attempts to free a TWI bus which has become stuck-- typically, because a device was
+ * interrupted mid-transfer, and is holding SDA low waiting for clock pulses that will 
+ * never come. 
+ *
+ * Disables the TWI hardware, manually clocks SCL up to nine times until SDA is released,
+ * sends a stop condition, and then re-enables the TWI hardware.
+ *
+ * This is called automatically whenever a TWI operation times out; see TWI_TIMEOUT_BYTE_TIMES.
+ */
+void recover_twi_bus();
+
+ 
+/**
+ * Sends a single byte via the TWI interface. This can be used to send a device's 
+ * address (and direction bit) directly after a start condition, as well as data.
+ *
+ * @param data The data to be transmitted via TWI.
+ * @return True iff the sent data is succesfully acknowledged by a device.
+ */ 
+uint8_t send_via_twi(uint8_t data);
+
+/**
+ * Sends a single byte via the TWI interface, reporting whether it was accepted.
+ * Otherwise identical to send_via_twi.
+ *
+ * @param data The data to be transmitted via TWI.
+ * @return TWISuccess if the byte was acknowledged by a device; or the reason it wasn't, e.g. TWIDataNotAcknowledged.
+ */ 
+TWIResult transmit_via_twi(uint8_t data);
+
+/**
+ * Reads a single byte via TWI, and the requests more.
+ *
+ * @param read_mode Specifies the read mode for the given TWI communication, 
+ *    which in turn specifies whether an additional byte is requested.
+ * @return The byte read via TWI; or 0xFF (the value of an idle bus) if the read timed out.
+ */
+uint8_t read_via_twi(TWIReadMode read_mode);
+
+/**
+ * Reads a single byte via TWI, reporting whether the read succeeded. 
+ * Otherwise identical to read_via_twi.
+ *
+ * @param data The location which will receive the byte read. Left unmodified if the read fails.
+ * @param read_mode Specifies the read mode for the given TWI communication, 
+ *    which in turn specifies whether an additional byte is requested.
+ * @return TWISuccess on success; or the reason the read failed, e.g. TWITimedOut.
+ */
+TWIResult receive_via_twi(uint8_t * data, TWIReadMode read_mode);
+
+
+/**
+ * Sends a block of bytes via the TWI interface. Transmission stops early if any 
+ * byte isn't acknowledged.
+ *
+ * @param data The data to be transmitted.
+ * @param length The number of bytes to be transmitted.
+ * @return TWISuccess on success; or the reason a byte wasn't accepted, e.g. TWIDataNotAcknowledged.
+ */ 
+TWIResult write_block_via_twi(const uint8_t * data, uint8_t length);
+
+/**
+ * Reads a block of bytes via TWI. Every byte but the last is acknowledged,
+ * requesting more data; the last is not, indicating that we're done.
+ *
+ * @param buffer The buffer which will receive the data.
+ * @param length The number of bytes to be read.
+ * @return TWISuccess on success; or the reason the read failed, e.g. TWITimedOut.
+ */ 
+TWIResult read_block_via_twi(uint8_t * buffer, uint8_t length);
+
+/**
+ * Writes a block of data to a device's registers, in a single packet:
+ * a start condition, the device's address, the register address, the data, 
+ * and a stop condition.
+ *
+ * @param address The device's TWI address.
+ * @param register_command The register address to write to, including any command bits 
+ *    the device requires (e.g. an auto-increment bit).
+ * @param data The data to be written.
+ * @param length The number of bytes to be written.
+ * @return TWISuccess on success; or the result of the first operation to fail.
+ */ 
+TWIResult write_twi_register_block(uint8_t address, uint8_t register_command, const uint8_t * data, uint8_t length);
+
+/**
+ * Reads a block of data from a device's registers, in a single packet: 
+ * writes the register address, and then uses a repeated start to burst-read 
+ * the given number of bytes. 
+ *
+ * @code
+ *   uint8_t colors[8];
+ *   read_twi_register_block(0x29, 0xB4, colors, sizeof(colors));
+ * @endcode
+ *
+ * @param address The device's TWI address.
+ * @param register_command The register address to read from, including any command bits 
+ *    the device requires (e.g. an auto-increment bit).
+ * @param buffer The buffer which will receive the data.
+ * @param length The number of bytes to be read.
+ * @return TWISuccess on success; or the result of the first operation to fail.
+ */ 
+TWIResult read_twi_register_block(uint8_t address, uint8_t register_command, uint8_t * buffer, uint8_t length);
+
+
+/**
+ * Queues an asynchronous TWI transaction, which will be run in the background
+ * by the TWI interrupt as soon as any previously queued transactions are complete. 
+ * Global interrupts must be enabled (e.g. with sei()) for the transaction to make progress.
+ *
+ * The transaction (and its buffers) must remain valid until twi_transaction_finished
+ * reports that the transaction has finished. A transaction must not be queued again
+ * until it's finished.
+ *
+ * @param transaction The transaction to be performed.
+ * @retval 0 Returned if the transaction queue is full.
+ * @retval 1 Returned if the transaction was queued.
+ */ 
+uint8_t enqueue_twi_transaction(TWITransaction * transaction);
+
+/**
+ * Begins an asynchronous TWI transaction. Equivalent to enqueue_twi_transaction.
+ *
+ * @param transaction The transaction to be performed.
+ * @retval 0 Returned if the transaction queue is full.
+ * @retval 1 Returned if the transaction was queued.
+ */ 
+uint8_t start_twi_transaction(TWITransaction * transaction);
+
+/**
+ * Checks to see if a queued transaction has finished, successfully or otherwise.
+ *
+ * @param transaction The transaction to check on.
+ * @return True iff the transaction is complete or has failed.
+ */ 
+uint8_t twi_transaction_finished(TWITransaction * transaction);
+
+/**
+ * Waits ('blocks') until a queued transaction has finished.
+ * This works whether or not interrupts are enabled.
+ *
+ * @param transaction The transaction to wait for.
+ * @return The transaction's result; see twi_transaction_result.
+ */ 
+TWIResult wait_for_twi_transaction(TWITransaction * transaction);
+
+/**
+ * Performs a TWI transaction, waiting ('blocking') until it's complete.
+ * This works whether or not interrupts are enabled.
+ *
+ * @param transaction The transaction to be performed.
+ * @return The transaction's result; see twi_transaction_result.
+ */ 
+TWIResult perform_twi_transaction(TWITransaction * transaction);
+
+/**
+ * Determines the result of a finished transaction.
+ *
+ * @param transaction The transaction to check on. Should have finished; see twi_transaction_finished.
+ * @return TWISuccess if the transaction completed; or the reason it failed, e.g. TWIWriteAddressNotAcknowledged.
+ */ 
+TWIResult twi_transaction_result(TWITransaction * transaction);
+
+/**
+ * @return True iff any asynchronous TWI transactions are currently queued or in progress.
+ */ 
+uint8_t twi_transaction_in_progress();
+
+
+/**@}*/
+
+//The bus pirate command interpreter (perform_bus_pirate_twi_command and friends)
+//is built on top of the functions above.
+#include "bus_pirate.h"
+
+#endif
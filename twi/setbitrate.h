@@ -0,0 +1,91 @@
+/*
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *
+ *  EECE 387 Example Code
+ *  Compile-time TWI clock configuration.
+ *
+ *  Works in the same way as <util/setbaud.h>: define TWI_BITRATE (and F_CPU) before
+ *  including this file, and it will compute the TWI prescaler and bitrate register
+ *  values using only the preprocessor-- so no code (or division routines) are needed
+ *  to set up the TWI clock at runtime.
+ *
+ *  This header can be included more than once, with different values of TWI_BITRATE.
+ *
+ *  @code
+ *    #define TWI_BITRATE 400000
+ *    #include "twi/setbitrate.h"
+ *
+ *    configure_twi_clock(TWPS_VALUE, TWBR_VALUE);
+ *  @endcode
+ *
+ *  The following macros are defined:
+ *    TWPS_VALUE          The prescaler setting (TWPS), from 0-3.
+ *    TWBR_VALUE          The Two Wire Bitrate Register (TWBR) value.
+ *    TWI_BITRATE_ACTUAL  The bitrate these settings actually produce, in Hz.
+ *
+ *  As with set_up_twi_hardware, the chosen bitrate is the one closest to TWI_BITRATE
+ *  which doesn't exceed it. If the achieved bitrate is more than TWI_BITRATE_TOL percent
+ *  slower than requested, a warning is issued; if the bitrate can't be reached at all,
+ *  compilation fails.
+ */
+
+#ifndef F_CPU
+  #error "setbitrate.h requires F_CPU to be defined"
+#endif
+
+#ifndef TWI_BITRATE
+  #error "setbitrate.h requires TWI_BITRATE to be defined"
+#endif
+
+//The tolerance for the achieved bitrate, in percent. Like BAUD_TOL, this
+//can be defined before including this file.
+#ifndef TWI_BITRATE_TOL
+  #define TWI_BITRATE_TOL 2
+#endif
+
+#undef TWPS_VALUE
+#undef TWBR_VALUE
+#undef TWI_BITRATE_ACTUAL
+
+//The minimum length of an SCL period, in CPU cycles; rounded up, as any shorter period
+//would produce a bitrate faster than we asked for. See twi_bitrate_register_for in master.h.
+#undef TWI_SCL_PERIOD_
+#define TWI_SCL_PERIOD_ ((F_CPU + (TWI_BITRATE) - 1) / (TWI_BITRATE))
+
+//The smallest TWBR value which reaches the bitrate with a given prescaler. Each step of
+//TWBR adds 2 * (4 ^ prescaler) cycles to the hardware's fixed 16.
+#undef TWBR_FOR_PRESCALER_
+#define TWBR_FOR_PRESCALER_(prescaler) \
+  ((TWI_SCL_PERIOD_ <= 16) ? 0 : (TWI_SCL_PERIOD_ - 16 + (2UL << (2 * (prescaler))) - 1) / (2UL << (2 * (prescaler))))
+
+//Use the smallest prescaler that allows TWBR to fit into its eight bits, as smaller
+//prescalers give us finer control over the bitrate.
+#if TWBR_FOR_PRESCALER_(0) <= 255
+  #define TWPS_VALUE 0
+#elif TWBR_FOR_PRESCALER_(1) <= 255
+  #define TWPS_VALUE 1
+#elif TWBR_FOR_PRESCALER_(2) <= 255
+  #define TWPS_VALUE 2
+#elif TWBR_FOR_PRESCALER_(3) <= 255
+  #define TWPS_VALUE 3
+#else
+  #error "TWI_BITRATE is too slow to be reached at this F_CPU, even with the largest TWI prescaler."
+#endif
+
+#define TWBR_VALUE TWBR_FOR_PRESCALER_(TWPS_VALUE)
+#define TWI_BITRATE_ACTUAL (F_CPU / (16 + 2 * TWBR_VALUE * (1UL << (2 * TWPS_VALUE))))
+
+#if 100 * TWI_BITRATE_ACTUAL < (100 - (TWI_BITRATE_TOL)) * (TWI_BITRATE)
+  #warning "TWI bitrate achieved is more than TWI_BITRATE_TOL percent slower than requested."
+#endif
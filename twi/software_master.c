@@ -0,0 +1,712 @@
+/*
+ * EECE 387 Example Code
+ * Software ("bit-banged") TWI master, which implements the API in master.h
+ * using ordinary GPIO pins.
+ *
+ * Each line is driven as an open-drain output: a line is pulled low by making its pin
+ * an output (with its PORT bit cleared), and released-- and pulled high by the bus's
+ * pull-up resistors-- by making its pin an input.
+ */
+
+#include "master.h"
+#include "software_master.h"
+
+#include <util/delay_basic.h>
+
+
+/*
+ * The pins used by the default bus, which are the same pins used by the TWI hardware.
+ * The defaults are correct for the ATmega48/88/168/328 family.
+ */
+#ifndef TWI_PORT
+  #define TWI_PORT     PORTC
+  #define TWI_DDR      DDRC
+  #define TWI_PIN      PINC
+  #define TWI_SDA_BIT  PC4
+  #define TWI_SCL_BIT  PC5
+#endif
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+/*
+ * The bus used when no other bus has been selected. Its registers are filled in when it's
+ * set up; see set_up_default_bus.
+ */
+static SoftwareTWIBus default_bus;
+
+/*
+ * The bus which all TWI functions currently act on.
+ */
+static SoftwareTWIBus * bus = &default_bus;
+
+/*
+ * Releases and pulls down the bus's lines.
+ */
+static inline void release_sda()  { _SFR_MEM8(bus->ddr) &= ~bus->sda_mask; }
+static inline void pull_sda_low() { _SFR_MEM8(bus->ddr) |=  bus->sda_mask; }
+static inline void pull_scl_low() { _SFR_MEM8(bus->ddr) |=  bus->scl_mask; }
+
+/*
+ * Returns true iff the given line is currently high.
+ */
+static inline uint8_t sda_is_high() { return (_SFR_MEM8(bus->pin) & bus->sda_mask) != 0; }
+static inline uint8_t scl_is_high() { return (_SFR_MEM8(bus->pin) & bus->scl_mask) != 0; }
+
+/*
+ * Waits for half of an SCL period.
+ */
+static inline void wait_half_period() { _delay_loop_2(bus->half_period_loops); }
+
+/*
+ * Fills in the default bus's registers, if they haven't been already. This isn't done
+ * with a static initializer, as the registers don't have fixed addresses in the host build.
+ */
+static void set_up_default_bus();
+
+/*
+ * Releases SCL, and waits for it to actually go high; devices may hold SCL low
+ * ("stretch the clock") while they're busy.
+ *
+ * @return False if SCL didn't go high in time, in which case the bus has been recovered; true otherwise.
+ */
+static uint8_t release_scl();
+
+/*
+ * Sends a single bit. Expects SCL to be low, and leaves SCL low.
+ *
+ * @return TWISuccess; TWIArbitrationLost if another master pulled SDA low while we were
+ *    sending a one; or TWITimedOut if a device held SCL low for too long.
+ */
+static TWIResult send_bit(uint8_t bit);
+
+/*
+ * Receives a single bit. Expects SCL to be low, and SDA to be released; leaves SCL low.
+ *
+ * @return TWISuccess; or TWITimedOut if a device held SCL low for too long.
+ */
+static TWIResult receive_bit(uint8_t * bit);
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Selects the bus which will be used by all other TWI functions.
+ *
+ * @param new_bus The bus to be used; or 0 to use the default bus.
+ */
+void select_software_twi_bus(SoftwareTWIBus * new_bus)
+{
+  if(!new_bus) {
+    set_up_default_bus();
+  }
+
+  bus = new_bus ? new_bus : &default_bus;
+}
+
+
+/*
+ * Sets up the selected bus, preparing it for communications. Unlike the hardware
+ * master, each bus has its own bitrate; so this should be called once per bus.
+ *
+ * @param twi_bitrate The clock speed for the bus, in Hz.
+ * @return The approximate bitrate achieved, in Hz; or 0 if the bitrate is zero.
+ */
+uint32_t set_up_twi_hardware(uint32_t twi_bitrate)
+{
+  if(!twi_bitrate) {
+    return 0;
+  }
+
+  if(bus == &default_bus) {
+    set_up_default_bus();
+  }
+
+  //Never drive either line high, and release both lines.
+  _SFR_MEM8(bus->port) &= ~(bus->sda_mask | bus->scl_mask);
+  _SFR_MEM8(bus->ddr)  &= ~(bus->sda_mask | bus->scl_mask);
+
+  //Compute the length of each half of an SCL period...
+  bus->half_period_loops = SOFTWARE_TWI_HALF_PERIOD_LOOPS(twi_bitrate);
+
+  //... and report the bitrate that'll produce.
+  return F_CPU / (2UL * (4UL * bus->half_period_loops + SOFTWARE_TWI_OVERHEAD_CYCLES));
+}
+
+
+/*
+ * Sets up the selected bus to run at the bitrate the TWI hardware would produce with
+ * the given prescaler / TWBR pair. Provided for compatibility with the hardware master
+ * (and with setbitrate.h).
+ */
+void configure_twi_clock(uint8_t prescaler, uint8_t bitrate_register)
+{
+  set_up_twi_hardware(twi_bitrate_from_settings(prescaler, bitrate_register));
+}
+
+
+/*
+ * Attempts to free the selected bus, if it has become stuck: clocks SCL up to nine times,
+ * until the device holding SDA lets go, and then sends a stop condition.
+ */
+void recover_twi_bus()
+{
+  uint8_t i;
+
+  release_sda();
+
+  //Clock SCL up to nine times, until the device lets go of SDA. We don't wait on
+  //clock stretching here, as a device that holds SCL can't be recovered anyway.
+  for(i = 0; (i < 9) && !sda_is_high(); ++i) {
+    pull_scl_low();
+    wait_half_period();
+    _SFR_MEM8(bus->ddr) &= ~bus->scl_mask;
+    wait_half_period();
+  }
+
+  //Generate a stop condition (SDA rising while SCL is high).
+  pull_scl_low();
+  pull_sda_low();
+  wait_half_period();
+  _SFR_MEM8(bus->ddr) &= ~bus->scl_mask;
+  wait_half_period();
+  release_sda();
+  wait_half_period();
+
+  bus->expecting_address = 0;
+}
+
+
+/*
+ * Begins a TWI packet intended to read from the provided address; or sends a repeated start condition.
+ * Returns true on success.
+ */
+uint8_t start_twi_read_from(uint8_t address) {
+  return begin_twi_read_from(address) == TWISuccess;
+}
+
+
+/*
+ * Begins a TWI packet intended to write to the provided address; or sends a repeated start condition.
+ * Returns true on success.
+ */
+uint8_t start_twi_write_to(uint8_t address) {
+  return begin_twi_write_to(address) == TWISuccess;
+}
+
+
+/*
+ * Begins an TWI communication to a given address in either read or write mode.
+ * Returns true on success.
+ */
+uint8_t start_twi_communication(uint8_t address, TWIDataDirection direction) {
+  return begin_twi_communication(address, direction) == TWISuccess;
+}
+
+
+/*
+ * Sends a TWI start condition. Returns true on success.
+ */
+uint8_t send_twi_start_condition() {
+  return transmit_twi_start_condition() == TWISuccess;
+}
+
+
+/*
+ * Begins a TWI packet intended to read from the provided address, reporting why it failed.
+ */
+TWIResult begin_twi_read_from(uint8_t address) {
+  return begin_twi_communication(address, Read);
+}
+
+
+/*
+ * Begins a TWI packet intended to write to the provided address, reporting why it failed.
+ */
+TWIResult begin_twi_write_to(uint8_t address) {
+  return begin_twi_communication(address, Write);
+}
+
+
+/*
+ * Begins an TWI communication to a given address in either read or write mode.
+ * Sends a start bit, the target address, and a driection bit.
+ */
+TWIResult begin_twi_communication(uint8_t address, TWIDataDirection direction)
+{
+  TWIResult result = transmit_twi_start_condition();
+
+  if(result != TWISuccess) {
+    return result;
+  }
+
+  return transmit_via_twi(address << 1 | direction);
+}
+
+
+/*
+ * Sends a TWI start condition; or a repeated start condition, if a packet is already in progress.
+ */
+TWIResult transmit_twi_start_condition()
+{
+  uint32_t loops_remaining = (uint32_t)bus->half_period_loops * 18 * TWI_TIMEOUT_BYTE_TIMES;
+
+  //Release SDA, and then SCL. If we're in the middle of a packet, SCL is currently low,
+  //so this won't be seen as a stop condition.
+  release_sda();
+  wait_half_period();
+
+  if(!release_scl()) {
+    return TWITimedOut;
+  }
+
+  //Wait for SDA to be released, in case a device is still holding it.
+  while(!sda_is_high()) {
+    if(!--loops_remaining) {
+      recover_twi_bus();
+      return TWITimedOut;
+    }
+  }
+  wait_half_period();
+
+  //A start condition is SDA falling while SCL is high.
+  pull_sda_low();
+  wait_half_period();
+  pull_scl_low();
+
+  bus->expecting_address = 1;
+  return TWISuccess;
+}
+
+
+/*
+ * Attempts to start an TWI communication. If the device responds that it's
+ * not available, retry until the device /is/ available.
+ */
+void ensure_twi_communication(uint8_t address, TWIDataDirection direction)
+{
+  TWIResult result;
+
+  while(1) {
+
+    result = begin_twi_communication(address, direction);
+
+    //If the device isn't ready, release the bus, and try again.
+    if((result == TWIWriteAddressNotAcknowledged) || (result == TWIReadAddressNotAcknowledged)) {
+      end_twi_packet();
+    }
+    //If we couldn't get control of the bus, just try again.
+    else if(result != TWISuccess) {
+      continue;
+    }
+    else {
+      break;
+    }
+  }
+}
+
+
+/*
+ * Terminates TWI communication with the selected bus.
+ */
+TWIResult end_twi_packet()
+{
+  bus->expecting_address = 0;
+
+  //A stop condition is SDA rising while SCL is high.
+  pull_sda_low();
+  wait_half_period();
+
+  if(!release_scl()) {
+    return TWITimedOut;
+  }
+
+  wait_half_period();
+  release_sda();
+  wait_half_period();
+
+  return TWISuccess;
+}
+
+
+/*
+ * Sends a single byte via the TWI interface. Returns true iff the byte was acknowledged.
+ */
+uint8_t send_via_twi(uint8_t data)
+{
+  return transmit_via_twi(data) == TWISuccess;
+}
+
+
+/*
+ * Sends a single byte via the TWI interface; either a device's address, or data.
+ */
+TWIResult transmit_via_twi(uint8_t data)
+{
+  uint8_t i, negative_acknowledge;
+  uint8_t direction = data & 0x01;
+  TWIResult result;
+
+  //Send each bit, starting with the most significant.
+  for(i = 0; i < 8; ++i) {
+
+    result = send_bit(data & 0x80);
+    data <<= 1;
+
+    if(result != TWISuccess) {
+      return result;
+    }
+  }
+
+  //Release SDA, and read the device's acknowledge bit.
+  release_sda();
+  result = receive_bit(&negative_acknowledge);
+
+  if(result != TWISuccess) {
+    return result;
+  }
+
+  //If the device didn't acknowledge the byte, report it the way the TWI hardware would.
+  if(negative_acknowledge) {
+
+    //The byte we've just sent was an address if it directly followed a start condition;
+    //its low bit was the direction bit.
+    if(bus->expecting_address) {
+      result = (direction == Read) ? TWIReadAddressNotAcknowledged : TWIWriteAddressNotAcknowledged;
+    } else {
+      result = TWIDataNotAcknowledged;
+    }
+  }
+
+  bus->expecting_address = 0;
+  return result;
+}
+
+
+/*
+ * Reads a single byte via TWI, and the requests more.
+ */
+uint8_t read_via_twi(TWIReadMode read_mode)
+{
+  uint8_t data = 0xFF;
+
+  receive_via_twi(&data, read_mode);
+  return data;
+}
+
+
+/*
+ * Reads a single byte via TWI, reporting whether the read succeeded.
+ */
+TWIResult receive_via_twi(uint8_t * data, TWIReadMode read_mode)
+{
+  uint8_t i, bit, received = 0;
+  TWIResult result;
+
+  //Let the device drive SDA, and read in each bit, starting with the most significant.
+  release_sda();
+
+  for(i = 0; i < 8; ++i) {
+
+    result = receive_bit(&bit);
+
+    if(result != TWISuccess) {
+      return result;
+    }
+
+    received = (received << 1) | bit;
+  }
+
+  //Acknowledge the byte (by sending a zero) if we want more data; or send a
+  //negative acknowledgement (a one) if we don't.
+  result = send_bit(read_mode != RequestMore);
+  release_sda();
+
+  if(result == TWISuccess) {
+    *data = received;
+  }
+
+  return result;
+}
+
+
+/*
+ * Sends a block of bytes via the TWI interface. Transmission stops early if any
+ * byte isn't acknowledged.
+ */
+TWIResult write_block_via_twi(const uint8_t * data, uint8_t length)
+{
+  TWIResult result = TWISuccess;
+
+  while(length-- && (result == TWISuccess)) {
+    result = transmit_via_twi(*data++);
+  }
+
+  return result;
+}
+
+
+/*
+ * Reads a block of bytes via TWI. Every byte but the last is acknowledged,
+ * requesting more data; the last is not, indicating that we're done.
+ */
+TWIResult read_block_via_twi(uint8_t * buffer, uint8_t length)
+{
+  TWIResult result = TWISuccess;
+
+  while(length && (result == TWISuccess)) {
+    --length;
+    result = receive_via_twi(buffer++, length ? RequestMore : LastByte);
+  }
+
+  return result;
+}
+
+
+/*
+ * Writes a block of data to a device's registers, in a single packet.
+ */
+TWIResult write_twi_register_block(uint8_t address, uint8_t register_command, const uint8_t * data, uint8_t length)
+{
+  //Perform each step in turn, stopping as soon as one fails.
+  TWIResult result = begin_twi_write_to(address);
+
+  if(result == TWISuccess) {
+    result = transmit_via_twi(register_command);
+  }
+  if(result == TWISuccess) {
+    result = write_block_via_twi(data, length);
+  }
+
+  //Always release the bus, even if we weren't successful.
+  end_twi_packet();
+  return result;
+}
+
+
+/*
+ * Reads a block of data from a device's registers, in a single packet.
+ */
+TWIResult read_twi_register_block(uint8_t address, uint8_t register_command, uint8_t * buffer, uint8_t length)
+{
+  //Perform each step in turn, stopping as soon as one fails.
+  TWIResult result = begin_twi_write_to(address);
+
+  if(result == TWISuccess) {
+    result = transmit_via_twi(register_command);
+  }
+  if(result == TWISuccess) {
+    result = begin_twi_read_from(address);
+  }
+  if(result == TWISuccess) {
+    result = read_block_via_twi(buffer, length);
+  }
+
+  //Always release the bus, even if we weren't successful.
+  end_twi_packet();
+  return result;
+}
+
+
+/*
+ * Performs a TWI transaction. The software master has no background to run transactions
+ * in, so the transaction is performed immediately, and is finished when this returns.
+ *
+ * @param transaction The transaction to be performed.
+ * @return Always 1, as the transaction is never queued.
+ */
+uint8_t enqueue_twi_transaction(TWITransaction * transaction)
+{
+  TWIResult result;
+
+  transaction->state = TransactionInProgress;
+  transaction->position = 0;
+
+  //If the transaction has nothing to write (but something to read), skip directly
+  //to its read phase, as the hardware master does...
+  if(!transaction->write_length && transaction->read_length) {
+    result = begin_twi_read_from(transaction->address);
+  }
+  //... otherwise, write any data the transaction has to send, and then begin reading
+  //any data it's expecting, after a repeated start.
+  else {
+    result = begin_twi_write_to(transaction->address);
+
+    if((result == TWISuccess) && transaction->write_length) {
+      result = write_block_via_twi(transaction->to_write, transaction->write_length);
+    }
+    if((result == TWISuccess) && transaction->read_length) {
+      result = begin_twi_read_from(transaction->address);
+    }
+  }
+
+  if((result == TWISuccess) && transaction->read_length) {
+    result = read_block_via_twi(transaction->read_into, transaction->read_length);
+  }
+
+  //Always release the bus, even if we weren't successful.
+  end_twi_packet();
+
+  //Report the transaction's outcome.
+  transaction->twi_status = result;
+  transaction->state = (result == TWISuccess) ? TransactionComplete : TransactionFailed;
+
+  if(transaction->on_complete) {
+    transaction->on_complete(transaction);
+  }
+
+  return true;
+}
+
+
+/*
+ * Begins a TWI transaction. Equivalent to enqueue_twi_transaction.
+ */
+uint8_t start_twi_transaction(TWITransaction * transaction)
+{
+  return enqueue_twi_transaction(transaction);
+}
+
+
+/*
+ * Checks to see if a transaction has finished, successfully or otherwise.
+ */
+uint8_t twi_transaction_finished(TWITransaction * transaction)
+{
+  return (transaction->state == TransactionComplete) || (transaction->state == TransactionFailed);
+}
+
+
+/*
+ * Waits until a transaction has finished. Transactions are always finished as soon
+ * as they're queued, so this just reports the result.
+ */
+TWIResult wait_for_twi_transaction(TWITransaction * transaction)
+{
+  return twi_transaction_result(transaction);
+}
+
+
+/*
+ * Performs a TWI transaction, and reports its result.
+ */
+TWIResult perform_twi_transaction(TWITransaction * transaction)
+{
+  enqueue_twi_transaction(transaction);
+  return twi_transaction_result(transaction);
+}
+
+
+/*
+ * Determines the result of a finished transaction.
+ */
+TWIResult twi_transaction_result(TWITransaction * transaction)
+{
+  if(transaction->state == TransactionComplete) {
+    return TWISuccess;
+  }
+
+  return (TWIResult)transaction->twi_status;
+}
+
+
+/*
+ * @return Always false; transactions are never left running in the background.
+ */
+uint8_t twi_transaction_in_progress()
+{
+  return false;
+}
+
+
+/*
+ * Fills in the default bus's registers, if they haven't been already.
+ */
+static void set_up_default_bus()
+{
+  if(!default_bus.pin) {
+    default_bus = (SoftwareTWIBus)SOFTWARE_TWI_BUS(TWI_PORT, TWI_DDR, TWI_PIN, TWI_SDA_BIT, TWI_SCL_BIT);
+  }
+}
+
+
+/*
+ * Releases SCL, and waits for it to actually go high.
+ */
+static uint8_t release_scl()
+{
+  uint32_t loops_remaining = (uint32_t)bus->half_period_loops * 18 * TWI_TIMEOUT_BYTE_TIMES;
+
+  _SFR_MEM8(bus->ddr) &= ~bus->scl_mask;
+
+  //If a device is stretching the clock, wait for it-- but not forever.
+  while(!scl_is_high()) {
+    if(!--loops_remaining) {
+      recover_twi_bus();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+/*
+ * Sends a single bit. Expects SCL to be low, and leaves SCL low.
+ */
+static TWIResult send_bit(uint8_t bit)
+{
+  //Set up SDA while SCL is low...
+  if(bit) {
+    release_sda();
+  } else {
+    pull_sda_low();
+  }
+  wait_half_period();
+
+  //... and then clock the bit out.
+  if(!release_scl()) {
+    return TWITimedOut;
+  }
+
+  //If we're sending a one, but SDA is low, another master is sending a zero;
+  //it wins the bus. Let go of the bus entirely, and let it continue.
+  if(bit && !sda_is_high()) {
+    bus->expecting_address = 0;
+    return TWIArbitrationLost;
+  }
+
+  wait_half_period();
+  pull_scl_low();
+
+  return TWISuccess;
+}
+
+
+/*
+ * Receives a single bit. Expects SCL to be low, and SDA to be released; leaves SCL low.
+ */
+static TWIResult receive_bit(uint8_t * bit)
+{
+  //Give the device time to set up SDA...
+  wait_half_period();
+
+  //... and then clock the bit in, sampling it while SCL is high.
+  if(!release_scl()) {
+    return TWITimedOut;
+  }
+
+  *bit = sda_is_high();
+  wait_half_period();
+  pull_scl_low();
+
+  return TWISuccess;
+}
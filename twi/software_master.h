@@ -0,0 +1,127 @@
+/*
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *
+ *  EECE 387 Example Code
+ *  Software ("bit-banged") TWI master.
+ *
+ *  Implements the API in master.h using ordinary GPIO pins, rather than the TWI
+ *  hardware. To use it, link against twi/software_master.o instead of twi/master.o
+ *  (e.g. make TWI_BACKEND=twi/software_master.o).
+ *
+ *  The software master can drive any number of buses, each on its own pair of pins;
+ *  all of the functions in master.h act on the currently selected bus. This allows
+ *  several devices which share the same address to be used at once, by giving each
+ *  its own bus:
+ *
+ *  @code
+ *    SoftwareTWIBus left_sensor  = SOFTWARE_TWI_BUS(PORTB, DDRB, PINB, PB0, PB1);
+ *    SoftwareTWIBus right_sensor = SOFTWARE_TWI_BUS(PORTD, DDRD, PIND, PD6, PD7);
+ *
+ *    select_software_twi_bus(&left_sensor);
+ *    set_up_twi_hardware(100000);
+ *    read_twi_register_block(0x39, 0xAC, left_reading, 2);
+ *
+ *    select_software_twi_bus(&right_sensor);
+ *    set_up_twi_hardware(100000);
+ *    read_twi_register_block(0x39, 0xAC, right_reading, 2);
+ *  @endcode
+ *
+ *  Differences from the hardware master:
+ *    - Each bus needs its own pull-up resistors; the pins are driven as open-drain
+ *      outputs, and internal pull-ups are never enabled.
+ *    - Transactions are performed immediately, when they're queued: enqueue_twi_transaction
+ *      only returns once the transaction is finished. A finished transaction's twi_status
+ *      holds the TWIResult which describes why it failed, or TWISuccess.
+ *    - Bitrates are approximate, and are limited by the speed of the CPU.
+ */
+
+#ifndef _TWI_SOFTWARE_MASTER_H__
+#define _TWI_SOFTWARE_MASTER_H__
+
+#include "master.h"
+
+/**@{*/
+
+/**
+ * The approximate number of CPU cycles spent toggling and sampling pins during each
+ * half-period of SCL, in addition to the delay loop; used to compute delay lengths.
+ */
+#ifndef SOFTWARE_TWI_OVERHEAD_CYCLES
+  #define SOFTWARE_TWI_OVERHEAD_CYCLES 20
+#endif
+
+/**
+ * Computes the number of delay loop iterations (of four cycles each) that make up
+ * half of an SCL period at the given bitrate. Always at least one.
+ */
+#define SOFTWARE_TWI_HALF_PERIOD_LOOPS(bitrate) \
+  ((F_CPU / (2UL * (bitrate)) > SOFTWARE_TWI_OVERHEAD_CYCLES + 4) ? \
+    ((F_CPU / (2UL * (bitrate)) - SOFTWARE_TWI_OVERHEAD_CYCLES) / 4) : 1)
+
+/**
+ * Describes a bus driven by the software TWI master.
+ * Should be created with SOFTWARE_TWI_BUS.
+ */
+struct SoftwareTWIBus_struct {
+
+  /**
+   * The data-space addresses of the PORT, DDR, and PIN registers for the port which contains
+   * the bus's pins. Each is accessed with _SFR_MEM8, just like a named register.
+   */
+  uint16_t port;
+  uint16_t ddr;
+  uint16_t pin;
+
+  /** Bitmasks which select the SDA and SCL pins. */
+  uint8_t sda_mask;
+  uint8_t scl_mask;
+
+  /** The length of half of an SCL period, in delay loop iterations. Set by set_up_twi_hardware. */
+  uint16_t half_period_loops;
+
+  /** True iff the next byte sent will be a device address. Used internally. */
+  uint8_t expecting_address;
+
+};
+typedef struct SoftwareTWIBus_struct SoftwareTWIBus;
+
+/**
+ * Creates a SoftwareTWIBus which uses the given pins, all of which must share a port.
+ * The bus runs at 100kHz until set_up_twi_hardware is called. In the host build (see
+ * host/virtual_avr.h), registers don't have fixed addresses; so there, buses must be
+ * created at runtime, rather than in a static initializer.
+ *
+ * @param port_register The PORT register for the bus's pins; e.g. PORTB.
+ * @param ddr_register The DDR register for the bus's pins; e.g. DDRB.
+ * @param pin_register The PIN register for the bus's pins; e.g. PINB.
+ * @param sda_bit, scl_bit The bit numbers of the SDA and SCL pins; e.g. PB0.
+ */
+#define SOFTWARE_TWI_BUS(port_register, ddr_register, pin_register, sda_bit, scl_bit) \
+  { .port = _SFR_MEM_ADDR(port_register), .ddr = _SFR_MEM_ADDR(ddr_register), .pin = _SFR_MEM_ADDR(pin_register), \
+    .sda_mask = (1 << (sda_bit)), .scl_mask = (1 << (scl_bit)), \
+    .half_period_loops = SOFTWARE_TWI_HALF_PERIOD_LOOPS(100000), .expecting_address = 0 }
+
+/**
+ * Selects the bus which will be used by all other TWI functions. Should only be called
+ * between packets, and never while a packet is in progress. The default bus is selected
+ * until this is called; like the hardware master, it must be set up (with set_up_twi_hardware
+ * or configure_twi_clock) before it's used.
+ *
+ * @param bus The bus to be used; or 0 to use the default bus, which uses the pins normally
+ *    used by the TWI hardware.
+ */
+void select_software_twi_bus(SoftwareTWIBus * bus);
+
+/**@}*/
+#endif
@@ -0,0 +1,183 @@
+/*
+ * EECE 387 Example Code
+ * Lightweight number formatting over UART.
+ *
+ * See format.h for usage.
+ */
+
+#include "format.h"
+#include "stdio.h"
+
+#include <avr/pgmspace.h>
+
+/*
+ * The largest number of decimal digits in a 32-bit number.
+ */
+#define MAXIMUM_DECIMAL_DIGITS 10
+
+/*
+ * The powers of ten used to convert numbers to decimal, from largest to smallest.
+ * The AVR has no divide instruction, so we find each digit by repeated subtraction
+ * instead; this takes at most nine subtractions per digit.
+ */
+static const uint32_t powers_of_ten[MAXIMUM_DECIMAL_DIGITS - 1] PROGMEM = {
+  1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL, 1000UL, 100UL, 10UL
+};
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Converts a number to decimal, without leading zeroes.
+ *
+ * @param value The value to be converted.
+ * @param digits A buffer, of at least MAXIMUM_DECIMAL_DIGITS characters, which will
+ *    receive the digits. No terminating null is added.
+ * @return The number of digits produced; always at least one.
+ */
+static uint8_t convert_to_decimal(uint32_t value, char * digits) {
+
+  uint8_t count = 0, i;
+  uint32_t power;
+  char digit;
+
+  for(i = 0; i < MAXIMUM_DECIMAL_DIGITS - 1; ++i) {
+
+    //Find the current digit, by counting the number of times we can subtract
+    //the current power of ten...
+    power = pgm_read_dword(&powers_of_ten[i]);
+    digit = '0';
+
+    while(value >= power) {
+      value -= power;
+      ++digit;
+    }
+
+    //... and keep it, unless it's a leading zero.
+    if(count || (digit != '0')) {
+      digits[count++] = digit;
+    }
+  }
+
+  //Whatever remains is the ones digit, which we always keep.
+  digits[count++] = '0' + value;
+  return count;
+}
+
+
+/*
+ * Sends the given number of copies of a single character.
+ */
+static void send_repeated_via_uart(char c, uint8_t count) {
+  while(count--) {
+    send_via_uart(c);
+  }
+}
+
+
+/*
+ * Sends a block of characters.
+ */
+static void send_characters_via_uart(const char * characters, uint8_t count) {
+  while(count--) {
+    send_via_uart(*characters++);
+  }
+}
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Sends an unsigned integer in decimal, right-aligned in a field of the given width.
+ */
+void send_unsigned_via_uart(uint32_t value, uint8_t width) {
+
+  char digits[MAXIMUM_DECIMAL_DIGITS];
+  uint8_t count = convert_to_decimal(value, digits);
+
+  //Pad the number out to the requested width, and then send it.
+  if(width > count) {
+    send_repeated_via_uart(' ', width - count);
+  }
+
+  send_characters_via_uart(digits, count);
+}
+
+
+/*
+ * Sends an unsigned integer in hexadecimal, with leading zeroes.
+ */
+void send_hex_via_uart(uint32_t value, uint8_t digits) {
+
+  uint8_t count = 1, nibble;
+
+  //Figure out how many digits the value needs, and send any leading zeroes
+  //needed to bring that up to the requested number of digits.
+  while((count < 8) && (value >> (count * 4))) {
+    ++count;
+  }
+
+  if(digits > count) {
+    send_repeated_via_uart('0', digits - count);
+  }
+
+  //Then, send each digit, starting with the most significant.
+  while(count--) {
+    nibble = (value >> (count * 4)) & 0x0F;
+    send_via_uart((nibble < 10) ? ('0' + nibble) : ('a' + nibble - 10));
+  }
+}
+
+
+/*
+ * Sends a fixed-point number, which has the given number of implied decimal places.
+ */
+void send_fixed_point_via_uart(int32_t value, uint8_t decimals, uint8_t width) {
+
+  char digits[MAXIMUM_DECIMAL_DIGITS];
+  uint8_t negative = (value < 0);
+  uint8_t count, whole_digits, length;
+
+  //Convert the magnitude of the number to decimal. (The cast ensures the
+  //most negative value is handled correctly.)
+  count = convert_to_decimal(negative ? -(uint32_t)value : (uint32_t)value, digits);
+
+  //Split the digits into the whole part and the fractional part. Small numbers
+  //(e.g. 5, with two decimal places) have no whole digits, and are sent with a
+  //leading zero ("0.05").
+  whole_digits = (count > decimals) ? (count - decimals) : 0;
+
+  //Figure out how long the number will be, and pad it out to the requested width.
+  length = negative + (whole_digits ? whole_digits : 1) + (decimals ? (decimals + 1) : 0);
+
+  if(width > length) {
+    send_repeated_via_uart(' ', width - length);
+  }
+
+  //Send the sign and the whole part...
+  if(negative) {
+    send_via_uart('-');
+  }
+
+  if(whole_digits) {
+    send_characters_via_uart(digits, whole_digits);
+  } else {
+    send_via_uart('0');
+  }
+
+  //... and then the fractional part, including any zeroes between the decimal point
+  //and the first digit.
+  if(decimals) {
+    send_via_uart('.');
+    send_repeated_via_uart('0', decimals - (count - whole_digits));
+    send_characters_via_uart(digits + whole_digits, count - whole_digits);
+  }
+}
@@ -0,0 +1,57 @@
+/**
+ * EECE 387 Example Code
+ * Lightweight number formatting over UART.
+ *
+ * A small set of formatting functions, which send numbers directly over the UART.
+ * These are much smaller and faster than printf, which has to parse its format string
+ * and uses a general-purpose division routine for each digit; so they're well-suited
+ * to sending frequent readings (e.g. from a sensor loop):
+ *
+ * @code
+ *   send_unsigned_via_uart(clear, 5);          // same as printf("%5u", clear)
+ *   send_hex_via_uart(device_id, 2);           // same as printf("%02x", device_id)
+ *   send_fixed_point_via_uart(lux, 2, 8);      // 12345 is sent as "  123.45"
+ * @endcode
+ *
+ * All output is sent using send_via_uart; so it's sent in the background if interrupts
+ * are enabled. No newline translation is performed.
+ */
+
+#ifndef __UART_FORMAT_H__
+#define __UART_FORMAT_H__
+
+#include <inttypes.h>
+
+/**
+ * Sends an unsigned integer in decimal, right-aligned in a field of the given width.
+ * Equivalent to printf("%*lu", width, value).
+ *
+ * @param value The value to be sent.
+ * @param width The minimum number of characters to send; shorter numbers are
+ *    padded with spaces on the left. Use 0 for no padding.
+ */
+void send_unsigned_via_uart(uint32_t value, uint8_t width);
+
+/**
+ * Sends an unsigned integer in (lowercase) hexadecimal, with leading zeroes.
+ * Equivalent to printf("%0*lx", digits, value).
+ *
+ * @param value The value to be sent.
+ * @param digits The minimum number of digits to send; e.g. 2 for a byte.
+ */
+void send_hex_via_uart(uint32_t value, uint8_t digits);
+
+/**
+ * Sends a fixed-point number, which has the given number of implied decimal places,
+ * right-aligned in a field of the given width. For example, the value -5 with two
+ * decimal places is sent as "-0.05". Useful for sending readings which have been
+ * computed with integer math, without ever resorting to floating point.
+ *
+ * @param value The value to be sent, multiplied by 10^decimals.
+ * @param decimals The number of digits to be placed after the decimal point.
+ * @param width The minimum number of characters to send; shorter numbers are
+ *    padded with spaces on the left. Use 0 for no padding.
+ */
+void send_fixed_point_via_uart(int32_t value, uint8_t decimals, uint8_t width);
+
+#endif
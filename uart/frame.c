@@ -0,0 +1,95 @@
+/*
+ * EECE 387 Example Code
+ * Binary framing over UART.
+ *
+ * See frame.h for the frame format.
+ */
+
+#include "frame.h"
+#include "stdio.h"
+
+#include <util/crc16.h>
+
+
+/*
+ * The longest run of non-zero bytes a single COBS block can describe.
+ */
+#define COBS_MAXIMUM_RUN 254
+
+
+/*
+ * -------------------------------------
+ * Private API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Fetches a single byte of the frame's contents: the caller's data, followed by the CRC.
+ * This lets us encode the frame without ever copying the data into a buffer of our own.
+ */
+static inline uint8_t frame_byte(const uint8_t * data, uint8_t length, uint16_t crc, uint16_t index) {
+
+  if(index < length) {
+    return data[index];
+  }
+
+  return (index == length) ? (crc & 0xFF) : (crc >> 8);
+}
+
+
+/*
+ * -------------------------------------
+ * Public API Functions
+ * -------------------------------------
+ */
+
+/*
+ * Sends a block of data over the UART, as a single COBS-encoded frame with a CRC.
+ *
+ * @param data The data to be sent; e.g. a pointer to a struct.
+ * @param length The length of the data, in bytes.
+ */
+void send_uart_frame(const void * data, uint8_t length) {
+
+  const uint8_t * bytes = data;
+  uint16_t crc = 0xFFFF;
+  uint16_t position = 0, contents_length = length + 2;
+  uint8_t i, run;
+
+  //First, compute the CRC of the data, which will follow the data in the frame.
+  for(i = 0; i < length; ++i) {
+    crc = _crc_ccitt_update(crc, bytes[i]);
+  }
+
+  //Next, send the frame's contents as a series of COBS blocks. Each block is a code byte,
+  //followed by a run of (code - 1) non-zero bytes; unless the code is 0xFF, the run is
+  //followed by a zero, which isn't sent. For this purpose, the contents are treated as
+  //if they had an extra zero on the end, which ends the last block.
+  while(position <= contents_length) {
+
+    //Find the length of the run of non-zero bytes that starts here...
+    run = 0;
+    while((position + run < contents_length) && (run < COBS_MAXIMUM_RUN) &&
+        frame_byte(bytes, length, crc, position + run)) {
+      ++run;
+    }
+
+    //... and send the block, straight from the caller's buffer.
+    send_via_uart(run + 1);
+
+    for(i = 0; i < run; ++i) {
+      send_via_uart(frame_byte(bytes, length, crc, position + i));
+    }
+
+    position += run;
+
+    //If the run was ended by a zero, rather than by its length, skip the zero;
+    //the receiver restores it.
+    if(run < COBS_MAXIMUM_RUN) {
+      ++position;
+    }
+  }
+
+  //Finally, end the frame.
+  send_via_uart(0);
+}
@@ -0,0 +1,47 @@
+/**
+ * EECE 387 Example Code
+ * Binary framing over UART.
+ *
+ * Sends raw binary data (e.g. a struct full of sensor readings) as compact,
+ * self-synchronizing frames, rather than as printf-formatted text. Each frame is:
+ *
+ *   COBS( data, CRC-CCITT of data (two bytes, least significant first) ), 0x00
+ *
+ * Consistent Overhead Byte Stuffing (COBS) removes every zero byte from the data, at
+ * a cost of one byte per 254; so the zero which ends each frame can never appear inside
+ * a frame, and a receiver can always find the start of the next frame. The CRC lets
+ * the receiver discard frames which were corrupted on the way.
+ *
+ * Frames are encoded directly from the caller's buffer as they're sent, so no copy
+ * of the data is ever made. Use tools/framedecode to decode frames on the host:
+ *
+ * @code
+ *   struct { uint16_t clear, red, green, blue; } reading;
+ *   ...
+ *   send_uart_frame(&reading, sizeof(reading));   // 12 bytes on the wire
+ * @endcode
+ *
+ * Frames are sent using send_via_uart; so they're sent in the background if interrupts
+ * are enabled. Set up the UART (e.g. with initialize_uart) before sending frames.
+ */
+
+#ifndef __UART_FRAME_H__
+#define __UART_FRAME_H__
+
+#include <inttypes.h>
+
+/**
+ * The largest number of bytes that can appear on the wire for a frame containing
+ * the given number of data bytes. Useful for sizing buffers on the receiving end.
+ */
+#define UART_FRAME_MAXIMUM_ENCODED_SIZE(length) ((length) + 2 + ((length) + 2) / 254 + 2)
+
+/**
+ * Sends a block of data over the UART, as a single COBS-encoded frame with a CRC.
+ *
+ * @param data The data to be sent; e.g. a pointer to a struct.
+ * @param length The length of the data, in bytes.
+ */
+void send_uart_frame(const void * data, uint8_t length);
+
+#endif
@@ -16,9 +16,27 @@
 
 #include "stdio.h"
 
+#include <stdbool.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#if (UART_TRANSMIT_BUFFER_SIZE & (UART_TRANSMIT_BUFFER_SIZE - 1)) != 0 || UART_TRANSMIT_BUFFER_SIZE > 128
+  #error "UART_TRANSMIT_BUFFER_SIZE must be a power of two, no larger than 128."
+#endif
+
+#if (UART_RECEIVE_BUFFER_SIZE & (UART_RECEIVE_BUFFER_SIZE - 1)) != 0 || UART_RECEIVE_BUFFER_SIZE > 128
+  #error "UART_RECEIVE_BUFFER_SIZE must be a power of two, no larger than 128."
+#endif
+
 //Set up function: sets up stdin/stdout for use with printf/scanf.
 static inline void set_up_special_files();
 
+//Set up functions: apply a given set of clock settings to the UART, or compute them at runtime.
+static void configure_uart(uint16_t baud_register, uint8_t use_double_speed);
+static int16_t compute_uart_baud_register(uint32_t baud, uint8_t use_double_speed, uint16_t * baud_register);
+
 //Functions that wait for transmission or receipt to occur.
 static void wait_until_ready_to_transmit();
 static void wait_until_data_is_received();
@@ -27,14 +45,53 @@ static void wait_until_data_is_received();
 static void place_into_transmit_buffer(char c);
 static inline char read_contents_of_receive_buffer();
 
+//Low-level functions which send blocks of characters, from either RAM or program memory.
+static void send_block_via_uart(const char * block, uint16_t length, uint8_t in_program_memory);
+static uint8_t try_send_block_via_uart(const char * block, uint16_t length, uint8_t in_program_memory);
+static void send_text_via_uart(const char * string, uint8_t in_program_memory);
+static inline char fetch_character(const char * address, uint8_t in_program_memory);
+
+//Functions which move characters from our transmit ring into the UART.
+static void transmit_next_buffered_character();
+static void send_buffered_characters_by_polling();
+
+//Moves a received character from the UART into our receive ring, accounting for any errors.
+static void buffer_received_character();
+
+//Increments an error count, without letting it wrap around.
+static inline void count_error(volatile uint16_t * count);
+
 //Special wrapper functions which allow use of this library with printf, scanf, and other stdio functions.
 static inline int send_via_uart_stdio_compatible(char c, FILE * pipe_to_transmit_from);
+static inline int send_via_uart_immediately_stdio_compatible(char c, FILE * pipe_to_transmit_from);
 static inline int receieve_via_uart_stdio_compatible(FILE * pipe_to_receive_into);
 
 //Create an input and output "pipe" device, which can be used as stdin/out/error replacements.
 static FILE uart_transmit_pipe = FDEV_SETUP_STREAM(send_via_uart_stdio_compatible, 0, _FDEV_SETUP_WRITE);
+static FILE uart_error_pipe    = FDEV_SETUP_STREAM(send_via_uart_immediately_stdio_compatible, 0, _FDEV_SETUP_WRITE);
 static FILE uart_receive_pipe  = FDEV_SETUP_STREAM(0, receieve_via_uart_stdio_compatible, _FDEV_SETUP_READ);
 
+//A ring of characters waiting to be transmitted by the UART interrupt.
+//The oldest character is located at transmit_buffer_head.
+static volatile char transmit_buffer[UART_TRANSMIT_BUFFER_SIZE];
+static volatile uint8_t transmit_buffer_head  = 0;
+static volatile uint8_t transmit_buffer_count = 0;
+
+//Determines what send_via_uart does when the transmit buffer is full.
+static UARTBufferFullPolicy transmit_policy = BlockWhenFull;
+
+//True iff we've sent a character since the last time flush_uart finished.
+static volatile uint8_t transmitted_since_flush = 0;
+
+//A ring of received characters waiting to be read.
+//The oldest character is located at receive_buffer_head.
+static volatile char receive_buffer[UART_RECEIVE_BUFFER_SIZE];
+static volatile uint8_t receive_buffer_head  = 0;
+static volatile uint8_t receive_buffer_count = 0;
+
+//Counts of the receive errors that have occurred since they were last cleared.
+static volatile UARTReceiveErrors receive_errors;
+
 /*
  * Sets up the device to use STDIO over serial.
  */
@@ -43,6 +100,20 @@ void set_up_stdio_over_serial() {
     set_up_special_files();
 }
 
+/*
+ * Sets up the device to use STDIO over serial, at the given baud rate.
+ */
+int16_t set_up_stdio_over_serial_at(uint32_t baud) {
+
+    int16_t error = initialize_uart_at(baud);
+
+    if(error != UART_BAUD_RATE_UNREACHABLE) {
+      set_up_special_files();
+    }
+
+    return error;
+}
+
 /*
  * Sets up the raw UART (Universal Asynchronous Receiver/Transmitter) for general use.
  * Does not set up the UART for use with stdin/stdout/stderr.
@@ -51,28 +122,217 @@ void initialize_uart() {
 
     //These values are automatically generated by <util/setbaud.h>
     //They're a tad 
-    UBRR0H = UBRRH_VALUE;
-    UBRR0L = UBRRL_VALUE;
+    configure_uart(UBRR_VALUE, USE_2X);
+}
 
-    #if USE_2X
-      UCSR0A |= _BV(U2X0);
-    #else
-      UCSR0A &= ~(_BV(U2X0));
-    #endif
+/*
+ * Sets up the raw UART for general use, at a baud rate chosen at runtime.
+ *
+ * @return The error in the actual baud rate, in tenths of a percent; or UART_BAUD_RATE_UNREACHABLE.
+ */
+int16_t initialize_uart_at(uint32_t baud) {
 
-    //Set up use of 8-bit data packets...  
-    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00); 
+    uint16_t normal_register = 0, double_speed_register = 0;
+    int16_t normal_error, double_speed_error;
+
+    //Figure out the best we can do at both normal and double speed. 
+    normal_error       = compute_uart_baud_register(baud, false, &normal_register);
+    double_speed_error = compute_uart_baud_register(baud, true, &double_speed_register);
 
-    //And take ownership of the Rx/Tx lines on the AVR.
-    UCSR0B = (1 << RXEN0)  | (1 << TXEN0);   
+    if((normal_error == UART_BAUD_RATE_UNREACHABLE) && (double_speed_error == UART_BAUD_RATE_UNREACHABLE)) {
+      return UART_BAUD_RATE_UNREACHABLE;
+    }
+
+    //Don't change the rate out from under a character that's still being sent.
+    flush_uart();
+
+    //Double speed samples each bit less often, which makes the receiver less tolerant 
+    //of error; so we only use it if it's strictly more accurate. (Like <util/setbaud.h>.)
+    if(abs(double_speed_error) < abs(normal_error)) {
+      configure_uart(double_speed_register, true);
+      return double_speed_error;
+    } else {
+      configure_uart(normal_register, false);
+      return normal_error;
+    }
 }
 
 /*
- * Sends the provided character over the serial line.
+ * Sends the provided character over the serial line; in the background, if 
+ * interrupts are enabled.
  */
 void send_via_uart(char c) {
+
+  //If interrupts are disabled, the UART interrupt can't empty our transmit buffer;
+  //so we'll send the character directly, after anything that's already been buffered.
+  if(bit_is_clear(SREG, SREG_I)) {
+    send_buffered_characters_by_polling();
+    wait_until_ready_to_transmit();
+    place_into_transmit_buffer(c);
+    return;
+  }
+
+  //In the common case, there's room in the buffer, and we're done.
+  if(try_send_via_uart(c)) {
+    return;
+  }
+
+  //Otherwise, the buffer is full; follow the transmit policy.
+  switch(transmit_policy) {
+
+    case DropNewestWhenFull:
+      break;
+
+    //Throw away the oldest character, and put this one in its place. We do this 
+    //atomically, so the UART interrupt can't sneak in and change the buffer.
+    case DropOldestWhenFull:
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if(transmit_buffer_count == UART_TRANSMIT_BUFFER_SIZE) {
+          transmit_buffer_head = (transmit_buffer_head + 1) & (UART_TRANSMIT_BUFFER_SIZE - 1);
+          --transmit_buffer_count;
+        }
+        try_send_via_uart(c);
+      }
+      break;
+
+    //Wait for the UART interrupt to make room for us.
+    default:
+      while(!try_send_via_uart(c));
+      break;
+  }
+}
+
+
+/*
+ * Sends the provided character over the serial line right away, ahead of anything
+ * waiting in the transmit buffer.
+ */
+void send_via_uart_immediately(char c) {
+
+  uint8_t transmit_interrupt_enabled;
+
+  //Pause the UART interrupt's transmissions, so it can't fill the UART while we're 
+  //waiting for it. Anything in the transmit buffer stays there until we're done.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    transmit_interrupt_enabled = bit_is_set(UCSR0B, UDRIE0);
+    UCSR0B &= ~(1 << UDRIE0);
+  }
+
+  //Now we only have to wait for the character already in the UART, if there is one.
   wait_until_ready_to_transmit();
   place_into_transmit_buffer(c);
+
+  //Finally, let the UART interrupt pick up where it left off.
+  if(transmit_interrupt_enabled) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      if(transmit_buffer_count) {
+        UCSR0B |= (1 << UDRIE0);
+      }
+    }
+  }
+}
+
+
+/*
+ * Attempts to place a single character into the transmit buffer, without ever waiting.
+ *
+ * @return True iff the character was queued for transmission.
+ */ 
+uint8_t try_send_via_uart(char c) {
+
+  uint8_t queued = false;
+
+  //The UART interrupt also manipulates the buffer, so we'll keep it from firing while we work.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if(transmit_buffer_count < UART_TRANSMIT_BUFFER_SIZE) {
+      transmit_buffer[(transmit_buffer_head + transmit_buffer_count) & (UART_TRANSMIT_BUFFER_SIZE - 1)] = c;
+      ++transmit_buffer_count;
+      queued = true;
+
+      //Ask the UART to interrupt us whenever it's ready for another character.
+      UCSR0B |= (1 << UDRIE0);
+    }
+  }
+
+  return queued;
+}
+
+
+/*
+ * Sends a block of data over the UART, exactly as given.
+ */ 
+void send_buffer_via_uart(const void * buffer, uint16_t length) {
+  send_block_via_uart(buffer, length, false);
+}
+
+
+/*
+ * Sends a string over the UART, translating newlines like the standard output.
+ */ 
+void send_string_via_uart(const char * string) {
+  send_text_via_uart(string, false);
+}
+
+
+/*
+ * Sends a string stored in program memory over the UART, translating newlines like the standard output.
+ */ 
+void send_string_via_uart_P(const char * string) {
+  send_text_via_uart(string, true);
+}
+
+
+/*
+ * Sets how the given stream sends newlines.
+ */ 
+void set_uart_newline_mode(FILE * stream, UARTNewlineMode mode) {
+  fdev_set_udata(stream, (void *)mode);
+}
+
+
+/*
+ * @return The number of characters which can be placed into the transmit buffer without waiting.
+ */ 
+uint8_t uart_transmit_space() {
+  return UART_TRANSMIT_BUFFER_SIZE - transmit_buffer_count;
+}
+
+
+/*
+ * Sets the policy used when send_via_uart is called while the transmit buffer is full.
+ */ 
+void set_uart_transmit_policy(UARTBufferFullPolicy policy) {
+  transmit_policy = policy;
+}
+
+
+/*
+ * Waits until every buffered character has been completely transmitted.
+ */ 
+void flush_uart() {
+
+  //Wait for the transmit buffer to empty out. If interrupts are disabled,
+  //we'll have to empty it ourselves.
+  while(transmit_buffer_count) {
+    if(bit_is_clear(SREG, SREG_I)) {
+      send_buffered_characters_by_polling();
+    }
+  }
+
+  //Then, wait for the last character to leave the UART entirely. The UART only
+  //sets its Transmit Complete flag after transmitting, so we don't wait if we haven't.
+  if(transmitted_since_flush) {
+    loop_until_bit_is_set(USART_STATUS, TXC0);
+    transmitted_since_flush = false;
+  }
+}
+
+
+/*
+ * Called whenever the UART is ready for another character to transmit.
+ */ 
+ISR(USART_UDRE_vect) {
+  transmit_next_buffered_character();
 }
 
 /*
@@ -82,8 +342,149 @@ void send_via_uart(char c) {
  * can't continue until it's complete!
  */ 
 char receieve_via_uart() {
-  wait_until_data_is_received();
-  return read_contents_of_receive_buffer();
+
+  char c;
+
+  while(!try_receive_via_uart(&c)) {
+
+    //If interrupts are disabled, the UART interrupt can't fill our receive buffer;
+    //so we'll have to wait for the character ourselves.
+    if(bit_is_clear(SREG, SREG_I)) {
+      wait_until_data_is_received();
+      buffer_received_character();
+    }
+  }
+
+  return c;
+}
+
+
+/*
+ * Attempts to read a single received character, without ever waiting.
+ *
+ * @return True iff a character was read.
+ */ 
+uint8_t try_receive_via_uart(char * c) {
+
+  uint8_t received = false;
+
+  //The UART interrupt also manipulates the buffer, so we'll keep it from firing while we work.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if(receive_buffer_count) {
+      *c = receive_buffer[receive_buffer_head];
+      receive_buffer_head = (receive_buffer_head + 1) & (UART_RECEIVE_BUFFER_SIZE - 1);
+      --receive_buffer_count;
+      received = true;
+    }
+  }
+
+  return received;
+}
+
+
+/*
+ * @return The number of received characters waiting to be read.
+ */ 
+uint8_t uart_characters_available() {
+
+  //If interrupts are disabled, pick up any character the UART is holding for us.
+  if(bit_is_clear(SREG, SREG_I) && bit_is_set(USART_STATUS, DATA_RECIEVED)) {
+    buffer_received_character();
+  }
+
+  return receive_buffer_count;
+}
+
+
+/*
+ * @return The number of receive errors which have occurred since they were last cleared.
+ */ 
+UARTReceiveErrors uart_receive_errors() {
+
+  UARTReceiveErrors errors;
+
+  //Take a consistent snapshot; the UART interrupt may update the counts at any time.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    errors = receive_errors;
+  }
+
+  return errors;
+}
+
+
+/*
+ * Resets each of the receive error counts to zero.
+ */ 
+void clear_uart_receive_errors() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    receive_errors.overruns         = 0;
+    receive_errors.framing_errors   = 0;
+    receive_errors.buffer_overflows = 0;
+  }
+}
+
+
+/*
+ * Called whenever the UART has received a character.
+ */ 
+ISR(USART_RX_vect) {
+  buffer_received_character();
+}
+
+/*
+ * Applies the given clock settings to the UART, and enables it.
+ */
+static void configure_uart(uint16_t baud_register, uint8_t use_double_speed) {
+
+    UBRR0H = baud_register >> 8;
+    UBRR0L = baud_register & 0xFF;
+
+    if(use_double_speed) {
+      UCSR0A |= _BV(U2X0);
+    } else {
+      UCSR0A &= ~(_BV(U2X0));
+    }
+
+    //Set up use of 8-bit data packets...  
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00); 
+
+    //And take ownership of the Rx/Tx lines on the AVR. We also ask the UART to
+    //interrupt us each time it receives a character, so we can buffer it.
+    UCSR0B = (1 << RXEN0)  | (1 << TXEN0) | (1 << RXCIE0);   
+}
+
+/*
+ * Computes the UBRR value which comes closest to the given baud rate, at either normal or double speed.
+ *
+ * @param baud The desired baud rate.
+ * @param use_double_speed True iff the UART will be run at double speed (U2X).
+ * @param baud_register Receives the UBRR value.
+ * @return The error in the resultant baud rate, in tenths of a percent; or UART_BAUD_RATE_UNREACHABLE
+ *    if no UBRR value can produce a rate anywhere near the desired one.
+ */
+static int16_t compute_uart_baud_register(uint32_t baud, uint8_t use_double_speed, uint16_t * baud_register) {
+
+  //At normal speed, the UART divides its clock by 16 * (UBRR + 1); at double speed, by 8 * (UBRR + 1).
+  uint8_t samples_per_bit = use_double_speed ? 8 : 16;
+  uint32_t divided_clock, actual_baud;
+
+  if(!baud || (baud > F_CPU / 8)) {
+    return UART_BAUD_RATE_UNREACHABLE;
+  }
+
+  //Find the value of (UBRR + 1) that gets us closest to the requested rate.
+  divided_clock = (F_CPU + (samples_per_bit * baud / 2)) / (samples_per_bit * baud);
+
+  //UBRR is twelve bits wide.
+  if(!divided_clock || (divided_clock > 4096)) {
+    return UART_BAUD_RATE_UNREACHABLE;
+  }
+
+  *baud_register = divided_clock - 1;
+
+  //Finally, compute how far we are from the requested rate.
+  actual_baud = F_CPU / (samples_per_bit * divided_clock);
+  return ((int32_t)(actual_baud - baud) * 1000) / (int32_t)baud;
 }
 
 /*
@@ -93,9 +494,10 @@ char receieve_via_uart() {
 static inline void set_up_special_files() {
 
   //Replace the standard output and standard error with our new transmission 
-  //method. We treat the output and error identically, as we only have one line
-  //with which to send data.
-  stdout = stderr = &uart_transmit_pipe;
+  //methods. Both share the same line; but the standard error skips ahead of any
+  //buffered output, so error messages aren't stuck waiting behind it.
+  stdout = &uart_transmit_pipe;
+  stderr = &uart_error_pipe;
 
   //Replace the standard input with our new reciept method.
   stdin = &uart_receive_pipe;
@@ -107,8 +509,9 @@ static inline void set_up_special_files() {
 static inline int send_via_uart_stdio_compatible(char character, FILE * output_file) {
  
   //The standard I/O functions end their line with '\n', but most serial terminals
-  //expect \r\n. If we're about to send a \n, we interject a '\r' first.
-  if(character == '\n') {
+  //expect \r\n. If we're about to send a \n, we interject a '\r' first; unless
+  //this stream has been asked to leave its newlines alone.
+  if((character == '\n') && (fdev_get_udata(output_file) == (void *)TranslateNewlines)) {
     send_via_uart('\r'); 
   }
 
@@ -117,6 +520,21 @@ static inline int send_via_uart_stdio_compatible(char character, FILE * output_f
   return 1;
 }
 
+/*
+ * A wrapper for send_via_uart_immediately which is compatible with the standard I/O functions.
+ */
+static inline int send_via_uart_immediately_stdio_compatible(char character, FILE * output_file) {
+ 
+  //Translate newlines, exactly as we do for the standard output.
+  if((character == '\n') && (fdev_get_udata(output_file) == (void *)TranslateNewlines)) {
+    send_via_uart_immediately('\r'); 
+  }
+
+  send_via_uart_immediately(character);
+
+  return 1;
+}
+
 /*
  * A wrapper for receieve_via_uart which is compatible with the standard I/O functions.
  */
@@ -129,9 +547,193 @@ static inline int receieve_via_uart_stdio_compatible(FILE * input_file) {
  * initiating transmission.
  */ 
 static inline void place_into_transmit_buffer(char c) {
+
+    //Clear the Transmit Complete flag (by writing a one to it), so flush_uart can tell
+    //when this character is done. The error flags must always be written as zero.
+    USART_STATUS = (USART_STATUS & (_BV(U2X0) | _BV(MPCM0))) | _BV(TXC0);
+    transmitted_since_flush = true;
+
     UDR0 = c; 
 }
 
+
+/*
+ * Sends a block of characters, from either RAM or program memory, without any translation.
+ */ 
+static void send_block_via_uart(const char * block, uint16_t length, uint8_t in_program_memory) {
+
+  uint8_t sent;
+
+  while(length) {
+
+    //Copy as much of the block into the transmit buffer as we can...
+    sent = bit_is_set(SREG, SREG_I) ? try_send_block_via_uart(block, length, in_program_memory) : 0;
+
+    //... and if we can't copy anything, either because the buffer's full or because
+    //interrupts are disabled, fall back to send_via_uart, which handles both.
+    if(!sent) {
+      send_via_uart(fetch_character(block, in_program_memory));
+      sent = 1;
+    }
+
+    block  += sent;
+    length -= sent;
+  }
+}
+
+
+/*
+ * Copies as much of a block of characters as will fit into the transmit buffer.
+ *
+ * @return The number of characters copied.
+ */ 
+static uint8_t try_send_block_via_uart(const char * block, uint16_t length, uint8_t in_program_memory) {
+
+  uint8_t tail, space, i;
+
+  //Find the free part of the ring. The UART interrupt only ever removes characters, so
+  //the free space can only grow while we work; and we can safely fill it without keeping
+  //the interrupt from firing.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    tail  = transmit_buffer_head + transmit_buffer_count;
+    space = UART_TRANSMIT_BUFFER_SIZE - transmit_buffer_count;
+  }
+
+  if(length < space) {
+    space = length;
+  }
+
+  for(i = 0; i < space; ++i) {
+    transmit_buffer[(tail + i) & (UART_TRANSMIT_BUFFER_SIZE - 1)] = fetch_character(block + i, in_program_memory);
+  }
+
+  //Once the characters are in place, hand them to the UART interrupt all at once.
+  if(space) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      transmit_buffer_count += space;
+      UCSR0B |= (1 << UDRIE0);
+    }
+  }
+
+  return space;
+}
+
+
+/*
+ * Sends a null-terminated string, from either RAM or program memory, translating 
+ * newlines according to the standard output's newline mode.
+ */ 
+static void send_text_via_uart(const char * string, uint8_t in_program_memory) {
+
+  uint8_t translate_newlines = (fdev_get_udata(&uart_transmit_pipe) == (void *)TranslateNewlines);
+  uint16_t length;
+  char c;
+
+  //Send the string in pieces, each of which ends at a newline (or at the end of the string);
+  //that way, we only have to translate the newlines themselves.
+  do {
+
+    for(length = 0; (c = fetch_character(string + length, in_program_memory)); ++length) {
+      if(translate_newlines && (c == '\n')) {
+        break;
+      }
+    }
+
+    send_block_via_uart(string, length, in_program_memory);
+    string += length;
+
+    if(c) {
+      send_via_uart('\r');
+      send_via_uart('\n');
+      ++string;
+    }
+
+  } while(c);
+}
+
+
+/*
+ * Fetches a single character, from either RAM or program memory.
+ */ 
+static inline char fetch_character(const char * address, uint8_t in_program_memory) {
+  return in_program_memory ? pgm_read_byte(address) : *address;
+}
+
+
+/*
+ * Moves the oldest character in our transmit ring into the UART. 
+ * Should only be called when the UART is ready to transmit.
+ */ 
+static void transmit_next_buffered_character() {
+
+  if(transmit_buffer_count) {
+    place_into_transmit_buffer(transmit_buffer[transmit_buffer_head]);
+    transmit_buffer_head = (transmit_buffer_head + 1) & (UART_TRANSMIT_BUFFER_SIZE - 1);
+    --transmit_buffer_count;
+  }
+
+  //Once the buffer's empty, stop asking for interrupts; otherwise, the UART would
+  //interrupt us continuously.
+  if(!transmit_buffer_count) {
+    UCSR0B &= ~(1 << UDRIE0);
+  }
+}
+
+
+/*
+ * Moves a received character from the UART into our receive ring, accounting for any errors.
+ * Should only be called when the UART has received a character.
+ */ 
+static void buffer_received_character() {
+
+  //The error flags describe the character currently in UDR0, so they have
+  //to be read before the character itself.
+  uint8_t status = USART_STATUS;
+  char c = read_contents_of_receive_buffer();
+
+  //A data overrun means we lost at least one character before this one; 
+  //but this character is fine.
+  if(status & _BV(DOR0)) {
+    count_error(&receive_errors.overruns);
+  }
+
+  //A framing error means this character is garbage; discard it.
+  if(status & _BV(FE0)) {
+    count_error(&receive_errors.framing_errors);
+    return;
+  }
+
+  //If we have room, add the character to the ring; otherwise, we have to drop it.
+  if(receive_buffer_count < UART_RECEIVE_BUFFER_SIZE) {
+    receive_buffer[(receive_buffer_head + receive_buffer_count) & (UART_RECEIVE_BUFFER_SIZE - 1)] = c;
+    ++receive_buffer_count;
+  } else {
+    count_error(&receive_errors.buffer_overflows);
+  }
+}
+
+
+/*
+ * Increments an error count, without letting it wrap around.
+ */ 
+static inline void count_error(volatile uint16_t * count) {
+  if(*count != UINT16_MAX) {
+    ++*count;
+  }
+}
+
+
+/*
+ * Transmits everything in our transmit ring, without the help of the UART interrupt.
+ * Used when interrupts are disabled.
+ */ 
+static void send_buffered_characters_by_polling() {
+  while(transmit_buffer_count) {
+    wait_until_ready_to_transmit();
+    transmit_next_buffered_character();
+  }
+}
+
 /*
  * Returns the current content of the recieve buffer,
  * and (indirectly) clears the read buffer.
@@ -18,16 +18,79 @@
 #endif
 
 //If you do not specify BAUD at the compile time (e.g. on the GCC command line),
-//assume 19.2k-baud. Unfortunately, the AVR libraries don't allow us to set this dynamically.
+//assume 19.2k-baud. This is the rate used by initialize_uart; to pick the rate at runtime, 
+//use initialize_uart_at instead.
 #ifndef BAUD
   #define BAUD 115200
 #endif
 
+//The number of characters which can be waiting to be transmitted. Must be a power
+//of two, no larger than 128. You can override this at compile time (e.g. on the GCC command line).
+#ifndef UART_TRANSMIT_BUFFER_SIZE
+  #define UART_TRANSMIT_BUFFER_SIZE 64
+#endif
+
+//The number of received characters which can be waiting to be read. Must be a power
+//of two, no larger than 128. You can override this at compile time (e.g. on the GCC command line).
+#ifndef UART_RECEIVE_BUFFER_SIZE
+  #define UART_RECEIVE_BUFFER_SIZE 32
+#endif
+
 #include <avr/io.h>
 #include <util/setbaud.h>
 #include <stdio.h>
 
 
+/**
+ * Defines what happens when a character is sent while the transmit buffer is full.
+ */ 
+enum UARTBufferFullPolicy_enum {
+
+  /** Wait ('block') until there's room in the buffer. Nothing is lost. */
+  BlockWhenFull = 0,
+
+  /** Discard the character being sent. */
+  DropNewestWhenFull,
+
+  /** Discard the oldest character in the buffer, to make room for the character being sent. */
+  DropOldestWhenFull
+};
+typedef enum UARTBufferFullPolicy_enum UARTBufferFullPolicy;
+
+
+/**
+ * Defines how newlines are sent by a text stream.
+ */ 
+enum UARTNewlineMode_enum {
+
+  /** Send each '\n' as "\r\n", which is what most serial terminals expect. The default. */
+  TranslateNewlines = 0,
+
+  /** Send every character exactly as given; e.g. for binary data. */
+  SendNewlinesUnchanged
+};
+typedef enum UARTNewlineMode_enum UARTNewlineMode;
+
+
+/**
+ * Counts the receive errors which have occurred since the counts were last cleared.
+ * Each count stops at its maximum value, rather than wrapping around.
+ */ 
+struct UARTReceiveErrors_struct {
+
+  /** The number of data overruns (DOR0): characters lost because the UART received them faster than we read them. */
+  uint16_t overruns;
+
+  /** The number of framing errors (FE0): characters received with an invalid stop bit, which were discarded. */
+  uint16_t framing_errors;
+
+  /** The number of characters discarded because the receive buffer was full. */
+  uint16_t buffer_overflows;
+
+};
+typedef struct UARTReceiveErrors_struct UARTReceiveErrors;
+
+
 /**
  * Sets up serial communications at 19200 baud (a measure
  * of communications frequency) with 8-bit data packets, 
@@ -36,6 +99,9 @@
  * with printf and scanf.
  *
  * Most of these match the defaults for the Bus Pirate.
+ *
+ * The standard error is unbuffered, and takes priority over the
+ * standard output; see send_via_uart_immediately.
  */ 
 void set_up_stdio_over_serial();
 
@@ -50,17 +116,157 @@ void set_up_stdio_over_serial();
 void initialize_uart();
 
 /**
- * Sends a single character directly over the UART.
- * If the UART is busy, this function will wait ('block')
- * until it is free.
+ * Returned by initialize_uart_at when the requested baud rate can't be produced 
+ * from the device's clock at all.
+ */
+#define UART_BAUD_RATE_UNREACHABLE INT16_MAX
+
+/**
+ * Sets up serial communications at the given baud rate, with the same settings as 
+ * initialize_uart. The UART's clock settings are computed at runtime, so this can be
+ * used to switch to a faster rate once a host has agreed to it. Any characters still
+ * waiting to be transmitted are sent (at the old rate) first.
+ *
+ * Rates which evenly divide the clock are exact; at 16MHz, 250k, 500k, 1M and 2M 
+ * baud all have 0% error, while the common 115200 baud is 2.1% fast.
+ *
+ * @param baud The desired baud rate; e.g. 115200 or 1000000.
+ * @return The error in the actual baud rate, in tenths of a percent: e.g. 21 means the 
+ *    actual rate is 2.1% faster than requested. Errors larger than about 2% (20) are
+ *    likely to cause communication errors. If the rate can't be produced at all, returns
+ *    UART_BAUD_RATE_UNREACHABLE, and leaves the UART unchanged.
+ */ 
+int16_t initialize_uart_at(uint32_t baud);
+
+/**
+ * Identical to set_up_stdio_over_serial, but uses the given baud rate; see initialize_uart_at.
+ *
+ * @param baud The desired baud rate; e.g. 115200 or 1000000.
+ * @return The error in the actual baud rate, in tenths of a percent; or UART_BAUD_RATE_UNREACHABLE.
+ */ 
+int16_t set_up_stdio_over_serial_at(uint32_t baud);
+
+/**
+ * Sends a single character over the UART.
+ *
+ * If global interrupts are enabled (e.g. with sei()), the character is placed into
+ * a transmit buffer, and sent in the background by the UART interrupt. If the buffer
+ * is full, the transmit policy (see set_uart_transmit_policy) decides what happens.
+ *
+ * If interrupts are disabled, the character is sent directly; if the UART is busy, 
+ * this function will wait ('block') until it is free.
  */
 void send_via_uart(char c);
 
+/**
+ * Sends a single character over the UART right away, ahead of any characters waiting
+ * in the transmit buffer; the buffered characters are sent afterwards, as usual. Waits 
+ * at most one character time, regardless of how full the transmit buffer is.
+ *
+ * The standard error stream (stderr) is sent this way, so error messages always go out 
+ * promptly, even when the standard output is backed up. As a result, an error message 
+ * may appear in the middle of a line of standard output.
+ */
+void send_via_uart_immediately(char c);
+
+/**
+ * Attempts to place a single character into the transmit buffer, without ever waiting.
+ *
+ * @retval 0 Returned if the transmit buffer was full; the character was not sent.
+ * @retval 1 Returned if the character was queued for transmission.
+ */
+uint8_t try_send_via_uart(char c);
+
+/**
+ * Sends a block of data over the UART, exactly as given. Much faster than sending
+ * each byte with send_via_uart: as many bytes as will fit are copied into the transmit
+ * buffer at once. If the buffer fills up, the transmit policy (see set_uart_transmit_policy)
+ * decides what happens to the remaining bytes.
+ *
+ * This shouldn't be used while an interrupt handler is also sending over the UART.
+ *
+ * @param buffer The data to be sent.
+ * @param length The length of the data, in bytes.
+ */
+void send_buffer_via_uart(const void * buffer, uint16_t length);
+
+/**
+ * Sends a string over the UART, in the same way as send_buffer_via_uart. Newlines
+ * are sent according to the newline mode of the UART's standard output; so by default,
+ * each '\n' is sent as "\r\n".
+ *
+ * @param string The null-terminated string to be sent.
+ */
+void send_string_via_uart(const char * string);
+
+/**
+ * Identical to send_string_via_uart, but sends a string stored in program memory; 
+ * e.g. send_string_via_uart_P(PSTR("Sensor readings: ")).
+ *
+ * @param string The null-terminated string to be sent, in program memory.
+ */
+void send_string_via_uart_P(const char * string);
+
+/**
+ * @return The number of characters which can be placed into the transmit buffer without
+ *    waiting; e.g. so a task can send a line in pieces, as the buffer drains, rather than blocking.
+ */
+uint8_t uart_transmit_space();
+
+/**
+ * Sets how the given stream sends newlines. This only applies to the streams set up by
+ * set_up_stdio_over_serial (e.g. stdout); other UART output is never translated, except
+ * by send_string_via_uart, which follows the mode of the standard output.
+ *
+ * @param stream The stream to be configured; e.g. stdout.
+ * @param mode The newline mode. Text streams start out as TranslateNewlines.
+ */
+void set_uart_newline_mode(FILE * stream, UARTNewlineMode mode);
+
+/**
+ * Sets the policy used when send_via_uart is called while the transmit buffer is full.
+ * The default policy is BlockWhenFull.
+ */
+void set_uart_transmit_policy(UARTBufferFullPolicy policy);
+
+/**
+ * Waits ('blocks') until every buffered character has been completely transmitted.
+ * Useful before sleeping, or before changing the UART's settings.
+ */
+void flush_uart();
+
 /**
  * Receives a single character over the UART.
  * If no characters have been receieved, this function will wait
  * until the device receives at least one.
+ *
+ * Characters are received in the background by the UART interrupt, and buffered until
+ * they're read, as long as global interrupts are enabled (e.g. with sei()).
  */
 char receieve_via_uart();
 
+/**
+ * Attempts to read a single received character, without ever waiting.
+ *
+ * @param c The location which will receive the character, if one is available.
+ * @retval 0 Returned if no characters were available.
+ * @retval 1 Returned if a character was read.
+ */
+uint8_t try_receive_via_uart(char * c);
+
+/**
+ * @return The number of received characters waiting to be read.
+ */
+uint8_t uart_characters_available();
+
+/**
+ * @return The number of receive errors which have occurred since the last call to clear_uart_receive_errors.
+ */
+UARTReceiveErrors uart_receive_errors();
+
+/**
+ * Resets each of the receive error counts to zero.
+ */
+void clear_uart_receive_errors();
+
 #endif